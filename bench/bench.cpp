@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include <gmp.h>
+#include "../src/attacks/batch_gcd.hpp"
+#include "../src/attacks/common_modulus.hpp"
+#include "../src/attacks/coppersmith.hpp"
+#include "../src/attacks/ecm.hpp"
+#include "../src/attacks/fermat.hpp"
+#include "../src/attacks/lehman.hpp"
+#include "../src/attacks/lowe.hpp"
+#include "../src/attacks/pminus1.hpp"
+#include "../src/attacks/pplus1.hpp"
+#include "../src/attacks/rho.hpp"
+#include "../src/attacks/siqs.hpp"
+#include "../src/attacks/squfof.hpp"
+#include "../src/attacks/trial.hpp"
+#include "../src/attacks/wiener.hpp"
+#include "../src/lattice.hpp"
+#include "../src/utils/json.hpp"
+
+/*
+ * Benchmarks for every attack at fixed sizes.
+ * Each case draws fresh inputs per repetition from a gmp random state seeded with
+ * (--seed, case name), so a case's keys do not change when others are added or filtered out.
+ * Only the attack call is timed; key generation happens before the clock starts.
+ * Output is one JSON document on stdout, progress goes to stderr.
+ */
+
+namespace {
+    using clock = std::chrono::steady_clock;
+
+    class Rng {
+    public:
+        Rng(uint64_t seed, const std::string &name) {
+            // fnv-1a of the case name, mixed with the global seed
+            uint64_t h = 1469598103934665603ULL ^ seed;
+            for (char c : name) h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+            gmp_randinit_mt(st_);
+            BigInt s(h);
+            gmp_randseed(st_, s.raw());
+        }
+        ~Rng() { gmp_randclear(st_); }
+        Rng(const Rng &) = delete;
+        Rng &operator=(const Rng &) = delete;
+
+        // exactly `bits` bits (top bit set)
+        BigInt bits(unsigned bits) {
+            BigInt r;
+            mpz_urandomb(r.raw(), st_, bits);
+            mpz_setbit(r.raw(), bits - 1);
+            return r;
+        }
+
+        BigInt below(const BigInt &n) {
+            BigInt r;
+            mpz_urandomm(r.raw(), st_, n.raw());
+            return r;
+        }
+
+        uint64_t below(uint64_t n) { return gmp_urandomm_ui(st_, n); }
+
+        BigInt prime(unsigned b) { return next_prime(bits(b)); }
+
+        static BigInt next_prime(const BigInt &x) {
+            BigInt r;
+            mpz_nextprime(r.raw(), x.raw());
+            return r;
+        }
+
+    private:
+        gmp_randstate_t st_;
+    };
+
+    BigInt pow2(unsigned e) {
+        BigInt r;
+        mpz_ui_pow_ui(r.raw(), 2, e);
+        return r;
+    }
+
+    bool is_prime(const BigInt &x) { return mpz_probab_prime_p(x.raw(), 25) != 0; }
+
+    // prime p of about `bits` bits with p + sign = 2 * (distinct primes in [bound/4, bound))
+    BigInt smooth_neighbour_prime(Rng &rng, unsigned bits, uint64_t bound, int sign) {
+        for (;;) {
+            BigInt m(static_cast<uint64_t>(2));
+            std::set<uint64_t> used;
+            while (m.bit_length() < bits) {
+                BigInt q = Rng::next_prime(BigInt(bound / 4 + rng.below(bound - bound / 4)));
+                if (q >= BigInt(bound) || !used.insert(mpz_get_ui(q.raw())).second) continue;
+                m *= q;
+            }
+            BigInt p = sign > 0 ? m - BigInt(static_cast<uint64_t>(1)) : m + BigInt(static_cast<uint64_t>(1));
+            if (is_prime(p)) return p;
+        }
+    }
+
+    // one repetition: builds its inputs, returns the timed part
+    using Run = std::function<bool()>;
+    using Make = std::function<Run(Rng &)>;
+
+    struct Case {
+        std::string name;   // attack/variant, what --filter matches
+        std::string attack;
+        std::string params; // JSON object
+        Make make;
+        unsigned reps{0};   // 0 = --reps
+    };
+
+    std::vector<Case> cases() {
+        using utils::json::Writer;
+        constexpr unsigned long long kUnbounded = ~0ULL;
+        std::vector<Case> cs;
+
+        // rho: one size per arithmetic (native u64, native u128, gmp montgomery)
+        for (auto [nb, pb] : {std::pair{64u, 24u}, {128u, 32u}, {256u, 36u}}) {
+            cs.push_back({"rho/n" + std::to_string(nb) + "-p" + std::to_string(pb), "rho",
+                          Writer().field("n_bits", 1ULL * nb).field("p_bits", 1ULL * pb).str(),
+                          [nb, pb](Rng &rng) -> Run {
+                              BigInt n = rng.prime(pb) * rng.prime(nb - pb);
+                              return [n] { return rho_attack(n, kUnbounded).success; };
+                          }});
+        }
+
+        // fermat: 512-bit n, |p - q| around 2^gap (iterations grow as gap^2 / sqrt(n))
+        for (unsigned gap : {100u, 136u, 140u, 142u}) {
+            cs.push_back({"fermat/n512-gap" + std::to_string(gap), "fermat",
+                          Writer().field("n_bits", 512ULL).field("gap_bits", 1ULL * gap).str(),
+                          [gap](Rng &rng) -> Run {
+                              BigInt p = rng.prime(256);
+                              BigInt q = Rng::next_prime(p + rng.bits(gap));
+                              BigInt n = p * q;
+                              return [n] { return fermat_factor(n, kUnbounded).success; };
+                          }});
+        }
+
+        // p-1 stage 1 at B1 = bound, p - 1 bound-smooth; then one prime past B1 for stage 2
+        for (uint64_t b : {1000ULL, 10000ULL, 100000ULL}) {
+            cs.push_back({"pminus1/B1=" + std::to_string(b), "pminus1",
+                          Writer().field("B1", 1ULL * b).field("p_bits", 160ULL).field("n_bits", 416ULL).str(),
+                          [b](Rng &rng) -> Run {
+                              BigInt n = smooth_neighbour_prime(rng, 160, b, -1) * rng.prime(256);
+                              return [n, b] { return pollards_pminus1(n, b, 1ULL, 0ULL).success; };
+                          }});
+        }
+        cs.push_back({"pminus1/B1=1e4-B2=1e7", "pminus1",
+                      Writer().field("B1", 10000ULL).field("B2", 10000000ULL).field("n_bits", 416ULL).str(),
+                      [](Rng &rng) -> Run {
+                          BigInt n;
+                          for (;;) {
+                              BigInt big = Rng::next_prime(BigInt(static_cast<uint64_t>(1000000 + rng.below(9000000))));
+                              BigInt m = smooth_neighbour_prime(rng, 140, 10000, 1) + BigInt(static_cast<uint64_t>(1));
+                              BigInt p = m * big + BigInt(static_cast<uint64_t>(1));
+                              if (!is_prime(p)) continue;
+                              n = p * rng.prime(256);
+                              break;
+                          }
+                          return [n] { return pollards_pminus1(n, 10000ULL, 1ULL, 10000000ULL).success; };
+                      }});
+
+        cs.push_back({"pplus1/B1=1e4", "pplus1",
+                      Writer().field("B1", 10000ULL).field("p_bits", 160ULL).field("n_bits", 416ULL).str(),
+                      [](Rng &rng) -> Run {
+                          BigInt n = smooth_neighbour_prime(rng, 160, 10000, 1) * rng.prime(256);
+                          return [n] { return williams_pplus1(n, 10000ULL, 3ULL, 0ULL).success; };
+                      }});
+
+        // wiener around its bound d < n^(1/4) / 3 (about 254 bits for a 1024-bit n); 260 must fail
+        for (unsigned db : {128u, 240u, 254u, 260u}) {
+            cs.push_back({"wiener/n1024-d" + std::to_string(db), "wiener",
+                          Writer().field("n_bits", 1024ULL).field("d_bits", 1ULL * db).field("expect", db <= 254).str(),
+                          [db](Rng &rng) -> Run {
+                              BigInt p = rng.prime(512), q = rng.prime(512);
+                              BigInt one(static_cast<uint64_t>(1));
+                              BigInt phi = (p - one) * (q - one);
+                              std::optional<BigInt> e;
+                              while (!e) e = BigInt::mod_inverse(rng.bits(db), phi);
+                              BigInt n = p * q;
+                              BigInt ee = *e;
+                              bool expect = db <= 254;
+                              return [n, ee, expect] { return wiener_attack(n, ee).success == expect; };
+                          }});
+        }
+
+        // LLL on knapsack-style bases: identity plus one column of random 64-bit weights
+        for (unsigned dim : {4u, 8u, 12u, 16u}) {
+            cs.push_back({"lll/dim" + std::to_string(dim), "lll",
+                          Writer().field("dim", 1ULL * dim).field("weight_bits", 64ULL).str(),
+                          [dim](Rng &rng) -> Run {
+                              lattice::Matrix basis(dim, std::vector<BigInt>(dim + 1, BigInt(static_cast<uint64_t>(0))));
+                              for (unsigned i = 0; i < dim; ++i) {
+                                  basis[i][i] = BigInt(static_cast<uint64_t>(1));
+                                  basis[i][dim] = rng.bits(64);
+                              }
+                              return [basis]() mutable { return lattice::lll_reduce(basis); };
+                          }, dim >= 16 ? 1u : 0u});
+        }
+
+        // hastad broadcast: crt over k 1024-bit moduli, then the cube root
+        for (unsigned k : {3u, 16u, 64u}) {
+            cs.push_back({"crt/e3-k" + std::to_string(k), "lowe",
+                          Writer().field("e", 3ULL).field("targets", 1ULL * k).field("n_bits", 1024ULL).str(),
+                          [k](Rng &rng) -> Run {
+                              std::vector<LoweTarget> ts;
+                              BigInt m = rng.bits(1000), three(static_cast<uint64_t>(3));
+                              for (unsigned i = 0; i < k; ++i) {
+                                  BigInt n = rng.prime(512) * rng.prime(512);
+                                  ts.push_back({n, BigInt::powm(m, three, n)});
+                              }
+                              return [ts, m] {
+                                  LoweResult r = low_e_broadcast(ts, 3);
+                                  return r.success && r.m == m;
+                              };
+                          }});
+        }
+
+        // the rest once each at a representative size
+        cs.push_back({"squfof/n56", "squfof", Writer().field("n_bits", 56ULL).str(), [](Rng &rng) -> Run {
+            BigInt n = rng.prime(28) * rng.prime(28);
+            return [n] { return squfof_factor(n).success; };
+        }});
+        cs.push_back({"ecm/p60-B1=11000", "ecm",
+                      Writer().field("p_bits", 60ULL).field("n_bits", 316ULL).field("B1", 11000ULL).str(),
+                      [](Rng &rng) -> Run {
+                          BigInt n = rng.prime(60) * rng.prime(256);
+                          return [n] { return ecm_factor(n, 11000ULL, 0ULL, 500ULL, 1, 1).success; };
+                      }});
+        for (unsigned digits : {40u, 50u}) {
+            cs.push_back({"siqs/" + std::to_string(digits) + "d", "siqs",
+                          Writer().field("digits", 1ULL * digits).field("threads", 1ULL).str(),
+                          [digits](Rng &rng) -> Run {
+                              unsigned bits = digits * 3322 / 1000;
+                              BigInt n = rng.prime(bits / 2) * rng.prime(bits - bits / 2);
+                              return [n] { return siqs_factor(n, 1, 1).success; };
+                          }});
+        }
+        cs.push_back({"trial/n512-limit1e6", "trial", Writer().field("limit", 1000000ULL).str(), [](Rng &rng) -> Run {
+            BigInt n = Rng::next_prime(BigInt(static_cast<uint64_t>(900000 + rng.below(90000)))) * rng.prime(492);
+            return [n] { return trial_division(n, 1000000ULL).success; };
+        }});
+        cs.push_back({"hart/n512-ratio5:3", "hart", Writer().field("n_bits", 512ULL).str(), [](Rng &rng) -> Run {
+            BigInt q = rng.prime(255);
+            BigInt p = Rng::next_prime(q * BigInt(static_cast<uint64_t>(5)) / BigInt(static_cast<uint64_t>(3)));
+            BigInt n = p * q;
+            return [n] { return hart_olf(n, 100000000ULL, 1, 0ULL).success; };
+        }});
+        cs.push_back({"batchgcd/1000x512", "batchgcd",
+                      Writer().field("moduli", 1000ULL).field("n_bits", 512ULL).field("threads", 1ULL).str(),
+                      [](Rng &rng) -> Run {
+                          std::vector<BigInt> ms;
+                          BigInt shared = rng.prime(256);
+                          for (int i = 0; i < 1000; ++i) ms.push_back(rng.prime(256) * (i < 2 ? shared : rng.prime(256)));
+                          return [ms] { return batch_gcd(ms, 1).hits.size() == 2; };
+                      }});
+        cs.push_back({"cmod/n2048", "cmod", Writer().field("n_bits", 2048ULL).str(), [](Rng &rng) -> Run {
+            BigInt n = rng.prime(1024) * rng.prime(1024), m = rng.bits(2000);
+            BigInt e1(static_cast<uint64_t>(65537)), e2(static_cast<uint64_t>(257));
+            BigInt c1 = BigInt::powm(m, e1, n), c2 = BigInt::powm(m, e2, n);
+            return [=] {
+                CommonModulusResult r = common_modulus_attack(n, e1, e2, c1, c2);
+                return r.success && r.m == m;
+            };
+        }});
+        cs.push_back({"coppersmith/e3-n1024-unknown16", "coppersmith",
+                      Writer().field("e", 3ULL).field("n_bits", 1024ULL).field("unknown_bits", 16ULL).str(),
+                      [](Rng &rng) -> Run {
+                          BigInt n = rng.prime(512) * rng.prime(512), m = rng.bits(300);
+                          BigInt high = (m / pow2(16)) * pow2(16);
+                          BigInt c = BigInt::powm(m, BigInt(static_cast<uint64_t>(3)), n);
+                          return [=] {
+                              CoppersmithResult r = coppersmith_small_e_partial_msg(c, 3, n, high, 16);
+                              return r.success && r.root == m;
+                          };
+                      }});
+        return cs;
+    }
+
+    int usage() {
+        std::cerr << "usage: rsaShit_bench [--filter SUBSTR] [--reps N] [--seed N] [--list]\n"
+                     "  runs every case whose name contains SUBSTR (default all), N repetitions each\n"
+                     "  (default 3), and prints one JSON document with per-case min / median / mean seconds\n";
+        return 2;
+    }
+}
+
+int main(int argc, char **argv) {
+    std::string filter;
+    unsigned reps = 3;
+    uint64_t seed = 1;
+    bool list = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--list") {
+            list = true;
+        } else if ((a == "--filter" || a == "--reps" || a == "--seed") && i + 1 < argc) {
+            std::string v = argv[++i];
+            try {
+                if (a == "--filter") filter = v;
+                else if (a == "--reps") reps = static_cast<unsigned>(std::max(1ULL, std::stoull(v)));
+                else seed = std::stoull(v);
+            } catch (const std::exception &) {
+                return usage();
+            }
+        } else {
+            return usage();
+        }
+    }
+
+    std::vector<Case> cs = cases();
+    if (list) {
+        for (const Case &c : cs) std::cout << c.name << "\n";
+        return 0;
+    }
+
+    std::string out = "{\"seed\":" + std::to_string(seed) + ",\"cases\":[";
+    bool first = true;
+    for (const Case &c : cs) {
+        if (c.name.find(filter) == std::string::npos) continue;
+        Rng rng(seed, c.name);
+        unsigned n = c.reps ? c.reps : reps;
+        std::vector<double> secs;
+        unsigned ok = 0;
+        for (unsigned r = 0; r < n; ++r) {
+            Run run = c.make(rng);
+            auto t0 = clock::now();
+            ok += run();
+            secs.push_back(std::chrono::duration<double>(clock::now() - t0).count());
+        }
+        std::sort(secs.begin(), secs.end());
+        double sum = 0;
+        for (double s : secs) sum += s;
+        double median = n % 2 ? secs[n / 2] : (secs[n / 2 - 1] + secs[n / 2]) / 2;
+        std::cerr << c.name << ": " << ok << "/" << n << " ok, median " << median << "s\n";
+        out += first ? "\n  " : ",\n  ";
+        first = false;
+        out += utils::json::Writer()
+                   .field("name", c.name)
+                   .field("attack", c.attack)
+                   .raw("params", c.params)
+                   .field("reps", 1ULL * n)
+                   .field("ok", 1ULL * ok)
+                   .field("min_s", secs.front())
+                   .field("median_s", median)
+                   .field("mean_s", sum / n)
+                   .field("max_s", secs.back())
+                   .str();
+    }
+    std::cout << out << "\n]}\n";
+    return 0;
+}
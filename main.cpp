@@ -1,7 +1,79 @@
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <string>
+#include "src/batch.hpp"
 #include "src/repl.hpp"
 
-int main() {
+static int usage() {
+    std::cerr << "usage: rsaShit                      interactive repl\n"
+                 "       rsaShit batch [FILE|-] [options]\n"
+                 "  reads one JSON target per line ({\"n\":..., \"e\":..., \"c\":..., \"related\":[...], \"id\":...})\n"
+                 "  from FILE or stdin and writes one JSON result per line to stdout as each key finishes\n"
+                 "  --workers N      keys factored at once (default: all cores)\n"
+                 "  --threads N      threads per key for ecm / siqs (default 1)\n"
+                 "  --queue N        lines buffered ahead of the workers (default 4 per worker)\n"
+                 "  --key-ms N       hard time cap per key (default: none)\n"
+                 "  --cheap-ms N     budget of each cheap stage (default 2000)\n"
+                 "  --heavy-ms N     budget of each expensive stage (default: per-stage)\n"
+                 "  --seed N         rho / ecm / siqs seed (default 1)\n";
+    return 2;
+}
+
+static int batch_main(int argc, char **argv) {
+    batch::Options opt;
+    std::string path = "-";
+    bool have_path = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a.rfind("--", 0) == 0) {
+            if (i + 1 >= argc) return usage();
+            unsigned long long v;
+            try {
+                size_t used;
+                v = std::stoull(argv[++i], &used);
+                if (argv[i][used] != '\0') return usage();
+            } catch (const std::exception &) {
+                return usage();
+            }
+            if (a == "--workers") opt.workers = static_cast<unsigned>(v);
+            else if (a == "--threads") opt.threads_per_key = static_cast<unsigned>(v);
+            else if (a == "--queue") opt.queue = static_cast<size_t>(v);
+            else if (a == "--key-ms") opt.key_ms = v;
+            else if (a == "--cheap-ms") opt.cheap_ms = v;
+            else if (a == "--heavy-ms") opt.heavy_ms = v;
+            else if (a == "--seed") opt.seed = v;
+            else return usage();
+        } else if (!have_path) {
+            path = a;
+            have_path = true;
+        } else {
+            return usage();
+        }
+    }
+
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) {
+            std::cerr << "cannot open " << path << "\n";
+            return 1;
+        }
+    }
+    // stdout carries nothing but result lines; the summary goes to stderr
+    std::ios::sync_with_stdio(false);
+    batch::Summary s = batch::run(path == "-" ? std::cin : file, std::cout, opt);
+    std::cerr << "batch: " << s.keys << " lines, " << s.factored << " factored, " << s.errors << " bad, "
+              << std::fixed << std::setprecision(3) << s.seconds << "s\n";
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        if (std::strcmp(argv[1], "batch") == 0) return batch_main(argc, argv);
+        return usage();
+    }
     // cool figlet banner
     std::cout <<
             "\n:::::::..   .::::::.   :::.     .::::::.   ::   .:  :::::::::::::::\r\n;;;;``;;;; ;;;`    `   ;;`;;   ;;;`    `  ,;;   ;;, ;;;;;;;;;;;''''\r\n [[[,/[[[' '[==/[[[[, ,[[ '[[, '[==/[[[[,,[[[,,,[[[ [[[     [[     \r\n $$$$$$c     '''    $c$$$cc$$$c  '''    $\"$$$\"\"\"$$$ $$$     $$     \r\n 888b \"88bo,88b    dP 888   888,88b    dP 888   \"88o888     88,    \r\n MMMM   \"W\"  \"YMmMY\"  YMM   \"\"`  \"YMmMY\"  MMM    YMMMMM     MMM    \r\n\n";
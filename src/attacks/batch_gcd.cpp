@@ -0,0 +1,314 @@
+#include "batch_gcd.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+/*
+ * Batch gcd (Bernstein, "How to find smooth parts of integers"; Heninger et al., "Mining your
+ * Ps and Qs"): with P = prod N_j, gcd(N_i, P / N_i) is the part of N_i shared with the rest.
+ * P / N_i is too big to form per i, but (P mod N_i^2) / N_i is the same thing mod N_i, and the
+ * remainder tree gets every P mod N_i^2 by walking down the product tree: R_root = P,
+ * R_node = R_parent mod node^2. Both trees are O(M(total bits) log(count)).
+ *
+ * Each level is split across worker threads (the nodes of a level are independent). With a
+ * spill directory the levels go to files of mpz_out_raw records and are streamed back in
+ * kSpillChunk node chunks, so RAM holds the root plus a chunk instead of the whole tree.
+ * A modulus whose gcd comes out as N_i itself shares both primes (or is duplicated); those few
+ * are split by pairwise gcd against the other hits.
+ */
+
+namespace {
+    constexpr size_t kSpillChunk = 1 << 12;
+
+    template<typename F>
+    void parallel_for(size_t count, unsigned threads, F f) {
+        if (threads <= 1 || count < 2) {
+            for (size_t i = 0; i < count; ++i) f(i);
+            return;
+        }
+        std::atomic<size_t> next{0};
+        auto run = [&] {
+            for (size_t i = next++; i < count; i = next++) f(i);
+        };
+        std::vector<std::jthread> pool;
+        pool.reserve(std::min<size_t>(threads, count));
+        for (size_t t = 0; t < std::min<size_t>(threads, count); ++t) pool.emplace_back(run);
+    }
+
+    /*
+     * One tree level: a borrowed vector (the leaves), an owned vector, or a spill file.
+     * Reads are sequential; append() moves the chunk in (memory) or writes it out (file).
+     */
+    class Level {
+    public:
+        explicit Level(const std::vector<BigInt> *view = nullptr) : view_(view) {
+            if (view_) count_ = view_->size();
+        }
+        explicit Level(std::filesystem::path file) : file_(std::move(file)) {}
+        Level(Level &&o) noexcept
+            : view_(o.view_), nodes_(std::move(o.nodes_)), file_(std::move(o.file_)),
+              out_(std::exchange(o.out_, nullptr)), in_(std::exchange(o.in_, nullptr)), count_(o.count_) {
+            o.file_.clear();
+        }
+        Level &operator=(Level &&o) noexcept {
+            if (this != &o) {
+                drop();
+                view_ = o.view_;
+                nodes_ = std::move(o.nodes_);
+                file_ = std::move(o.file_);
+                o.file_.clear();
+                out_ = std::exchange(o.out_, nullptr);
+                in_ = std::exchange(o.in_, nullptr);
+                count_ = o.count_;
+            }
+            return *this;
+        }
+        Level(const Level &) = delete;
+        Level &operator=(const Level &) = delete;
+        ~Level() { drop(); }
+
+        size_t size() const { return count_; }
+
+        void append(std::vector<BigInt> &chunk) {
+            count_ += chunk.size();
+            if (file_.empty()) {
+                for (BigInt &x : chunk) nodes_.push_back(std::move(x));
+                return;
+            }
+            if (!out_ && !(out_ = std::fopen(file_.c_str(), "wb")))
+                throw std::runtime_error("cannot write " + file_.string());
+            for (const BigInt &x : chunk) {
+                if (!mpz_out_raw(out_, x.raw())) throw std::runtime_error("write failed: " + file_.string());
+            }
+        }
+
+        void finish() {
+            if (out_ && std::fclose(std::exchange(out_, nullptr)))
+                throw std::runtime_error("write failed: " + file_.string());
+        }
+
+        // nodes [at, at + count); `at` has to continue where the previous read stopped
+        void read(size_t at, size_t count, std::vector<BigInt> &out) {
+            out.resize(count);
+            if (file_.empty()) {
+                const auto &src = view_ ? *view_ : nodes_;
+                for (size_t i = 0; i < count; ++i) out[i] = src[at + i];
+                return;
+            }
+            if (!in_ && !(in_ = std::fopen(file_.c_str(), "rb")))
+                throw std::runtime_error("cannot read " + file_.string());
+            for (BigInt &x : out) {
+                if (!mpz_inp_raw(x.raw(), in_)) throw std::runtime_error("read failed: " + file_.string());
+            }
+        }
+
+        // start reading from node 0 again
+        void rewind() {
+            if (in_) std::fclose(std::exchange(in_, nullptr));
+        }
+
+        void drop() {
+            nodes_.clear();
+            nodes_.shrink_to_fit();
+            if (out_) std::fclose(std::exchange(out_, nullptr));
+            if (in_) std::fclose(std::exchange(in_, nullptr));
+            if (!file_.empty()) {
+                std::error_code ec;
+                std::filesystem::remove(file_, ec);
+            }
+        }
+
+    private:
+        const std::vector<BigInt> *view_{nullptr};
+        std::vector<BigInt> nodes_;
+        std::filesystem::path file_;
+        std::FILE *out_{nullptr};
+        std::FILE *in_{nullptr};
+        size_t count_{0};
+    };
+
+    struct Shared {
+        size_t index;
+        BigInt g; // gcd(N_i, product of all the other moduli)
+    };
+
+    // product tree levels [leaves, ..., root]; stops short of the root when `stop` fires between levels
+    std::vector<Level> product_tree(const std::vector<BigInt> &moduli, unsigned threads,
+                                    const std::filesystem::path &dir, size_t chunk, const utils::StopToken &stop) {
+        std::vector<Level> levels;
+        levels.emplace_back(&moduli);
+        std::vector<BigInt> kids, up;
+        while (levels.back().size() > 1) {
+            if (stop.stop_requested()) break;
+            Level next = dir.empty() ? Level() : Level(dir / ("level-" + std::to_string(levels.size()) + ".bin"));
+            Level &below = levels.back();
+            size_t parents = (below.size() + 1) / 2;
+            for (size_t at = 0; at < parents; at += chunk) {
+                size_t cnt = std::min(chunk, parents - at);
+                below.read(2 * at, std::min(2 * cnt, below.size() - 2 * at), kids);
+                up.assign(cnt, BigInt());
+                parallel_for(cnt, threads, [&](size_t i) {
+                    if (2 * i + 1 < kids.size()) mpz_mul(up[i].raw(), kids[2 * i].raw(), kids[2 * i + 1].raw());
+                    else up[i] = std::move(kids[2 * i]);
+                });
+                next.append(up);
+            }
+            next.finish();
+            below.rewind();
+            levels.push_back(std::move(next));
+        }
+        return levels;
+    }
+
+    /*
+     * Remainder tree from the root down. Each level's remainders only live until the level
+     * below is done; at the leaves gcd((P mod N_i^2) / N_i, N_i) is taken right away and only
+     * the moduli with a gcd other than 1 are kept.
+     * `stop` is polled between levels; `levels_left` says how many were not reached.
+     */
+    std::vector<Shared> remainder_tree(std::vector<Level> &levels, unsigned threads,
+                                       const std::filesystem::path &dir, size_t chunk,
+                                       const utils::StopToken &stop, size_t &levels_left) {
+        std::vector<Shared> shared;
+        std::vector<BigInt> nodes, parents, out;
+        Level rems; // R at the level above, the root itself to start with
+        levels.back().read(0, 1, out);
+        rems.append(out);
+        for (size_t l = levels.size() - 1; l-- > 0;) {
+            if (stop.stop_requested()) {
+                levels_left = l + 1;
+                break;
+            }
+            Level &level = levels[l];
+            bool leaves = l == 0;
+            Level next = dir.empty() || leaves ? Level() : Level(dir / ("rem-" + std::to_string(l) + ".bin"));
+            for (size_t at = 0; at < level.size(); at += 2 * chunk) {
+                size_t cnt = std::min(2 * chunk, level.size() - at);
+                level.read(at, cnt, nodes);
+                rems.read(at / 2, (cnt + 1) / 2, parents);
+                out.assign(cnt, BigInt());
+                parallel_for(cnt, threads, [&](size_t i) {
+                    BigInt sq;
+                    mpz_mul(sq.raw(), nodes[i].raw(), nodes[i].raw());
+                    mpz_mod(out[i].raw(), parents[i / 2].raw(), sq.raw());
+                    if (leaves) {
+                        mpz_divexact(out[i].raw(), out[i].raw(), nodes[i].raw());
+                        mpz_gcd(out[i].raw(), out[i].raw(), nodes[i].raw());
+                    }
+                });
+                if (leaves) {
+                    for (size_t i = 0; i < cnt; ++i) {
+                        if (mpz_cmp_ui(out[i].raw(), 1) != 0) shared.push_back(Shared{at + i, std::move(out[i])});
+                    }
+                } else {
+                    next.append(out);
+                }
+            }
+            next.finish();
+            level.drop();
+            rems = std::move(next);
+        }
+        return shared;
+    }
+
+    BatchGcdResult batch_gcd_run(const std::vector<BigInt> &moduli, unsigned threads, const std::string &spill_dir,
+                                 const utils::StopToken &stop) {
+        BatchGcdResult res;
+        res.metrics.unit = "tree levels";
+        std::ostringstream log;
+        BigInt one(static_cast<uint64_t>(1));
+        for (size_t i = 0; i < moduli.size(); ++i) {
+            if (moduli[i] <= one) {
+                log << "modulus #" << i << " is < 2";
+                res.log = log.str();
+                return res;
+            }
+        }
+        if (moduli.size() < 2) {
+            res.log = "need at least 2 moduli";
+            return res;
+        }
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Shared> shared;
+        size_t depth = 0;
+        try {
+            std::filesystem::path dir(spill_dir);
+            if (!dir.empty()) std::filesystem::create_directories(dir);
+            size_t chunk = dir.empty() ? moduli.size() : kSpillChunk;
+            std::vector<Level> levels = product_tree(moduli, threads, dir, chunk, stop);
+            depth = levels.size() - 1;
+            res.metrics.iterations = depth;
+            if (levels.back().size() > 1) {
+                res.stopped = true;
+                log << "batch gcd stopped in the product tree after " << depth << " levels";
+                res.log = log.str();
+                return res;
+            }
+            size_t levels_left = 0;
+            shared = remainder_tree(levels, threads, dir, chunk, stop, levels_left);
+            res.metrics.iterations += depth - levels_left;
+            if (levels_left) {
+                res.stopped = true;
+                log << "batch gcd stopped in the remainder tree, " << levels_left << " of " << depth << " levels left";
+                res.log = log.str();
+                return res;
+            }
+        } catch (const std::exception &ex) {
+            res.log = std::string("batch gcd: ") + ex.what();
+            return res;
+        }
+
+        // g = N_i: both primes are shared; split it against the other hits
+        res.metrics.gcds = moduli.size();
+        size_t duplicates = 0;
+        for (const Shared &s : shared) {
+            BatchGcdHit hit;
+            hit.index = s.index;
+            hit.n = moduli[s.index];
+            BigInt g = s.g;
+            if (g == hit.n) {
+                for (const Shared &o : shared) {
+                    if (o.index == s.index) continue;
+                    BigInt d = BigInt::gcd(hit.n, moduli[o.index]);
+                    ++res.metrics.gcds;
+                    if (d != one && d != hit.n) {
+                        g = d;
+                        break;
+                    }
+                }
+            }
+            if (g == hit.n) {
+                ++duplicates;
+            } else {
+                BigInt other = hit.n / g;
+                hit.p = g < other ? g : other;
+                hit.q = g < other ? other : g;
+            }
+            res.hits.push_back(std::move(hit));
+        }
+
+        size_t bits = 0;
+        for (const BigInt &n : moduli) bits += n.bit_length();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        res.success = res.hits.size() > duplicates;
+        log << "batch gcd: " << moduli.size() << " moduli (" << bits << " bits), tree depth " << depth << ", "
+            << ms << " ms, " << threads << " threads" << (spill_dir.empty() ? "" : ", spilled to " + spill_dir)
+            << ": " << res.hits.size() - duplicates << " factored";
+        if (duplicates) log << ", " << duplicates << " only collide with an identical modulus";
+        res.log = log.str();
+        return res;
+    }
+}
+
+BatchGcdResult batch_gcd(const std::vector<BigInt> &moduli, unsigned threads, const std::string &spill_dir,
+                         const utils::StopToken &stop) {
+    return utils::measure([&] { return batch_gcd_run(moduli, threads, spill_dir, stop); });
+}
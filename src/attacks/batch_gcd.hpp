@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
+#include <string>
+#include <vector>
+
+struct BatchGcdHit {
+    size_t index{0}; // position in the input list
+    BigInt n{static_cast<uint64_t>(0)};
+    BigInt p{static_cast<uint64_t>(0)}; // p <= q, p * q = n
+    BigInt q{static_cast<uint64_t>(0)}; // both 0 when n only collides with an identical modulus
+};
+
+struct BatchGcdResult {
+    bool success{false};
+    std::vector<BatchGcdHit> hits;
+    bool stopped{false}; // the stop token fired between tree levels, hits is empty
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
+    std::string log;
+};
+
+/*
+ * Bernstein's batch gcd: finds every modulus that shares a prime with another one in the list,
+ * in quasi-linear time instead of the quadratic pairwise gcd.
+ * Product tree of all moduli, then remainder tree of the root down to P mod N_i^2, and
+ * gcd((P mod N_i^2) / N_i, N_i) per leaf.
+ *
+ * @param threads - workers per tree level (0 = all hardware threads)
+ * @param spill_dir - when non-empty, tree levels are written to files in this directory and
+ *                    streamed back in chunks, so only the root and one chunk sit in RAM
+ * @param stop - polled between tree levels
+ */
+BatchGcdResult batch_gcd(const std::vector<BigInt> &moduli,
+                         unsigned threads = 0,
+                         const std::string &spill_dir = "",
+                         const utils::StopToken &stop = {});
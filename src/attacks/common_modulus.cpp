@@ -11,12 +11,14 @@
  * The attacker can then compute m as m ≡ c1^a * c2^b mod n.
  */
 
-CommonModulusResult common_modulus_attack(const BigInt &n,
-                                          const BigInt &e1,
-                                          const BigInt &e2,
-                                          const BigInt &c1,
-                                          const BigInt &c2) {
+static CommonModulusResult common_modulus_run(const BigInt &n,
+                                              const BigInt &e1,
+                                              const BigInt &e2,
+                                              const BigInt &c1,
+                                              const BigInt &c2,
+                                              const utils::StopToken &stop) {
     CommonModulusResult r;
+    r.metrics.unit = "gcdext";
     std::ostringstream log;
     BigInt one(static_cast<uint64_t>(1));
     if (BigInt::gcd(e1, e2) != one) {
@@ -33,6 +35,8 @@ CommonModulusResult common_modulus_attack(const BigInt &n,
 
     // gcdext fills g, a, b so that a*e1 + b*e2 = g (should be 1)
     mpz_gcdext(g, a, b, ge1, ge2);
+    r.metrics.iterations = 1;
+    r.metrics.gcds = 2; // the coprimality check and the gcdext
 
     // check gcd==1
     if (mpz_cmp_ui(g, 1) != 0) {
@@ -45,6 +49,15 @@ CommonModulusResult common_modulus_attack(const BigInt &n,
         return r;
     }
 
+    // two powms left, nothing to poll inside them
+    if (stop.stop_requested()) {
+        log << "stopped after gcdext, before the powms";
+        mpz_clears(g, a, b, ge1, ge2, NULL);
+        r.stopped = true;
+        r.log = log.str();
+        return r;
+    }
+
     // part1 = c1^a (or inverse if a<0)
     BigInt part1(one);
     BigInt part2(one);
@@ -92,6 +105,7 @@ CommonModulusResult common_modulus_attack(const BigInt &n,
         mpz_clear(b_abs);
     }
 
+    r.metrics.powms = 2;
     r.m = (part1 * part2) % n;
     r.success = true;
     log << "recovered m";
@@ -100,3 +114,12 @@ CommonModulusResult common_modulus_attack(const BigInt &n,
     r.log = log.str();
     return r;
 }
+
+CommonModulusResult common_modulus_attack(const BigInt &n,
+                                          const BigInt &e1,
+                                          const BigInt &e2,
+                                          const BigInt &c1,
+                                          const BigInt &c2,
+                                          const utils::StopToken &stop) {
+    return utils::measure([&] { return common_modulus_run(n, e1, e2, c1, c2, stop); });
+}
@@ -1,11 +1,15 @@
 #pragma once
 
 #include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
 #include <string>
 
 struct CommonModulusResult {
     bool success{false};
     BigInt m{static_cast<uint64_t>(0)};
+    bool stopped{false}; // the stop token fired first; log says how far it got
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
     std::string log;
 };
 
@@ -13,5 +17,6 @@ CommonModulusResult common_modulus_attack(const BigInt &n,
                                          const BigInt &e1,
                                          const BigInt &e2,
                                          const BigInt &c1,
-                                         const BigInt &c2);
+                                         const BigInt &c2,
+                                         const utils::StopToken &stop = {});
 
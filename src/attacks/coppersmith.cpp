@@ -1,4 +1,5 @@
 #include "coppersmith.hpp"
+#include "../lattice.hpp"
 #include <sstream>
 #include <vector>
 #include <algorithm>
@@ -18,205 +19,7 @@
  * we want to find small x such that ax + b ≡ 0 (mod p) where p | N.
  */
 
-// matrix type for LLL - no doubles shit, pure bigint
-using Matrix = std::vector<std::vector<BigInt> >;
-
-// full fraction type using only bigints shiiiii
-struct Fraction {
-    BigInt num; // numerator (can be negative)
-    BigInt den; // denominator (>0)
-    Fraction() : num(BigInt(static_cast<uint64_t>(0))), den(BigInt(static_cast<uint64_t>(1))) {}
-    Fraction(const BigInt &n) : num(n), den(BigInt(static_cast<uint64_t>(1))) {}
-    Fraction(const BigInt &n, const BigInt &d) : num(n), den(d) { normalize(); }
-    void normalize() {
-        BigInt zero(static_cast<uint64_t>(0));
-        if (den == zero) {
-            throw std::runtime_error("fraction denominator is zero");
-        }
-        // ensure denominator positive
-        if (den < zero) {
-            den = zero - den;
-            num = zero - num;
-        }
-        // reduce by gcd
-        BigInt a = num;
-        if (a < zero) a = zero - a; // abs(num)
-        BigInt g = BigInt::gcd(a, den);
-        if (!(g == BigInt(static_cast<uint64_t>(1)))) {
-            num /= g;
-            den /= g;
-        }
-    }
-};
-
-// helpers for fraction operations (minimal set)
-static Fraction frac_add(const Fraction &a, const Fraction &b) {
-    BigInt n = a.num * b.den + b.num * a.den;
-    BigInt d = a.den * b.den;
-    return Fraction(n, d);
-}
-static Fraction frac_sub(const Fraction &a, const Fraction &b) {
-    BigInt n = a.num * b.den - b.num * a.den;
-    BigInt d = a.den * b.den;
-    return Fraction(n, d);
-}
-static Fraction frac_mul(const Fraction &a, const Fraction &b) {
-    BigInt n = a.num * b.num;
-    BigInt d = a.den * b.den;
-    return Fraction(n, d);
-}
-static Fraction frac_square(const Fraction &a) {
-    BigInt n = a.num * a.num;
-    BigInt d = a.den * a.den;
-    return Fraction(n, d);
-}
-
-// compare fractions: returns -1 if a<b, 0 if equal, 1 if a>b
-static int frac_cmp(const Fraction &a, const Fraction &b) {
-    BigInt left = a.num * b.den;
-    BigInt right = b.num * a.den;
-    if (left < right) return -1;
-    if (left > right) return 1;
-    return 0;
-}
-
-// round fraction to nearest integer (ties to floor) using bigint only
-static BigInt frac_round_to_int(const Fraction &f) {
-    BigInt zero(static_cast<uint64_t>(0));
-    if (f.den == BigInt(static_cast<uint64_t>(1))) return f.num; // already integer
-    // floor
-    BigInt q = f.num / f.den;
-    BigInt r = f.num % f.den;
-    // check |2r| >= |den|
-    BigInt two(static_cast<uint64_t>(2));
-    BigInt abs2r = r; if (abs2r < zero) abs2r = zero - abs2r; abs2r *= two;
-    BigInt absd = f.den; // positive
-    if (abs2r > absd) {
-        // adjust depending on sign of num
-        if (f.num >= zero) {
-            q += BigInt(static_cast<uint64_t>(1));
-        } else {
-            q -= BigInt(static_cast<uint64_t>(1));
-        }
-    }
-    return q;
-}
-
-// compute dot product of integer vector and integer vector
-static BigInt dot_int(const std::vector<BigInt> &a, const std::vector<BigInt> &b) {
-    BigInt acc(static_cast<uint64_t>(0));
-    size_t m = std::min(a.size(), b.size());
-    for (size_t i=0; i<m; ++i) acc += a[i] * b[i];
-    return acc;
-}
-
-// compute dot product of integer vector and rational vector
-static Fraction dot_mixed(const std::vector<BigInt> &a, const std::vector<Fraction> &b) {
-    Fraction acc; // 0
-    size_t m = std::min(a.size(), b.size());
-    for (size_t i=0; i<m; ++i) {
-        Fraction term(a[i] * b[i].num, b[i].den); // a[i]*b[i]
-        acc = frac_add(acc, term);
-    }
-    return acc;
-}
-
-// compute squared norm of rational vector
-static Fraction norm_sq(const std::vector<Fraction> &v) {
-    Fraction acc; // 0
-    for (const auto &x : v) {
-        acc = frac_add(acc, frac_square(x));
-    }
-    return acc;
-}
-
-/*
- * Full LLL lattice reduction (delta = 3/4) using bigint-only exact rational arithmetic.
- * Implements Gram-Schmidt orthogonalization with fractions (numerator/denominator bigints).
- * This is slower than floating implementations but exact and suitable for RSA-related code.
- *
- * @param basis - matrix of integer basis vectors (each row is a basis vector)
- * @return true if finished (always true unless pathological zero vectors cause issues)
- */
-static bool lll_reduce(Matrix &basis) {
-    size_t n = basis.size();
-    if (n == 0) return true;
-    size_t dim = basis[0].size();
-
-    // gram-schmidt storage
-    std::vector<std::vector<Fraction>> b_star(n, std::vector<Fraction>(dim));
-    std::vector<Fraction> B(n); // squared norms of b_star
-    std::vector<std::vector<Fraction>> mu(n, std::vector<Fraction>(n)); // mu[i][j]
-
-    Fraction delta(Fraction(BigInt(static_cast<uint64_t>(3)), BigInt(static_cast<uint64_t>(4))));
-    BigInt zero(static_cast<uint64_t>(0));
-    BigInt one(static_cast<uint64_t>(1));
-
-    auto recompute_gs = [&](size_t upto){
-        for (size_t i=0; i<=upto && i<n; ++i) {
-            // start with b_i as fraction vector
-            for (size_t k=0; k<dim; ++k) {
-                b_star[i][k] = Fraction(basis[i][k]);
-            }
-            // subtract projections onto previous b_star
-            for (size_t j=0; j<i; ++j) {
-                // mu[i][j] = <b_i, b*_j> / B[j]
-                Fraction numer = dot_mixed(basis[i], b_star[j]);
-                // division by B[j]: (numer.num / numer.den) / (B[j].num / B[j].den) = numer.num * B[j].den / (numer.den * B[j].num)
-                Fraction mu_ij;
-                if (B[j].num == zero) {
-                    mu_ij = Fraction(); // treat as zero
-                } else {
-                    BigInt mu_num = numer.num * B[j].den;
-                    BigInt mu_den = numer.den * B[j].num;
-                    mu_ij = Fraction(mu_num, mu_den);
-                }
-                mu[i][j] = mu_ij;
-                // b_star[i] -= mu_ij * b_star[j]
-                for (size_t k=0; k<dim; ++k) {
-                    Fraction prod(b_star[j][k].num * mu_ij.num, b_star[j][k].den * mu_ij.den);
-                    b_star[i][k] = frac_sub(b_star[i][k], prod);
-                }
-            }
-            B[i] = norm_sq(b_star[i]);
-        }
-    };
-
-    recompute_gs(n-1); // initial GS
-
-    size_t k = 1;
-    while (k < n) {
-        // size reduction: for j = k-1 .. 0
-        for (int j = static_cast<int>(k) - 1; j >= 0; --j) {
-            // round mu[k][j]
-            BigInt r = frac_round_to_int(mu[k][j]);
-            // if r != 0, apply b_k -= r * b_j and update mu[k][*]
-            if (!(r == zero)) {
-                for (size_t col=0; col<dim; ++col) {
-                    basis[k][col] -= r * basis[j][col];
-                }
-            }
-        }
-        // update GS for vector k (since we modified b_k during size reduction)
-        recompute_gs(k);
-
-        // Lovasz condition: (delta - mu[k][k-1]^2) * B[k-1] <= B[k]
-        Fraction mu_sq = frac_square(mu[k][k-1]);
-        Fraction left = frac_mul(frac_sub(delta, mu_sq), B[k-1]);
-        if (frac_cmp(left, B[k]) <= 0) {
-            // condition satisfied
-            ++k;
-            continue;
-        }
-        // swap b_k and b_{k-1}
-        std::swap(basis[k], basis[k-1]);
-        // recompute GS for indices k-1 and k onward
-        recompute_gs(k);
-        if (k > 1) --k;
-    }
-
-    return true;
-}
+using lattice::Matrix;
 
 /*
  * construct lattice for coppersmith univariate method
@@ -285,12 +88,17 @@ static std::optional<BigInt> extract_root_from_vector(
     return std::nullopt;
 }
 
-// brute force search for small roots (fallback when LLL doesn't work)
+// candidates between two polls of the stop token in the brute force loops
+constexpr unsigned kBrutePoll = 4096;
+
+// brute force search for small roots (fallback when LLL doesn't work); `tried` counts candidates
 static std::optional<BigInt> brute_force_small_root(
     const BigInt &a,
     const BigInt &b,
     const BigInt &n,
-    const BigInt &x_bound
+    const BigInt &x_bound,
+    const utils::StopToken &stop,
+    unsigned long long &tried
 ) {
     // check ax + b ≡ 0 (mod n) for x in [0, x_bound]
     BigInt zero(static_cast<uint64_t>(0));
@@ -308,26 +116,34 @@ static std::optional<BigInt> brute_force_small_root(
         }
     }
 
-    // fallback brute force for very small bounds
+    // fallback brute force for very small bounds: a*x + b walks by +a, no multiply per candidate
     if (x_bound < BigInt(static_cast<uint64_t>(1000000))) {
-        for (BigInt x = zero; x < x_bound; x += one) {
-            if (((a * x + b) % n).is_zero()) {
+        ModContext ctx(n);
+        BigInt step = a, value = b;
+        ctx.reduce(step);
+        ctx.reduce(value);
+        for (BigInt x = zero; x < x_bound; x += one, ++tried) {
+            if (tried % kBrutePoll == kBrutePoll - 1 && stop.stop_requested()) break;
+            if (value.is_zero()) {
                 return x;
             }
+            ctx.addmod(value, value, step);
         }
     }
 
     return std::nullopt;
 }
 
-CoppersmithResult coppersmith_univariate_linear(
+static CoppersmithResult coppersmith_linear_run(
     const BigInt &a,
     const BigInt &b,
     const BigInt &n,
     double beta,
-    double epsilon
+    double epsilon,
+    const utils::StopToken &stop
 ) {
     CoppersmithResult result;
+    result.metrics.unit = "candidates";
     std::ostringstream log;
 
     // based on howgrave-graham, bound is roughly n^beta
@@ -369,7 +185,7 @@ CoppersmithResult coppersmith_univariate_linear(
     if (x_bound > BigInt(static_cast<uint64_t>(0))) {
         auto lattice = build_coppersmith_lattice_linear(a, b, n, x_bound);
 
-        if (lll_reduce(lattice)) {
+        if (lattice::lll_reduce(lattice)) {
             log << "LLL reduction succeeded; ";
             // the first vector in the reduced basis is the shortest
             if (auto root = extract_root_from_vector(lattice[0], x_bound)) {
@@ -390,57 +206,73 @@ CoppersmithResult coppersmith_univariate_linear(
 
     // fallback to brute force (mostly for very small bounds)
     log << "trying brute force";
-    if (auto root = brute_force_small_root(a, b, n, x_bound)) {
+    unsigned long long tried = 0;
+    if (auto root = brute_force_small_root(a, b, n, x_bound, stop, tried)) {
         result.success = true;
         result.root = *root;
         log << "; found x=" << root->to_dec();
+    } else if (stop.stop_requested()) {
+        result.stopped = true;
+        log << "; stopped after " << tried << " candidates";
     } else {
         log << "; no small root found";
     }
+    result.metrics.iterations = tried;
 
     result.log = log.str();
     return result;
 }
 
-// helper to evaluate polynomial mod n
-static BigInt eval_poly_mod(const std::vector<BigInt> &coeffs, const BigInt &x, const BigInt &n) {
-    if (coeffs.empty()) return BigInt(static_cast<uint64_t>(0));
-    BigInt result(static_cast<uint64_t>(0));
-    for (int i = coeffs.size() - 1; i >= 0; --i) {
-        result = (result * x + coeffs[i]) % n;
+// helper to evaluate polynomial mod n (horner); coeffs and x in ctx form, result in ctx form
+static void eval_poly_mod(ModContext &ctx, const std::vector<BigInt> &coeffs, const BigInt &x, BigInt &result) {
+    result = BigInt(static_cast<uint64_t>(0));
+    for (int i = static_cast<int>(coeffs.size()) - 1; i >= 0; --i) {
+        ctx.mulmod(result, result, x);
+        ctx.addmod(result, result, coeffs[i]);
     }
-    return result;
 }
 
-// brute force search for polynomial roots (for small search space)
+// brute force search for polynomial roots (for small search space); `tried` counts candidates
 static std::optional<BigInt> brute_force_poly_root(
     const std::vector<BigInt> &coeffs,
     const BigInt &n,
-    const BigInt &x_bound
+    const BigInt &x_bound,
+    const utils::StopToken &stop,
+    unsigned long long &tried
 ) {
     BigInt zero(static_cast<uint64_t>(0));
     BigInt one(static_cast<uint64_t>(1));
 
     unsigned long long max_tries = 1000000ULL;
-    if (x_bound < BigInt(max_tries)) {
-        for (BigInt x = zero; x < x_bound; x += one) {
-            if (eval_poly_mod(coeffs, x, n).is_zero()) {
+    if (x_bound < BigInt(static_cast<uint64_t>(max_tries))) {
+        // move everything into montgomery form once; x itself steps by +1 (= ctx.one())
+        ModContext ctx(n);
+        std::vector<BigInt> mc = coeffs;
+        for (auto &c : mc) ctx.to_mont(c);
+        BigInt xm = zero, value;
+        for (BigInt x = zero; x < x_bound; x += one, ++tried) {
+            if (tried % kBrutePoll == kBrutePoll - 1 && stop.stop_requested()) break;
+            eval_poly_mod(ctx, mc, xm, value);
+            if (value.is_zero()) {
                 return x;
             }
+            ctx.addmod(xm, xm, ctx.one());
         }
     }
 
     return std::nullopt;
 }
 
-CoppersmithResult coppersmith_small_e_partial_msg(
+static CoppersmithResult coppersmith_partial_msg_run(
     const BigInt &c,
     unsigned e,
     const BigInt &n,
     const BigInt &m_high,
-    size_t unknown_bits
+    size_t unknown_bits,
+    const utils::StopToken &stop
 ) {
     CoppersmithResult result;
+    result.metrics.unit = "candidates";
     std::ostringstream log;
 
     if (e != 3 && e != 5) {
@@ -484,14 +316,41 @@ CoppersmithResult coppersmith_small_e_partial_msg(
 
     // brute force search for small root
     log << "using brute force";
-    if (auto root_opt = brute_force_poly_root(coeffs, n, x_bound)) {
+    unsigned long long tried = 0;
+    if (auto root_opt = brute_force_poly_root(coeffs, n, x_bound, stop, tried)) {
         result.success = true;
         result.root = (m_high + *root_opt);
         log << "; recovered missing bits, full message=" << result.root.to_hex();
+    } else if (stop.stop_requested()) {
+        result.stopped = true;
+        log << "; stopped after " << tried << " candidates";
     } else {
         log << "; failed to find root in search space";
     }
+    result.metrics.iterations = tried;
 
     result.log = log.str();
     return result;
 }
+
+CoppersmithResult coppersmith_univariate_linear(
+    const BigInt &a,
+    const BigInt &b,
+    const BigInt &n,
+    double beta,
+    double epsilon,
+    const utils::StopToken &stop
+) {
+    return utils::measure([&] { return coppersmith_linear_run(a, b, n, beta, epsilon, stop); });
+}
+
+CoppersmithResult coppersmith_small_e_partial_msg(
+    const BigInt &c,
+    unsigned e,
+    const BigInt &n,
+    const BigInt &m_high,
+    size_t unknown_bits,
+    const utils::StopToken &stop
+) {
+    return utils::measure([&] { return coppersmith_partial_msg_run(c, e, n, m_high, unknown_bits, stop); });
+}
@@ -1,11 +1,15 @@
 #pragma once
 
 #include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
 #include <string>
 
 struct CoppersmithResult {
     bool success{false};
     BigInt root{static_cast<uint64_t>(0)};
+    bool stopped{false}; // the stop token fired first; log says how far it got
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
     std::string log;
 };
 
@@ -18,6 +22,7 @@ struct CoppersmithResult {
  * @param n - modulus
  * @param beta - parameter controlling root bound (0 < beta <= 1)
  * @param epsilon - LLL parameter (typically 0.01)
+ * @param stop - polled every 4096 candidates of the brute force fallback
  * @return CoppersmithResult with success flag and root if found
  */
 CoppersmithResult coppersmith_univariate_linear(
@@ -25,7 +30,8 @@ CoppersmithResult coppersmith_univariate_linear(
     const BigInt &b,
     const BigInt &n,
     double beta = 0.5,
-    double epsilon = 0.01
+    double epsilon = 0.01,
+    const utils::StopToken &stop = {}
 );
 
 /*
@@ -37,6 +43,7 @@ CoppersmithResult coppersmith_univariate_linear(
  * @param n - modulus
  * @param m_high - known high bits of message
  * @param unknown_bits - number of unknown low bits
+ * @param stop - polled every 4096 candidates
  * @return CoppersmithResult with recovered full message if successful
  */
 CoppersmithResult coppersmith_small_e_partial_msg(
@@ -44,6 +51,7 @@ CoppersmithResult coppersmith_small_e_partial_msg(
     unsigned e,
     const BigInt &n,
     const BigInt &m_high,
-    size_t unknown_bits
+    size_t unknown_bits,
+    const utils::StopToken &stop = {}
 );
 
@@ -0,0 +1,392 @@
+#include "ecm.hpp"
+#include "../utils/primes.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+/*
+ * Lenstra's elliptic curve method. Like p-1, but the group is E(Z/pZ) for a random curve E,
+ * whose order moves around in [p + 1 - 2 sqrt p, p + 1 + 2 sqrt p] from curve to curve, so
+ * we get as many tries at a smooth group order as we are willing to pay curves for.
+ *
+ * Curves are Montgomery curves B y^2 = x^3 + A x^2 + x with Suyama's parametrization
+ * (u = sigma^2 - 5, v = 4 sigma, x0 = u^3 / v^3), which forces 12 | #E and gives a known point
+ * without a square root. Only x = X/Z is tracked: doubling needs (A + 2) / 4, addition needs
+ * x(P - Q), so scalar multiplication is a montgomery ladder. Everything runs in a ModContext.
+ *
+ * Stage 1 multiplies the point by every prime power <= B1 streamed from the prime sieve;
+ * p is found when Z = 0 mod p, i.e. gcd(Z, n).
+ * Stage 2 covers one more prime q in (B1, B2] with the same baby-step giant-step pairing as
+ * p-1: q = kD +- j, and x(kD Q) = x(j Q) mod p iff (kD -+ j) Q = O mod p, so one multiply
+ * by X_kD - x_j Z_kD covers both. Baby x_j are normalized once (one batch inversion), giants
+ * step by kD Q + D Q with difference (k - 1)D Q, and gcd is taken once per block.
+ *
+ * Curves run on worker threads like rho_attack_parallel: curve i cancels every curve > i, so
+ * the reported factor is always the lowest successful curve's and a seed gives one answer.
+ */
+
+namespace {
+    constexpr size_t kPollPrimes = 1024;     // stage 1 primes between cancellation checks
+    constexpr size_t kStage2Block = 1 << 12; // stage 2 multiplies per gcd
+    constexpr unsigned long long kDs[] = {210, 2310, 30030};
+
+    struct Point {
+        BigInt x, z;
+    };
+
+    class Curve {
+    public:
+        Curve(ModContext &ctx, const BigInt &a24) : ctx_(ctx), a24_(a24) {}
+
+        // r = 2p
+        void dbl(Point &r, const Point &p) {
+            ctx_.addmod(s_, p.x, p.z);
+            ctx_.sqrmod(s_, s_);
+            ctx_.submod(d_, p.x, p.z);
+            ctx_.sqrmod(d_, d_);
+            ctx_.submod(t_, s_, d_);
+            ctx_.mulmod(r.x, s_, d_);
+            ctx_.mulmod(u_, a24_, t_);
+            ctx_.addmod(u_, u_, d_);
+            ctx_.mulmod(r.z, t_, u_);
+            muls += 5;
+        }
+
+        // r = p + q given diff = p - q; r may alias p or q, not diff
+        void add(Point &r, const Point &p, const Point &q, const Point &diff) {
+            ctx_.submod(s_, p.x, p.z);
+            ctx_.addmod(t_, q.x, q.z);
+            ctx_.mulmod(u_, s_, t_);
+            ctx_.addmod(s_, p.x, p.z);
+            ctx_.submod(t_, q.x, q.z);
+            ctx_.mulmod(v_, s_, t_);
+            ctx_.addmod(s_, u_, v_);
+            ctx_.sqrmod(s_, s_);
+            ctx_.submod(t_, u_, v_);
+            ctx_.sqrmod(t_, t_);
+            ctx_.mulmod(r.x, diff.z, s_);
+            ctx_.mulmod(r.z, diff.x, t_);
+            muls += 6;
+        }
+
+        // (r0, r1) = (k p, (k + 1) p) for k >= 1
+        void ladder(Point &r0, Point &r1, const Point &p, uint64_t k) {
+            r0 = p;
+            dbl(r1, p);
+            for (int b = 62 - __builtin_clzll(k); b >= 0; --b) {
+                if ((k >> b) & 1) {
+                    add(r0, r0, r1, p);
+                    dbl(r1, r1);
+                } else {
+                    add(r1, r0, r1, p);
+                    dbl(r0, r0);
+                }
+            }
+        }
+
+        void mul(Point &p, uint64_t k) {
+            ladder(p, tmp_, Point(p), k);
+        }
+
+        unsigned long long muls{0}; // modular multiplies and squarings in dbl / add
+
+    private:
+        ModContext &ctx_;
+        const BigInt &a24_;
+        BigInt s_, d_, t_, u_, v_;
+        Point tmp_;
+    };
+
+    // sigma for curve `index` under `seed`, in [6, 2^32)
+    uint64_t curve_sigma(uint64_t seed, uint64_t index) {
+        std::mt19937_64 rng(seed ^ (0x9e3779b97f4a7c15ULL * (index + 1)));
+        return 6 + rng() % ((1ULL << 32) - 6);
+    }
+
+    /*
+     * Suyama curve for sigma, in ctx form. Returns the gcd of the denominator with n when it
+     * is not invertible (then there is no curve, but the gcd may be a factor), 1 otherwise.
+     */
+    BigInt suyama(ModContext &ctx, uint64_t sigma, Point &p, BigInt &a24) {
+        const BigInt &n = ctx.modulus();
+        BigInt s(static_cast<uint64_t>(sigma));
+        BigInt u = s * s - BigInt(static_cast<uint64_t>(5));
+        BigInt v = s * BigInt(static_cast<uint64_t>(4));
+        u %= n;
+        v %= n;
+        BigInt u3 = u * u * u % n;
+        BigInt v3 = v * v * v % n;
+        BigInt vmu = (v - u) % n;
+        // a24 = (A + 2) / 4 = (v - u)^3 (3u + v) / (16 u^3 v)
+        BigInt num = vmu * vmu % n * vmu % n * ((u * BigInt(static_cast<uint64_t>(3)) + v) % n) % n;
+        BigInt den = u3 * v % n * BigInt(static_cast<uint64_t>(16)) % n;
+        auto inv = BigInt::mod_inverse(den, n);
+        if (!inv) return BigInt::gcd(den, n);
+        a24 = num * *inv % n;
+        p.x = u3;
+        p.z = v3;
+        ctx.to_mont(a24);
+        ctx.to_mont(p.x);
+        ctx.to_mont(p.z);
+        return BigInt(static_cast<uint64_t>(1));
+    }
+
+    unsigned long long max_prime_power_leq(unsigned long long p, unsigned long long B) {
+        unsigned long long pk = p;
+        while (pk <= B / p) pk *= p;
+        return pk;
+    }
+
+    /*
+     * Stage 1 on p. Returns gcd(Z, n), or 1 without finishing when `stop` is set.
+     */
+    template<typename Stop>
+    BigInt stage1(ModContext &ctx, Curve &curve, Point &p, unsigned long long B1, Stop stop) {
+        utils::PrimeSieve sieve(2, B1);
+        size_t since_poll = 0;
+        for (uint64_t q = sieve.next(); q; q = sieve.next()) {
+            curve.mul(p, max_prime_power_leq(q, B1));
+            if (++since_poll == kPollPrimes) {
+                since_poll = 0;
+                if (stop()) return BigInt(static_cast<uint64_t>(1));
+            }
+        }
+        BigInt z = p.z;
+        ctx.from_mont(z);
+        return BigInt::gcd(z, ctx.modulus());
+    }
+
+    /*
+     * D balancing the phi(D)/2 baby steps against (B2 - B1)/D giant steps; D/2 has to stay
+     * <= B1 so that every q in (B1, B2] has k >= 1.
+     */
+    unsigned long long pick_d(unsigned long long B1, unsigned long long B2) {
+        unsigned long long best = 0, best_cost = std::numeric_limits<unsigned long long>::max();
+        for (unsigned long long D : kDs) {
+            if (D / 2 > B1) break;
+            unsigned long long half_phi = 0;
+            for (unsigned long long j = 1; j < D / 2; ++j) half_phi += std::gcd(j, D) == 1;
+            unsigned long long cost = half_phi + (B2 - B1) / D;
+            if (cost < best_cost) {
+                best = D;
+                best_cost = cost;
+            }
+        }
+        return best;
+    }
+
+    /*
+     * Stage 2 on the stage 1 output q. Returns the last gcd taken (1 if nothing turned up).
+     */
+    template<typename Stop>
+    BigInt stage2(ModContext &ctx, Curve &curve, const Point &q, unsigned long long B1, unsigned long long B2,
+                  unsigned long long D, unsigned long long &muls, unsigned long long &gcds, Stop stop) {
+        const BigInt &n = ctx.modulus();
+        BigInt one(static_cast<uint64_t>(1));
+
+        // babies: j Q for odd j < D/2, x_j = X_j / Z_j for the j coprime to D
+        std::vector<int> slot(D / 2, -1);
+        std::vector<unsigned> js;
+        for (unsigned long long j = 1; j < D / 2; j += 2) {
+            if (std::gcd(j, D) != 1) continue;
+            slot[j] = static_cast<int>(js.size());
+            js.push_back(static_cast<unsigned>(j));
+        }
+        std::vector<BigInt> xs, zs;
+        Point q2, prev = q, cur = q, next;
+        curve.dbl(q2, q);
+        for (unsigned long long j = 1; j < D / 2; j += 2) {
+            if (slot[j] >= 0) {
+                xs.push_back(cur.x);
+                zs.push_back(cur.z);
+            }
+            if (j == 1) {
+                curve.add(next, q2, q, q); // 3Q = 2Q + Q, diff Q
+            } else {
+                curve.add(next, cur, q2, prev); // (j+2)Q = jQ + 2Q, diff (j-2)Q
+            }
+            prev = cur;
+            cur = next;
+        }
+        // batch inversion of the Z_j in the normal domain
+        std::vector<BigInt> prefix(zs.size());
+        BigInt acc(static_cast<uint64_t>(1));
+        for (size_t i = 0; i < zs.size(); ++i) {
+            ctx.from_mont(xs[i]);
+            ctx.from_mont(zs[i]);
+            prefix[i] = acc;
+            acc = acc * zs[i] % n;
+        }
+        auto inv = BigInt::mod_inverse(acc, n);
+        if (!inv) return BigInt::gcd(acc, n);
+        BigInt all_inv = *inv;
+        for (size_t i = zs.size(); i-- > 0;) {
+            BigInt zinv = all_inv * prefix[i] % n;
+            all_inv = all_inv * zs[i] % n;
+            xs[i] = xs[i] * zinv % n;
+            ctx.to_mont(xs[i]);
+        }
+
+        // giants: G = D Q, walk k D Q from k0
+        Point g, g2, gk, gk1;
+        curve.ladder(g, g2, q, D);
+        unsigned long long k0 = (B1 + 1 + D / 2) / D;
+        curve.ladder(gk, gk1, g, k0);
+        unsigned long long k = k0;
+        auto advance = [&] {
+            curve.add(next, gk1, g, gk); // (k+2)G = (k+1)G + G, diff kG
+            gk = std::move(gk1);
+            gk1 = std::move(next);
+            ++k;
+        };
+
+        BigInt prod = ctx.one(), diff, t, gcd(one);
+        size_t pending = 0;
+        std::vector<unsigned char> hit(D / 2, 0);
+        std::vector<unsigned> js_k;
+        auto flush = [&] {
+            for (unsigned j : js_k) {
+                ctx.mulmod(t, xs[static_cast<size_t>(slot[j])], gk.z);
+                ctx.submod(diff, gk.x, t);
+                ctx.mulmod(prod, prod, diff);
+                hit[j] = 0;
+            }
+            muls += 2 * js_k.size();
+            pending += js_k.size();
+            js_k.clear();
+            if (pending < kStage2Block) return false;
+            pending = 0;
+            gcd = BigInt::gcd(prod, n);
+            ++gcds;
+            return gcd != one || stop();
+        };
+
+        utils::PrimeSieve sieve(B1 + 1, B2);
+        for (uint64_t p = sieve.next(); p; p = sieve.next()) {
+            unsigned long long kp = (p + D / 2) / D;
+            unsigned long long kd = kp * D;
+            auto j = static_cast<unsigned>(p > kd ? p - kd : kd - p);
+            if (j >= D / 2 || slot[j] < 0) continue; // p | D, stage 1 had it
+            while (k < kp) {
+                if (flush()) return gcd;
+                advance();
+            }
+            if (!hit[j]) {
+                hit[j] = 1;
+                js_k.push_back(j);
+            }
+        }
+        flush();
+        ++gcds;
+        return BigInt::gcd(prod, n);
+    }
+}
+
+namespace {
+    EcmResult ecm(const BigInt &n, unsigned long long B1, unsigned long long B2, unsigned long long curves,
+                  unsigned threads, uint64_t seed, const utils::StopToken &stop) {
+        EcmResult res;
+        res.metrics.unit = "curves";
+        std::ostringstream log;
+        BigInt one(static_cast<uint64_t>(1));
+
+        if (n <= one) {
+            res.log = "n must be > 1";
+            return res;
+        }
+        if (n.is_even()) {
+            res.success = true;
+            res.factor = BigInt(static_cast<uint64_t>(2));
+            res.log = "n is even, factor=2";
+            return res;
+        }
+        if (B1 < 2) B1 = 2;
+        if (B2 == 0) B2 = B1 > std::numeric_limits<unsigned long long>::max() / 100 ? B1 : 100 * B1;
+        unsigned long long D = B2 > B1 ? pick_d(B1, B2) : 0;
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<unsigned long long>(threads, std::max(1ULL, curves)));
+
+        constexpr uint64_t none = std::numeric_limits<uint64_t>::max();
+        std::atomic<uint64_t> next_curve{0};
+        std::atomic<uint64_t> best{none};
+        std::atomic<unsigned long long> done{0}, stage2_muls{0}, all_muls{0}, gcds{0};
+        std::mutex mu;
+        BigInt best_factor;
+        uint64_t best_sigma = 0;
+        int best_stage = 0;
+
+        auto worker = [&] {
+            ModContext ctx(n); // scratch limbs are per thread
+            for (uint64_t index = next_curve++; index < curves; index = next_curve++) {
+                if (best.load(std::memory_order_relaxed) < index || stop.stop_requested()) return;
+                auto cancelled = [&] { return best.load(std::memory_order_relaxed) < index || stop.stop_requested(); };
+                uint64_t sigma = curve_sigma(seed, index);
+                Point p;
+                BigInt a24;
+                BigInt g = suyama(ctx, sigma, p, a24);
+                int stage = 0;
+                if (g == one) {
+                    Curve curve(ctx, a24);
+                    stage = 1;
+                    g = stage1(ctx, curve, p, B1, cancelled);
+                    ++gcds;
+                    if (g == one && D && !cancelled()) {
+                        stage = 2;
+                        unsigned long long muls = 0, s2_gcds = 0;
+                        g = stage2(ctx, curve, p, B1, B2, D, muls, s2_gcds, cancelled);
+                        stage2_muls += muls;
+                        all_muls += muls;
+                        gcds += s2_gcds;
+                    }
+                    all_muls += curve.muls;
+                }
+                ++done;
+                if (g != one && g != n) {
+                    std::lock_guard<std::mutex> lock(mu);
+                    if (index < best.load()) {
+                        best.store(index);
+                        best_factor = g;
+                        best_sigma = sigma;
+                        best_stage = stage;
+                    }
+                    return;
+                }
+            }
+        };
+
+        std::vector<std::jthread> pool;
+        pool.reserve(threads);
+        for (unsigned t = 0; t < threads; ++t) pool.emplace_back(worker);
+        pool.clear(); // joins
+
+        if (best.load() != none) {
+            res.success = true;
+            res.factor = best_factor;
+            log << "ecm stage" << best_stage << " on curve " << best.load() << " (sigma=" << best_sigma << ", B1=" << B1;
+            if (D) log << ", B2=" << B2 << ", D=" << D;
+            log << ", " << done.load() << " curves run, " << threads << " threads)";
+        } else {
+            res.stopped = stop.stop_requested();
+            log << (res.stopped ? "stopped" : "no factor found") << " (ecm B1=" << B1;
+            if (D) log << " B2=" << B2;
+            log << ", " << done.load() << " curves, " << threads << " threads, seed=" << seed << ", "
+                << stage2_muls.load() << " stage 2 multiplies)";
+        }
+        res.metrics.iterations = done.load();
+        res.metrics.modmuls = all_muls.load();
+        res.metrics.gcds = gcds.load();
+        res.log = log.str();
+        return res;
+    }
+}
+
+EcmResult ecm_factor(const BigInt &n, unsigned long long B1, unsigned long long B2, unsigned long long curves,
+                     unsigned threads, uint64_t seed, const utils::StopToken &stop) {
+    return utils::measure([&] { return ecm(n, B1, B2, curves, threads, seed, stop); });
+}
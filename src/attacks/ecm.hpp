@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
+#include <cstdint>
+#include <string>
+
+struct EcmResult {
+    bool success{false};
+    BigInt factor{static_cast<uint64_t>(0)};
+    bool stopped{false}; // the stop token fired first; log says how far it got
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
+    std::string log;
+};
+
+/*
+ * Lenstra ECM on Montgomery curves (Suyama parametrization, x-only arithmetic).
+ * Finds p when the order of a random curve mod p is B1-smooth up to one prime in (B1, B2].
+ * Rough B1 per factor size: 20 digits 11000, 25 digits 50000, 30 digits 250000,
+ * 35 digits 1000000 (with a few hundred to a few thousand curves).
+ *
+ * @param B2 - stage 2 bound, 0 = 100 * B1, <= B1 disables stage 2
+ * @param curves - number of curves (sigma values) tried
+ * @param threads - workers running curves in parallel (0 = all hardware threads)
+ * @param seed - picks the sigma of every curve; the result only depends on the arguments
+ * @param stop - polled between curves and every 1024 stage 1 primes / stage 2 gcd block
+ */
+EcmResult ecm_factor(const BigInt &n,
+                     unsigned long long B1 = 50000ULL,
+                     unsigned long long B2 = 0ULL,
+                     unsigned long long curves = 200ULL,
+                     unsigned threads = 0,
+                     uint64_t seed = 1,
+                     const utils::StopToken &stop = {});
@@ -1,49 +1,179 @@
 #include "fermat.hpp"
+#include "../mont_word.hpp"
+#include <algorithm>
+#include <cmath>
 #include <sstream>
+#include <vector>
 
 /*
  * Who is Fermat? Doesn't matter:
  * Fermat factorization: for N = p*q with p and q close
  * Bob accidentally chose p and q close, so we can use Fermat's method to factor N.
  * Idea: N = a^2 - b^2 = (a-b)(a+b)
- * So if we can find a and b such that a^2 - b^2 = N, we have factors.
+ * So if we can find a and b such that a^2 - N is a perfect square b^2, we have factors.
  * Start with a = ceil(sqrt(N)), then check if a^2 - N is a perfect square b^2.
  * If not, increment a and repeat, up to max_iters.
+ *
+ * Making it fast:
+ * - a^2 - N is never recomputed: moving from a to a+k adds k*(2a+k).
+ * - for each small modulus m, a^2 - N can only be a square if (a^2 - N) mod m is a square mod m,
+ *   which only depends on a mod m. We sieve blocks of a values with those residue classes
+ *   (64, 63, 65, 11 and a few small primes) and only the survivors (a few in ten thousand)
+ *   pay for a real square test.
+ * - n below 2^64 never touches gmp: a and a^2 - n live in native words and the square test is a
+ *   squares-mod-64 mask plus a double-precision root.
  */
 
-static bool is_perfect_square(const BigInt &x, BigInt &root) {
-    if(x.is_zero()) { root = BigInt(static_cast<uint64_t>(0)); return true; }
-    BigInt r = BigInt::nth_root_floor(x, 2);
-    if(r * r == x) { root = r; return true; }
-    return false;
-}
+namespace {
+    // moduli for the residue sieve: 64, 63 = 9*7, 65 = 5*13 and 11 are the classic filters,
+    // the extra primes each cut the survivors roughly in half again
+    constexpr unsigned kSieveModuli[] = {64, 63, 65, 11, 17, 19, 23, 29, 31, 37, 41, 43, 47};
+    constexpr unsigned long long kBlock = 1ULL << 15;
+
+    struct ResidueFilter {
+        unsigned m;
+        std::vector<unsigned> bad; // residues r of a mod m where a^2 - n is never a square mod m
+    };
+
+    ResidueFilter build_filter(unsigned m, const BigInt &n) {
+        std::vector<bool> is_sq(m, false);
+        for (unsigned s = 0; s < m; ++s) is_sq[(static_cast<unsigned long long>(s) * s) % m] = true;
+        unsigned long long n_mod = mpz_fdiv_ui(n.raw(), m);
+        ResidueFilter f{m, {}};
+        for (unsigned r = 0; r < m; ++r) {
+            unsigned long long v = (static_cast<unsigned long long>(r) * r + m - n_mod) % m;
+            if (!is_sq[v]) f.bad.push_back(r);
+        }
+        return f;
+    }
+
+    // b = sqrt(x) if x is a perfect square (gmp's own residue tests run before the root)
+    bool is_perfect_square(const BigInt &x, BigInt &root) {
+        if (!mpz_perfect_square_p(x.raw())) return false;
+        mpz_sqrt(root.raw(), x.raw());
+        return true;
+    }
+
+    // fermat_factor for n < 2^64 on native words; x = a^2 - n < 2^66 needs the u128
+    FermatResult fermat_word(uint64_t n, unsigned long long max_iters, const utils::StopToken &stop) {
+        using mont::u128;
+        constexpr uint64_t kSquaresMod64 = 0x0202021202030213ULL; // bit i: i is a square mod 64
+        FermatResult fr;
+        fr.metrics.unit = "a values";
+        std::ostringstream log;
+        auto a = static_cast<u128>(std::sqrt(static_cast<double>(n)));
+        while (a * a > n) --a;
+        while ((a + 1) * (a + 1) <= n) ++a;
+        if (a * a == n) {
+            fr.success = true;
+            fr.p = fr.q = BigInt(static_cast<uint64_t>(a));
+            fr.log = "n is perfect square";
+            return fr;
+        }
+        ++a;
+        u128 x = a * a - n;
+        unsigned long long survivors = 0;
+        for (unsigned long long i = 0; i < max_iters; ++i, x += 2 * a + 1, ++a) {
+            if (!(i & (kBlock - 1)) && i && stop.stop_requested()) {
+                log << "stopped after " << i << " iterations (" << survivors << " square candidates, native u64)";
+                fr.metrics.iterations = i;
+                fr.stopped = true;
+                fr.log = log.str();
+                return fr;
+            }
+            if (!((kSquaresMod64 >> (static_cast<unsigned>(x) & 63)) & 1)) continue;
+            ++survivors;
+            auto b = static_cast<u128>(std::sqrt(static_cast<double>(x)));
+            while (b * b > x) --b;
+            while ((b + 1) * (b + 1) <= x) ++b;
+            if (b * b == x) {
+                fr.success = true;
+                fr.p = BigInt(static_cast<uint64_t>(a - b));
+                fr.q = BigInt(static_cast<uint64_t>(a + b));
+                log << "found after " << i << " iterations (" << survivors << " square candidates, native u64)";
+                fr.metrics.iterations = i + 1;
+                fr.log = log.str();
+                return fr;
+            }
+        }
+        log << "not found within iters=" << max_iters << " (" << survivors << " square candidates, native u64)";
+        fr.metrics.iterations = max_iters;
+        fr.log = log.str();
+        return fr;
+    }
+
+    FermatResult fermat_gmp(const BigInt &n, unsigned long long max_iters, const utils::StopToken &stop) {
+        FermatResult fr; std::ostringstream log;
+        fr.metrics.unit = "a values";
+        // trivial checks
+        BigInt two(static_cast<uint64_t>(2));
+        if(n.is_zero()) { log << "n=0"; fr.log = log.str(); return fr; }
+        if(n.is_even()) { fr.success=true; fr.p=two; fr.q=n/two; log<<"even n"; fr.log=log.str(); return fr; }
+        if(n.bit_length() <= 64) return fermat_word(mont::to_u64(n), max_iters, stop);
+
+        // a = ceil(sqrt(n))
+        BigInt a = BigInt::nth_root_floor(n, 2);
+        if(a*a == n) { fr.success=true; fr.p=a; fr.q=a; log<<"n is perfect square"; fr.log=log.str(); return fr; }
+        a += BigInt(static_cast<uint64_t>(1));
+
+        std::vector<ResidueFilter> filters;
+        for (unsigned m : kSieveModuli) filters.push_back(build_filter(m, n));
+
+        BigInt x = a; x *= a; x -= n; // a^2 - n at the current a
+        BigInt b, kk;
+        unsigned long long pos = 0; // offset of the current a from ceil(sqrt(n))
+        unsigned long long survivors = 0;
+        std::vector<unsigned char> dead(kBlock);
 
-FermatResult fermat_factor(const BigInt &n, unsigned long long max_iters) {
-    FermatResult fr; std::ostringstream log;
-    // trivial checks
-    BigInt two(static_cast<uint64_t>(2));
-    if(n.is_zero()) { log << "n=0"; fr.log = log.str(); return fr; }
-    if((n % two).is_zero()) { fr.success=true; fr.p=two; fr.q=n/two; log<<"even n"; fr.log=log.str(); return fr; }
-
-    // a = ceil(sqrt(n))
-    BigInt a = BigInt::nth_root_floor(n, 2);
-    if(a*a < n) a += BigInt(static_cast<uint64_t>(1));
-    BigInt one(static_cast<uint64_t>(1));
-    for(unsigned long long i=0;i<max_iters;i++) {
-        BigInt x = a*a - n; // candidate square
-        BigInt b; // root holder
-        if(!x.is_zero()) {
-            if(is_perfect_square(x, b)) {
-                BigInt p = a - b;
-                BigInt q = a + b;
-                if(p*q == n) {
-                    fr.success=true; fr.p=p; fr.q=q; log<<"found after "<<i<<" iterations"; fr.log=log.str(); return fr; }
+        for (unsigned long long base = 0; base < max_iters; base += kBlock) {
+            if (base && stop.stop_requested()) {
+                log << "stopped after " << base << " iterations (" << survivors << " sieve survivors)";
+                fr.metrics.iterations = base;
+                fr.stopped = true;
+                fr.log = log.str();
+                return fr;
+            }
+            unsigned long long len = std::min(kBlock, max_iters - base);
+            std::fill(dead.begin(), dead.begin() + static_cast<std::ptrdiff_t>(len), 0);
+
+            // strike every a in [base, base+len) whose residue class rules out a square
+            for (const auto &f : filters) {
+                // residue of (a_start + base) mod m, from the current a which sits at offset pos
+                unsigned long long a_mod = (mpz_fdiv_ui(a.raw(), f.m) + (base - pos) % f.m) % f.m;
+                for (unsigned r : f.bad) {
+                    unsigned long long first = (r + f.m - a_mod) % f.m;
+                    for (unsigned long long i = first; i < len; i += f.m) dead[i] = 1;
+                }
+            }
+
+            for (unsigned long long i = 0; i < len; ++i) {
+                if (dead[i]) continue;
+                ++survivors;
+                // jump a from offset pos to base+i: x += k*(2a + k)
+                unsigned long long k = base + i - pos;
+                if (k) {
+                    mpz_addmul_ui(x.raw(), a.raw(), 2 * k);
+                    mpz_set_ui(kk.raw(), k);
+                    mpz_mul_ui(kk.raw(), kk.raw(), k);
+                    x += kk;
+                    mpz_add_ui(a.raw(), a.raw(), k);
+                    pos = base + i;
+                }
+                if (is_perfect_square(x, b)) {
+                    BigInt p = a - b;
+                    BigInt q = a + b;
+                    fr.success=true; fr.p=p; fr.q=q;
+                    log<<"found after "<<pos<<" iterations ("<<survivors<<" sieve survivors)";
+                    fr.metrics.iterations = pos + 1;
+                    fr.log=log.str(); return fr;
+                }
             }
-        } else { // a*a == n rare perfect square case
-            fr.success=true; fr.p=a; fr.q=a; log<<"n is perfect square"; fr.log=log.str(); return fr;
         }
-        a += one; // next a
+        log<<"not found within iters="<<max_iters<<" ("<<survivors<<" sieve survivors)";
+        fr.metrics.iterations = max_iters; fr.log=log.str(); return fr;
     }
-    log<<"not found within iters="<<max_iters; fr.log=log.str(); return fr;
 }
 
+FermatResult fermat_factor(const BigInt &n, unsigned long long max_iters, const utils::StopToken &stop) {
+    return utils::measure([&] { return fermat_gmp(n, max_iters, stop); });
+}
@@ -1,14 +1,20 @@
 #pragma once
 
 #include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
 #include <string>
 
 struct FermatResult {
     bool success{false};
     BigInt p{static_cast<uint64_t>(0)};
     BigInt q{static_cast<uint64_t>(0)};
+    bool stopped{false}; // the stop token fired first; log says how far it got
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
     std::string log;
 };
 
-FermatResult fermat_factor(const BigInt &n, unsigned long long max_iters = 1000000ULL);
+// `stop` is polled once per block of 32768 a values
+FermatResult fermat_factor(const BigInt &n, unsigned long long max_iters = 1000000ULL,
+                           const utils::StopToken &stop = {});
 
@@ -0,0 +1,188 @@
+#include "lehman.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+/*
+ * Fermat only likes p ≈ q. If instead v*p ≈ u*q for small u, v then 4uv*n = (2vp)(2uq)
+ * is a product of two close numbers, so fermat on 4kn with k = u*v finds it right away:
+ * a = vp + uq, b = vp - uq, a^2 - 4kn = b^2 and gcd(a + b, n) = p.
+ * Lehman walks k upwards and for each k tries a few a above ceil(sqrt(4kn)).
+ * Hart's one line factoring is the same idea with a single candidate per multiplier:
+ * s = ceil(sqrt(i*n)), and s^2 mod n being a square t^2 gives gcd(s - t, n).
+ *
+ * Both are embarrassingly parallel over the multiplier, so worker threads grab chunks of
+ * k from a shared counter and stop on the first factor or when the time budget runs out.
+ * (Lehman's full algorithm also trial divides up to n^(1/3); that's left to trial division.)
+ */
+
+namespace {
+    constexpr unsigned long long kChunk = 1024;
+
+    bool sqrt_if_square(const BigInt &x, BigInt &root) {
+        if (!mpz_perfect_square_p(x.raw())) return false;
+        mpz_sqrt(root.raw(), x.raw());
+        return true;
+    }
+
+    struct Hit {
+        BigInt factor;
+        unsigned long long k{0};
+    };
+
+    /*
+     * Runs make_worker()(k, factor) for k = 1..max_k on `threads` threads.
+     * Each thread builds its own worker so scratch BigInts are never shared.
+     */
+    template<typename MakeWorker>
+    LehmanResult search_multipliers(const BigInt &n, unsigned long long max_k, unsigned threads,
+                                    unsigned long long time_budget_ms, const utils::StopToken &stop,
+                                    const char *name, MakeWorker make_worker) {
+        utils::MetricsClock clock;
+        LehmanResult res;
+        res.metrics.unit = "multipliers";
+        std::ostringstream log;
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::milliseconds(time_budget_ms);
+        std::atomic<unsigned long long> next{1};
+        std::atomic<unsigned long long> done{0};
+        std::atomic<bool> halt{false};
+        bool timed_out = false, stopped = false;
+        std::mutex mu;
+        Hit hit;
+
+        auto run = [&] {
+            auto worker = make_worker();
+            BigInt factor;
+            while (!halt.load(std::memory_order_relaxed)) {
+                unsigned long long lo = next.fetch_add(kChunk);
+                if (lo > max_k) return;
+                unsigned long long hi = std::min(max_k, lo + kChunk - 1);
+                for (unsigned long long k = lo; k <= hi; ++k) {
+                    if (worker(k, factor)) {
+                        done += k - lo + 1;
+                        std::lock_guard<std::mutex> lock(mu);
+                        if (!halt.exchange(true)) { hit.factor = factor; hit.k = k; }
+                        return;
+                    }
+                }
+                done += hi - lo + 1;
+                if (time_budget_ms && std::chrono::steady_clock::now() >= deadline) {
+                    std::lock_guard<std::mutex> lock(mu);
+                    timed_out = true;
+                    halt = true;
+                }
+                if (stop.stop_requested()) {
+                    std::lock_guard<std::mutex> lock(mu);
+                    stopped = true;
+                    halt = true;
+                }
+            }
+        };
+
+        std::vector<std::jthread> pool;
+        pool.reserve(threads);
+        for (unsigned t = 0; t < threads; ++t) pool.emplace_back(run);
+        pool.clear();
+
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        if (!hit.factor.is_zero()) {
+            BigInt other = n / hit.factor;
+            res.success = true;
+            res.p = hit.factor < other ? hit.factor : other;
+            res.q = hit.factor < other ? other : hit.factor;
+            log << name << " hit at k=" << hit.k << " after " << ms << " ms (" << threads << " threads)";
+        } else {
+            res.stopped = stopped;
+            log << name << " no factor for k <= " << std::min(max_k, done.load()) << " (" << ms << " ms, "
+                << threads << " threads" << (timed_out ? ", time budget hit" : "") << (stopped ? ", stopped" : "") << ")";
+        }
+        res.metrics.iterations = done.load();
+        clock.stamp(res.metrics);
+        res.log = log.str();
+        return res;
+    }
+
+    bool trivial(const BigInt &n, LehmanResult &res) {
+        BigInt two(static_cast<uint64_t>(2));
+        if (n < BigInt(static_cast<uint64_t>(4))) { res.log = "n must be > 3"; return true; }
+        if (n.is_even()) { res.success = true; res.p = two; res.q = n / two; res.log = "even n"; return true; }
+        return false;
+    }
+}
+
+LehmanResult lehman_factor(const BigInt &n, unsigned long long max_k, unsigned long long a_window,
+                           unsigned threads, unsigned long long time_budget_ms, const utils::StopToken &stop) {
+    LehmanResult res;
+    if (trivial(n, res)) return res;
+
+    // lehman's bounds: k <= n^(1/3), a - sqrt(4kn) <= n^(1/6) / (4 sqrt k)
+    BigInt cube = BigInt::nth_root_floor(n, 3);
+    if (cube.bit_length() < 64) max_k = std::min<unsigned long long>(max_k, mpz_get_ui(cube.raw()) + 1);
+    double sixth = mpz_get_d(BigInt::nth_root_floor(n, 6).raw());
+    if (a_window == 0) a_window = 1;
+
+    auto make_worker = [&] {
+        return [&, four_n = n * BigInt(static_cast<uint64_t>(4)), kn = BigInt(), a = BigInt(), b2 = BigInt(),
+                b = BigInt(), rem = BigInt()](unsigned long long k, BigInt &factor) mutable {
+            mpz_mul_ui(kn.raw(), four_n.raw(), k);
+            mpz_sqrtrem(a.raw(), rem.raw(), kn.raw());
+            if (!rem.is_zero()) mpz_add_ui(a.raw(), a.raw(), 1);
+            b2 = a;
+            b2 *= a;
+            b2 -= kn;
+            double bound = sixth / (4.0 * std::sqrt(static_cast<double>(k))) + 1.0;
+            unsigned long long window = bound < static_cast<double>(a_window)
+                                            ? static_cast<unsigned long long>(bound) : a_window;
+            for (unsigned long long w = 0; w < std::max(window, 1ULL); ++w) {
+                if (sqrt_if_square(b2, b)) {
+                    b += a;
+                    factor = BigInt::gcd(b, n);
+                    if (factor != BigInt(static_cast<uint64_t>(1)) && factor != n) return true;
+                }
+                // (a+1)^2 - 4kn = b2 + 2a + 1
+                mpz_addmul_ui(b2.raw(), a.raw(), 2);
+                mpz_add_ui(b2.raw(), b2.raw(), 1);
+                mpz_add_ui(a.raw(), a.raw(), 1);
+            }
+            return false;
+        };
+    };
+    return search_multipliers(n, max_k, threads, time_budget_ms, stop, "lehman", make_worker);
+}
+
+LehmanResult hart_olf(const BigInt &n, unsigned long long max_i, unsigned threads, unsigned long long time_budget_ms,
+                      const utils::StopToken &stop) {
+    LehmanResult res;
+    if (trivial(n, res)) return res;
+
+    auto make_worker = [&] {
+        return [&, ni = BigInt(), s = BigInt(), m = BigInt(), t = BigInt(), rem = BigInt()]
+                (unsigned long long i, BigInt &factor) mutable {
+            mpz_mul_ui(ni.raw(), n.raw(), i);
+            mpz_sqrtrem(s.raw(), rem.raw(), ni.raw());
+            if (rem.is_zero()) {
+                // i*n itself is a square: s shares a factor with n unless i absorbs it
+                factor = BigInt::gcd(s, n);
+                return factor != BigInt(static_cast<uint64_t>(1)) && factor != n;
+            }
+            mpz_add_ui(s.raw(), s.raw(), 1);
+            m = s;
+            m *= s;
+            m -= ni;
+            if (!(m < n)) m %= n;
+            if (!sqrt_if_square(m, t)) return false;
+            s -= t;
+            factor = BigInt::gcd(s, n);
+            return factor != BigInt(static_cast<uint64_t>(1)) && factor != n;
+        };
+    };
+    return search_multipliers(n, max_i, threads, time_budget_ms, stop, "hart", make_worker);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
+#include <string>
+
+struct LehmanResult {
+    bool success{false};
+    BigInt p{static_cast<uint64_t>(0)};
+    BigInt q{static_cast<uint64_t>(0)};
+    bool stopped{false}; // the stop token fired first; log says how far it got
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
+    std::string log;
+};
+
+/*
+ * Lehman's method: fermat on 4*k*n for k = 1..max_k.
+ * Finds p, q quickly when p/q is close to a ratio u/v with small u*v (k = u*v),
+ * e.g. keys generated as p ≈ 2q or 3p ≈ 5q where plain fermat never gets there.
+ *
+ * @param max_k - largest multiplier tried (also capped by lehman's n^(1/3) bound)
+ * @param a_window - a values scanned per k above ceil(sqrt(4kn)) (capped by n^(1/6)/(4 sqrt k))
+ * @param threads - workers splitting the k range (0 = all hardware threads)
+ * @param time_budget_ms - wall clock budget, 0 = none
+ * @param stop - polled with the budget, after every chunk of multipliers
+ */
+LehmanResult lehman_factor(const BigInt &n,
+                           unsigned long long max_k = 10000000ULL,
+                           unsigned long long a_window = 16ULL,
+                           unsigned threads = 0,
+                           unsigned long long time_budget_ms = 5000ULL,
+                           const utils::StopToken &stop = {});
+
+/*
+ * Hart's one line factoring: s = ceil(sqrt(i*n)), test s^2 mod n for a square t^2,
+ * then gcd(s - t, n). One candidate per multiplier i, same near-ratio sweet spot as lehman.
+ */
+LehmanResult hart_olf(const BigInt &n,
+                      unsigned long long max_i = 100000000ULL,
+                      unsigned threads = 0,
+                      unsigned long long time_budget_ms = 5000ULL,
+                      const utils::StopToken &stop = {});
@@ -14,22 +14,37 @@
  * Since m^e < N (if m < min(n_i)), the attacker can then compute the integer e-th root of m^e to recover m.
  */
 
-static BigInt crt(const std::vector<BigInt>& residues, const std::vector<BigInt>& moduli) {
+// term i is Mi * (inv_i * r_i mod n_i) < N, so the sum only needs conditional subtractions mod N
+// nullopt when `stop` fired between two terms
+static std::optional<BigInt> crt(const std::vector<BigInt>& residues, const std::vector<BigInt>& moduli,
+                                 const utils::StopToken &stop, utils::Metrics &metrics) {
     BigInt N(static_cast<uint64_t>(1));
     for(const auto& m : moduli) N *= m;
+    ModContext big(N);
     BigInt x(static_cast<uint64_t>(0));
+    BigInt t;
     for(size_t i=0;i<moduli.size();++i) {
+        if(stop.stop_requested()) return std::nullopt;
         BigInt Mi = N / moduli[i];
         auto inv = BigInt::mod_inverse(Mi % moduli[i], moduli[i]);
         if(!inv) throw std::runtime_error("crt inverse fail");
-        x += Mi * (*inv) * residues[i];
-        x %= N;
+        ModContext small(moduli[i]);
+        BigInt inv_m = *inv, r = residues[i];
+        small.to_mont(inv_m);
+        small.reduce(r);
+        small.mulmod(t, inv_m, r); // montgomery * normal = normal
+        ++metrics.iterations;
+        ++metrics.modmuls;
+        ++metrics.gcds; // the inverse
+        t *= Mi;
+        big.addmod(x, x, t);
     }
     return x;
 }
 
-LoweResult low_e_broadcast(const std::vector<LoweTarget>& targets, unsigned e) {
-    LoweResult result{false, BigInt(static_cast<uint64_t>(0)), ""};
+static LoweResult low_e_run(const std::vector<LoweTarget>& targets, unsigned e, const utils::StopToken &stop) {
+    LoweResult result;
+    result.metrics.unit = "crt terms";
     if(targets.size() < e) { result.log = "need at least e targets"; return result; }
     std::vector<BigInt> residues; residues.reserve(targets.size());
     std::vector<BigInt> moduli; moduli.reserve(targets.size());
@@ -38,7 +53,13 @@ LoweResult low_e_broadcast(const std::vector<LoweTarget>& targets, unsigned e) {
         moduli.push_back(t.n);
     }
     try {
-        BigInt combined = crt(residues, moduli);
+        auto crt_value = crt(residues, moduli, stop, result.metrics);
+        if(!crt_value || stop.stop_requested()) {
+            result.stopped = true;
+            result.log = crt_value ? "stopped before the e-th root" : "stopped during crt";
+            return result;
+        }
+        BigInt combined = *crt_value;
         BigInt m = BigInt::nth_root_floor(combined, e);
         BigInt exact(static_cast<uint64_t>(1));
         for(unsigned i=0;i<e;i++) exact *= m;
@@ -55,3 +76,7 @@ LoweResult low_e_broadcast(const std::vector<LoweTarget>& targets, unsigned e) {
     }
     return result;
 }
+
+LoweResult low_e_broadcast(const std::vector<LoweTarget>& targets, unsigned e, const utils::StopToken &stop) {
+    return utils::measure([&] { return low_e_run(targets, e, stop); });
+}
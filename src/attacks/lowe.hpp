@@ -1,11 +1,20 @@
 #pragma once
 
 #include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
 #include <vector>
 #include <string>
 
 struct LoweTarget { BigInt n; BigInt c; };
-struct LoweResult { bool success; BigInt m; std::string log; };
+struct LoweResult {
+    bool success{false};
+    BigInt m{static_cast<uint64_t>(0)};
+    bool stopped{false};
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
+    std::string log;
+};
 
-LoweResult low_e_broadcast(const std::vector<LoweTarget>& targets, unsigned e);
+// `stop` is polled between crt terms and before the e-th root
+LoweResult low_e_broadcast(const std::vector<LoweTarget>& targets, unsigned e, const utils::StopToken &stop = {});
 
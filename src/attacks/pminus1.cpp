@@ -1,81 +1,130 @@
 #include "pminus1.hpp"
 #include <sstream>
 #include <vector>
-#include <algorithm>
 
 /*
  * Pollard's p-1 factorization (Stage 1 + optional Stage 2)
  * Stage 1 finds a factor when p-1 is B1-smooth.
  * Stage 2 extends when p-1 has a large prime factor between B1 and B2 with remaining part B1-smooth.
+ *
+ * Stage 1 raises a to E = prod p^floor(log_p B1) one ~64k-bit chunk of E at a time
+ * (smooth::ExponentChunks), so each chunk is a single powm (gmp's windowed exponentiation only
+ * pays its table setup once per chunk). gcd(a - 1, n) is checked after every chunk, which is
+ * cheap next to 64k squarings and lets us stop early or back up when everything collapses to n.
+ *
+ * Stage 2 hands V_1 = a + a^-1 to smooth::stage2 (baby-step giant-step or polynomial
+ * continuation over V_i = a^i + a^-i).
  */
 
-// sieve primes up to limit
-static std::vector<unsigned> primes_up_to(unsigned long long limit) {
-    std::vector<unsigned> primes;
-    if (limit < 2ULL) return primes;
-    std::vector<bool> sieve(limit + 1ULL, true);
-    sieve[0] = false; sieve[1] = false;
-    for (unsigned long long i = 2ULL; i * i <= limit; ++i) {
-        if (sieve[i]) {
-            for (unsigned long long j = i * i; j <= limit; j += i) sieve[j] = false;
+namespace {
+    struct Stage1 {
+        BigInt g;                      // gcd(a - 1, n) where stage 1 stopped
+        unsigned long long chunks{0};  // exponent chunks used
+        unsigned long long powms{0};   // chunk powms plus word powms of replays
+        unsigned long long gcds{0};
+        unsigned long long squarings{0}; // exponent bits, about one modular squaring each
+        bool stopped{false};           // `stop` fired before E was used up
+    };
+
+    /*
+     * a = a^E mod n for the B1 stage 1 exponent. Stops at the first chunk with a proper gcd.
+     * If a chunk takes gcd straight from 1 to n, it is replayed word by word from the saved a.
+     * `stop` is polled after every chunk.
+     */
+    Stage1 stage1(BigInt &a, const BigInt &n, unsigned long long B1, const utils::StopToken &stop) {
+        Stage1 st;
+        BigInt one(static_cast<uint64_t>(1));
+        BigInt e, saved, am1;
+        std::vector<uint64_t> words;
+        smooth::ExponentChunks chunks(B1);
+
+        st.g = one;
+        while (chunks.next(e, words)) {
+            saved = a;
+            mpz_powm(a.raw(), a.raw(), e.raw(), n.raw());
+            ++st.chunks;
+            ++st.powms;
+            st.squarings += e.bit_length();
+            am1 = a - one;
+            st.g = BigInt::gcd(am1, n);
+            ++st.gcds;
+            if (st.g == n) {
+                a = saved;
+                for (uint64_t w : words) {
+                    mpz_powm_ui(a.raw(), a.raw(), w, n.raw());
+                    ++st.powms;
+                    am1 = a - one;
+                    st.g = BigInt::gcd(am1, n);
+                    ++st.gcds;
+                    if (st.g != one) break;
+                }
+            }
+            if (st.g != one) return st;
+            if (stop.stop_requested()) {
+                st.stopped = true;
+                return st;
+            }
         }
+        return st;
     }
-    for (unsigned long long i = 2ULL; i <= limit; ++i) if (sieve[i]) primes.push_back(static_cast<unsigned>(i));
-    return primes;
 }
 
-static unsigned long long max_prime_power_leq(unsigned p, unsigned long long B) {
-    unsigned long long pk = p;
-    while (pk * p <= B) pk *= p;
-    return pk;
-}
-
-PMinus1Result pollards_pminus1(const BigInt &n,
-                               unsigned long long B1,
-                               unsigned long long max_a_trials,
-                               unsigned long long B2) {
-    PMinus1Result r; std::ostringstream log;
-    BigInt one(static_cast<uint64_t>(1));
-    BigInt two(static_cast<uint64_t>(2));
-
-    if (n.is_zero()) { r.log = "n=0"; return r; }
-    if ((n % two).is_zero()) { r.success = true; r.factor = two; r.log = "even n"; return r; }
+namespace {
+    PMinus1Result pminus1(const BigInt &n, unsigned long long B1, unsigned long long max_a_trials,
+                          unsigned long long B2, PMinus1Stage2 stage2, const utils::StopToken &stop) {
+        PMinus1Result r; std::ostringstream log;
+        r.metrics.unit = "bases";
+        BigInt one(static_cast<uint64_t>(1));
+        BigInt two(static_cast<uint64_t>(2));
 
-    unsigned long long prime_limit = std::max(B1, B2);
-    auto primes = primes_up_to(prime_limit);
+        if (n.is_zero()) { r.log = "n=0"; return r; }
+        if ((n % two).is_zero()) { r.success = true; r.factor = two; r.log = "even n"; return r; }
 
-    unsigned bases[] = {2,3,5,7,11,13,17,19,23};
-    unsigned tried = 0;
-    for (unsigned bi = 0; bi < sizeof(bases)/sizeof(bases[0]) && tried < max_a_trials; ++bi, ++tried) {
-        BigInt a(static_cast<uint64_t>(bases[bi]));
-        a %= n; if (a.is_zero()) continue;
+        unsigned bases[] = {2,3,5,7,11,13,17,19,23};
+        unsigned tried = 0;
+        for (unsigned bi = 0; bi < sizeof(bases)/sizeof(bases[0]) && tried < max_a_trials; ++bi, ++tried) {
+            BigInt a(static_cast<uint64_t>(bases[bi]));
+            a %= n; if (a.is_zero()) continue;
 
-        // stage 1 powering
-        for (unsigned p : primes) {
-            if ((unsigned long long)p > B1) break;
-            unsigned long long pk = max_prime_power_leq(p, B1);
-            BigInt e_pk(static_cast<uint64_t>(pk));
-            a = BigInt::powm(a, e_pk, n);
-        }
-        BigInt g = BigInt::gcd(a - one, n);
-        if (g != one && g != n) { r.success = true; r.factor = g; log << "stage1 base=" << bases[bi] << " B1=" << B1; r.log = log.str(); return r; }
+            // stage 1 powering
+            Stage1 st = stage1(a, n, B1, stop);
+            ++r.metrics.iterations;
+            r.metrics.powms += st.powms;
+            r.metrics.gcds += st.gcds;
+            r.metrics.modmuls += st.squarings;
+            BigInt g = st.g;
+            if (g != one && g != n) { r.success = true; r.factor = g; log << "stage1 base=" << bases[bi] << " B1=" << B1 << " powm chunks=" << st.chunks; r.log = log.str(); return r; }
+            if (st.stopped) { r.stopped = true; log << "stopped in stage1 base=" << bases[bi] << " after " << st.chunks << " powm chunks (B1=" << B1 << ")"; r.log = log.str(); return r; }
 
-        // stage 2 optional
-        if (B2 > B1) {
-            // simple stage 2: for each prime q in (B1, B2] test gcd(a^q - 1, n)
-            for (unsigned p : primes) {
-                if ((unsigned long long)p <= B1) continue;
-                if ((unsigned long long)p > B2) break;
-                BigInt exp_p(static_cast<uint64_t>(p));
-                BigInt a_q = BigInt::powm(a, exp_p, n);
-                BigInt g2 = BigInt::gcd(a_q - one, n);
-                if (g2 != one && g2 != n) { r.success = true; r.factor = g2; log << "stage2 base=" << bases[bi] << " B1=" << B1 << " B2=" << B2 << " prime=" << p; r.log = log.str(); return r; }
+            // stage 2 optional
+            if (B2 > B1 && g == one) {
+                auto ainv = BigInt::mod_inverse(a, n);
+                if (!ainv) {
+                    g = BigInt::gcd(a, n);
+                    if (g != one && g != n) { r.success = true; r.factor = g; log << "stage2 base=" << bases[bi] << " gcd(a, n)"; r.log = log.str(); return r; }
+                    continue;
+                }
+                ModContext ctx(n);
+                smooth::Stage2Result s2 = smooth::stage2(ctx, (a + *ainv) % n, B1, B2, stage2, stop);
+                r.metrics.modmuls += s2.muls;
+                r.metrics.gcds += s2.gcds;
+                if (s2.g != one && s2.g != n) { r.success = true; r.factor = s2.g; log << "stage2 base=" << bases[bi] << " B1=" << B1 << " B2=" << B2 << " (" << s2.how << ", " << s2.muls << " multiplies)"; r.log = log.str(); return r; }
+                if (s2.stopped) { r.stopped = true; log << "stopped in stage2 base=" << bases[bi] << " after " << s2.muls << " multiplies (B1=" << B1 << " B2=" << B2 << ")"; r.log = log.str(); return r; }
             }
         }
+
+        log << "no factor found (p-1) B1=" << B1;
+        if (B2 > B1) log << " B2=" << B2; log << " trials=" << max_a_trials;
+        r.log = log.str();
+        return r;
     }
+}
 
-    log << "no factor found (p-1) B1=" << B1;
-    if (B2 > B1) log << " B2=" << B2; log << " trials=" << max_a_trials;
-    r.log = log.str();
-    return r;
+PMinus1Result pollards_pminus1(const BigInt &n,
+                               unsigned long long B1,
+                               unsigned long long max_a_trials,
+                               unsigned long long B2,
+                               PMinus1Stage2 stage2,
+                               const utils::StopToken &stop) {
+    return utils::measure([&] { return pminus1(n, B1, max_a_trials, B2, stage2, stop); });
 }
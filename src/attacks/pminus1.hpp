@@ -1,15 +1,25 @@
 #pragma once
 
 #include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "smooth.hpp"
 #include <string>
 
 struct PMinus1Result {
     bool success{false};
     BigInt factor{static_cast<uint64_t>(0)};
+    bool stopped{false}; // the stop token fired first; log says how far it got
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
     std::string log;
 };
 
+// stage 2 flavour, see smooth::Stage2Mode
+using PMinus1Stage2 = smooth::Stage2Mode;
+
+// `stop` is polled after every stage 1 powm chunk and every stage 2 gcd block
 PMinus1Result pollards_pminus1(const BigInt &n,
                                unsigned long long B1 = 100000ULL,
                                unsigned long long max_a_trials = 5ULL,
-                               unsigned long long B2 = 0ULL);
+                               unsigned long long B2 = 0ULL,
+                               PMinus1Stage2 stage2 = PMinus1Stage2::Auto,
+                               const utils::StopToken &stop = {});
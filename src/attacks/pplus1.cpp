@@ -0,0 +1,160 @@
+#include "pplus1.hpp"
+#include <sstream>
+#include <vector>
+
+/*
+ * Williams' p+1 factorization (Stage 1 + optional Stage 2)
+ * Work in F_p[X]/(X^2 - A X + 1): its root alpha has norm 1, and when A^2 - 4 is a non-residue
+ * mod p, alpha lives in the norm-1 subgroup of F_(p^2)*, of order p + 1. With E a multiple of
+ * p + 1, alpha^E = 1, so V_E = alpha^E + alpha^-E = 2 mod p and gcd(V_E - 2, n) finds p.
+ * Only V is ever needed, and V_E(A) is a lucas chain:
+ *   V_2k = V_k^2 - 2,   V_(2k+1) = V_k V_(k+1) - A
+ * one multiply and one square per exponent bit, inside a ModContext.
+ *
+ * The exponent comes from the same smooth::ExponentChunks as p-1's stage 1, with the gcd after
+ * every chunk and a word by word replay if a chunk collapses straight to n. Stage 2 is p-1's
+ * smooth::stage2 on V_E, which is already the x + x^-1 it wants.
+ */
+
+namespace {
+    struct Seed {
+        unsigned num, den;
+    };
+    // 2/7 and 6/5 are montgomery's picks (group orders divisible by 6 and 4), then small integers
+    constexpr Seed kSeeds[] = {{2, 7}, {6, 5}, {3, 1}, {4, 1}, {5, 1}, {7, 1}, {8, 1}, {9, 1}, {10, 1}};
+
+    struct Stage1 {
+        BigInt g;                      // gcd(V - 2, n) where stage 1 stopped
+        unsigned long long chunks{0};  // lucas chains run
+        unsigned long long gcds{0};
+        unsigned long long muls{0};    // two per exponent bit
+        bool stopped{false};           // `stop` fired before E was used up
+    };
+
+    // v = V_E(v) (ctx form) for the B1 stage 1 exponent, `stop` polled after every chunk
+    Stage1 stage1(ModContext &ctx, BigInt &v, unsigned long long B1, const utils::StopToken &stop) {
+        Stage1 st;
+        const BigInt &n = ctx.modulus();
+        BigInt one(static_cast<uint64_t>(1));
+        BigInt two(static_cast<uint64_t>(2));
+        BigInt e, saved, vm2;
+        std::vector<uint64_t> words;
+        smooth::ExponentChunks chunks(B1);
+
+        auto check = [&] {
+            vm2 = v;
+            ctx.from_mont(vm2);
+            vm2 -= two;
+            if (vm2 < BigInt()) vm2 += n;
+            st.g = BigInt::gcd(vm2, n);
+            ++st.gcds;
+        };
+
+        st.g = one;
+        while (chunks.next(e, words)) {
+            saved = v;
+            smooth::lucas_v(ctx, v, saved, e);
+            ++st.chunks;
+            st.muls += 2 * e.bit_length();
+            check();
+            if (st.g == n) {
+                v = saved;
+                for (uint64_t w : words) {
+                    smooth::lucas_v(ctx, v, BigInt(v), w);
+                    st.muls += 2 * static_cast<unsigned long long>(64 - __builtin_clzll(w));
+                    check();
+                    if (st.g != one) break;
+                }
+            }
+            if (st.g != one) return st;
+            if (stop.stop_requested()) {
+                st.stopped = true;
+                return st;
+            }
+        }
+        return st;
+    }
+}
+
+namespace {
+    PPlus1Result pplus1(const BigInt &n, unsigned long long B1, unsigned long long max_seeds,
+                        unsigned long long B2, smooth::Stage2Mode stage2, const utils::StopToken &stop) {
+        PPlus1Result r;
+        r.metrics.unit = "seeds";
+        std::ostringstream log;
+        BigInt one(static_cast<uint64_t>(1));
+        BigInt two(static_cast<uint64_t>(2));
+
+        if (n <= one) { r.log = "n must be > 1"; return r; }
+        if (n.is_even()) { r.success = true; r.factor = two; r.log = "even n"; return r; }
+
+        ModContext ctx(n);
+        unsigned long long tried = 0;
+        for (const Seed &s : kSeeds) {
+            if (tried >= max_seeds) break;
+            ++tried;
+            BigInt den(static_cast<uint64_t>(s.den));
+            auto inv = BigInt::mod_inverse(den, n);
+            if (!inv) {
+                BigInt g = BigInt::gcd(den, n);
+                r.success = true; r.factor = g; log << "seed " << s.num << "/" << s.den << " denominator shares " << g << " with n";
+                r.log = log.str();
+                return r;
+            }
+            BigInt a = BigInt(static_cast<uint64_t>(s.num)) * *inv % n;
+            std::ostringstream seed;
+            seed << s.num;
+            if (s.den != 1) seed << "/" << s.den;
+
+            BigInt v = a;
+            ctx.to_mont(v);
+            Stage1 st = stage1(ctx, v, B1, stop);
+            ++r.metrics.iterations;
+            r.metrics.modmuls += st.muls;
+            r.metrics.gcds += st.gcds;
+            if (st.g != one && st.g != n) {
+                r.success = true; r.factor = st.g;
+                log << "stage1 seed=" << seed.str() << " B1=" << B1 << " lucas chunks=" << st.chunks;
+                r.log = log.str();
+                return r;
+            }
+            if (st.stopped) {
+                r.stopped = true;
+                log << "stopped in stage1 seed=" << seed.str() << " after " << st.chunks << " lucas chunks (B1=" << B1 << ")";
+                r.log = log.str();
+                return r;
+            }
+
+            if (B2 > B1 && st.g == one) {
+                ctx.from_mont(v);
+                smooth::Stage2Result s2 = smooth::stage2(ctx, v, B1, B2, stage2, stop);
+                r.metrics.modmuls += s2.muls;
+                r.metrics.gcds += s2.gcds;
+                if (s2.g != one && s2.g != n) {
+                    r.success = true; r.factor = s2.g;
+                    log << "stage2 seed=" << seed.str() << " B1=" << B1 << " B2=" << B2 << " (" << s2.how << ", " << s2.muls << " multiplies)";
+                    r.log = log.str();
+                    return r;
+                }
+                if (s2.stopped) {
+                    r.stopped = true;
+                    log << "stopped in stage2 seed=" << seed.str() << " after " << s2.muls << " multiplies (B1=" << B1
+                        << " B2=" << B2 << ")";
+                    r.log = log.str();
+                    return r;
+                }
+            }
+        }
+
+        log << "no factor found (p+1) B1=" << B1;
+        if (B2 > B1) log << " B2=" << B2;
+        log << " seeds=" << tried;
+        r.log = log.str();
+        return r;
+    }
+}
+
+PPlus1Result williams_pplus1(const BigInt &n, unsigned long long B1, unsigned long long max_seeds,
+                             unsigned long long B2, smooth::Stage2Mode stage2, const utils::StopToken &stop) {
+    return utils::measure([&] { return pplus1(n, B1, max_seeds, B2, stage2, stop); });
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "smooth.hpp"
+#include <string>
+
+struct PPlus1Result {
+    bool success{false};
+    BigInt factor{static_cast<uint64_t>(0)};
+    bool stopped{false}; // the stop token fired first; log says how far it got
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
+    std::string log;
+};
+
+/*
+ * Williams' p+1: finds p when p+1 is B1-smooth (up to one prime in (B1, B2] with stage 2).
+ * A seed only works for p when seed^2 - 4 is a non-residue mod p (otherwise it degenerates
+ * into p-1), so a few seeds are tried; each costs about as much as one p-1 base.
+ *
+ * @param max_seeds - seeds tried, from 2/7, 6/5, 3, 4, 5, 7, 8, 9, 10
+ * @param B2 - stage 2 bound, <= B1 disables stage 2
+ * @param stop - polled after every stage 1 lucas chunk and every stage 2 gcd block
+ */
+PPlus1Result williams_pplus1(const BigInt &n,
+                             unsigned long long B1 = 100000ULL,
+                             unsigned long long max_seeds = 3ULL,
+                             unsigned long long B2 = 0ULL,
+                             smooth::Stage2Mode stage2 = smooth::Stage2Mode::Auto,
+                             const utils::StopToken &stop = {});
@@ -1,5 +1,15 @@
 #include "rho.hpp"
+#include "squfof.hpp"
+#include "../mont_lanes.hpp"
 #include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
 
 /*
  * Symbol of rho is "ρ", a bit disappointing.
@@ -9,11 +19,318 @@
  * sequence and the birthday paradox.
  *
  * The algorithm uses a function f(x) = (x^2 + c) mod N for some constant c.
- * We iterate x_i = f(x_{i-1}) and detect cycles using Floyd's tortoise-hare.
- * When we find a cycle, gcd(|x_slow - x_fast|, N) might give us a factor.
+ * We iterate x_i = f(x_{i-1}) and detect cycles using Brent's variant:
+ * y runs ahead while x is parked at powers of two, so each step costs one squaring
+ * instead of Floyd's three.
+ * The differences |x - y| are multiplied into a running product q mod N and
+ * gcd(q, N) is only taken every `batch` steps. If the batched gcd collapses to N
+ * we back up to the last saved y and redo that block one gcd at a time.
+ *
+ * With RhoBackend::Lanes the same brent schedule runs on mont::kLanes walks in lockstep
+ * (one c per lane) inside a LaneContext, so the hot loop is montgomery arithmetic in
+ * registers with no allocation; only the per-block gcds go back through BigInt.
+ *
+ * rho_attack_parallel runs independent walks (random c, random x0 drawn from the seed)
+ * on worker threads. Walks are numbered; a hit on walk i cancels every walk > i while
+ * lower-numbered walks still in flight run out their budget, so the reported factor is
+ * always the one from the lowest successful walk and the same seed gives the same answer.
+ *
+ * n of at most 128 bits (the cofactors left after peeling factors off a key) skips all of
+ * the above: the brent walk runs on mont::Word64 / mont::Word128 with the walk state in
+ * registers and a binary gcd per block, 4-10x faster than the same walk through BigInt.
+ * squfof (n < 2^62) is the fallback when the walk runs dry: on its own it measures 2-3x
+ * slower than the native walk here, its inner loop is a 64-bit division per step.
+ */
+
+// one step of the walk: x = x^2 + c mod n, x and c in ctx form
+static inline void rho_step(ModContext &ctx, BigInt &x, const BigInt &c) {
+    ctx.sqrmod(x, x);
+    ctx.addmod(x, x, c);
+}
+
+/*
+ * Brent walk for one (c, x0) pair, all arithmetic through a ModContext.
+ * x - y is taken mod n instead of |x - y|: same gcd with n, one less compare.
+ * Returns the gcd that ended the walk: a proper factor, n (walk collapsed) or 1 (budget spent
+ * or `stop` returned true; it is polled once per gcd block).
+ * `steps` receives the number of f evaluations spent.
  */
+static BigInt brent_walk(ModContext &ctx, const BigInt &c_in, const BigInt &x0,
+                         unsigned long long budget, unsigned long long batch,
+                         unsigned long long &steps,
+                         const std::function<bool()> &stop = {}) {
+    const BigInt &n = ctx.modulus();
+    BigInt one(static_cast<uint64_t>(1));
+    BigInt c = c_in, y = x0;
+    ctx.to_mont(c);
+    ctx.to_mont(y);
+    BigInt x = y, ys = y;
+    BigInt q = ctx.one(), g = one, diff;
+    steps = 0;
+
+    for (unsigned long long r = 1; g == one; r <<= 1) {
+        x = y;
+        for (unsigned long long i = 0; i < r; ++i) rho_step(ctx, y, c);
+        steps += r;
+
+        for (unsigned long long k = 0; k < r && g == one; k += batch) {
+            ys = y;
+            unsigned long long block = std::min(batch, r - k);
+            for (unsigned long long i = 0; i < block; ++i) {
+                rho_step(ctx, y, c);
+                ctx.submod(diff, x, y);
+                ctx.mulmod(q, q, diff);
+            }
+            steps += block;
+            // q is q_true * R mod n and gcd(R, n) = 1, so no need to leave montgomery form
+            g = BigInt::gcd(q, n);
+            if (g == one && stop && stop()) return g;
+        }
+        if (g == one && steps >= budget) return g;
+    }
 
-RhoResult rho_attack(const BigInt &n, unsigned long long max_iters) {
+    if (g == n) {
+        // batched product hit 0 mod n: replay the last block from ys with a gcd per step
+        do {
+            rho_step(ctx, ys, c);
+            ctx.submod(diff, x, ys);
+            g = BigInt::gcd(diff, n);
+        } while (g == one);
+    }
+    return g;
+}
+
+/*
+ * Brent walks for c = c_base+1 .. c_base+kLanes (all from x0 = 2) sharing one schedule.
+ * Returns a proper factor, or 1 when every lane collapsed or the per-lane budget ran out.
+ */
+static BigInt brent_lanes(const mont::LaneContext &ctx, unsigned c_base, unsigned long long budget,
+                          unsigned long long batch, unsigned long long &steps, unsigned &hit_c,
+                          const utils::StopToken &stop) {
+    using mont::kLanes;
+    const BigInt &n = ctx.modulus();
+    BigInt one(static_cast<uint64_t>(1));
+    mont::LaneReg y = ctx.reg(), x = ctx.reg(), ys = ctx.reg(), q = ctx.reg(), c = ctx.reg(), diff = ctx.reg();
+    ctx.fill(y, BigInt(static_cast<uint64_t>(2)));
+    ctx.fill(q, one);
+    for (unsigned lane = 0; lane < kLanes; ++lane) ctx.set(c, lane, BigInt(static_cast<uint64_t>(c_base + lane + 1)));
+    bool alive[kLanes];
+    std::fill(alive, alive + kLanes, true);
+    unsigned live = kLanes;
+    steps = 0;
+
+    for (unsigned long long r = 1; steps < budget; r <<= 1) {
+        x = y;
+        for (unsigned long long i = 0; i < r; ++i) {
+            ctx.sqr(y, y);
+            ctx.add(y, y, c);
+        }
+        steps += r;
+
+        for (unsigned long long k = 0; k < r; k += batch) {
+            ys = y;
+            unsigned long long block = std::min(batch, r - k);
+            for (unsigned long long i = 0; i < block; ++i) {
+                ctx.sqr(y, y);
+                ctx.add(y, y, c);
+                ctx.sub(diff, x, y);
+                ctx.mul(q, q, diff);
+            }
+            steps += block;
+
+            for (unsigned lane = 0; lane < kLanes; ++lane) {
+                if (!alive[lane]) continue;
+                BigInt g = BigInt::gcd(ctx.get(q, lane), n);
+                if (g == one) continue;
+                if (g == n) {
+                    // replay this lane's block outside the lanes, one gcd per step
+                    ModContext mc(n);
+                    BigInt xl = ctx.get(x, lane), yl = ctx.get(ys, lane), cl(static_cast<uint64_t>(c_base + lane + 1)), d;
+                    mc.to_mont(xl);
+                    mc.to_mont(yl);
+                    mc.to_mont(cl);
+                    do {
+                        rho_step(mc, yl, cl);
+                        mc.submod(d, xl, yl);
+                        g = BigInt::gcd(d, n);
+                    } while (g == one);
+                }
+                if (g != n) {
+                    hit_c = c_base + lane + 1;
+                    return g;
+                }
+                alive[lane] = false;
+                --live;
+            }
+            if (live == 0 || stop.stop_requested()) return one;
+        }
+    }
+    return one;
+}
+
+// brent_walk on a native word context, c and x0 in the normal domain; same return contract.
+// A block here is only a few microseconds, so `stop` is polled every kWordPollBlocks blocks.
+constexpr unsigned kWordPollBlocks = 64;
+
+template <class Ctx>
+static typename Ctx::word brent_word(const Ctx &m, typename Ctx::word c_in, typename Ctx::word x0,
+                                     unsigned long long budget, unsigned long long batch,
+                                     unsigned long long &steps, const utils::StopToken &stop) {
+    using W = typename Ctx::word;
+    const W n = m.modulus();
+    W c = m.to_mont(c_in), y = m.to_mont(x0);
+    W x = y, ys = y, q = m.one(), g = 1;
+    steps = 0;
+    unsigned blocks = 0;
+
+    for (unsigned long long r = 1; g == 1; r <<= 1) {
+        x = y;
+        for (unsigned long long i = 0; i < r; ++i) y = m.add(m.sqr(y), c);
+        steps += r;
+
+        for (unsigned long long k = 0; k < r && g == 1; k += batch) {
+            ys = y;
+            unsigned long long block = std::min(batch, r - k);
+            for (unsigned long long i = 0; i < block; ++i) {
+                y = m.add(m.sqr(y), c);
+                q = m.mul(q, m.sub(x, y));
+            }
+            steps += block;
+            g = mont::gcd_word(q, n);
+            if (g == 1 && ++blocks % kWordPollBlocks == 0 && stop.stop_requested()) return g;
+        }
+        if (g == 1 && steps >= budget) return g;
+    }
+
+    if (g == n) {
+        do {
+            ys = m.add(m.sqr(ys), c);
+            g = mont::gcd_word(m.sub(x, ys), n);
+        } while (g == 1);
+    }
+    return g;
+}
+
+// walks c = 1, 2, ... from x0 = 2 until one splits n or max_iters is spent; 0 = no factor
+template <class Ctx>
+static typename Ctx::word rho_word(typename Ctx::word n, unsigned long long max_iters, unsigned long long batch,
+                                   unsigned long long &total, unsigned &hit_c, const utils::StopToken &stop) {
+    total = 0;
+    if (n < 4) return 0;
+    if (!(n & 1)) return 2;
+    if (batch == 0) batch = 1;
+    Ctx m(n);
+    for (unsigned c = 1; total < max_iters; ++c) {
+        unsigned long long steps = 0;
+        typename Ctx::word d = brent_word(m, c, 2, max_iters - total, batch, steps, stop);
+        total += steps;
+        if (d == 1) break; // budget spent or stopped
+        if (d != n) {
+            hit_c = c;
+            return d;
+        }
+    }
+    return 0;
+}
+
+uint64_t rho_u64(uint64_t n, unsigned long long max_iters, unsigned long long batch, const utils::StopToken &stop) {
+    unsigned long long total = 0;
+    unsigned c = 0;
+    return rho_word<mont::Word64>(n, max_iters, batch, total, c, stop);
+}
+
+mont::u128 rho_u128(mont::u128 n, unsigned long long max_iters, unsigned long long batch,
+                    const utils::StopToken &stop) {
+    unsigned long long total = 0;
+    unsigned c = 0;
+    return rho_word<mont::Word128>(n, max_iters, batch, total, c, stop);
+}
+
+// every walk squares once per step and multiplies |x - y| into the gcd product, one gcd per batch
+static void count_steps(RhoResult &rr, unsigned long long total, unsigned long long batch) {
+    rr.metrics.unit = "steps";
+    rr.metrics.iterations = total;
+    rr.metrics.modmuls = 2 * total;
+    rr.metrics.gcds = total / batch;
+}
+
+// odd n of at most 128 bits: the native walk, squfof when that comes back empty
+static RhoResult rho_attack_word(const BigInt &n, unsigned long long max_iters, unsigned long long batch,
+                                 const utils::StopToken &stop) {
+    RhoResult rr;
+    std::ostringstream log;
+    size_t bits = n.bit_length();
+    // gmp's primality test is exact below 2^64 and cheap above; a prime would burn the whole budget
+    if (mpz_probab_prime_p(n.raw(), 25)) {
+        rr.log = "n is prime";
+        return rr;
+    }
+
+    unsigned long long total = 0;
+    unsigned hit_c = 0;
+    if (bits <= 64) {
+        if (uint64_t d = rho_word<mont::Word64>(mont::to_u64(n), max_iters, batch, total, hit_c, stop)) rr.factor = BigInt(d);
+    } else {
+        if (mont::u128 d = rho_word<mont::Word128>(mont::to_u128(n), max_iters, batch, total, hit_c, stop)) {
+            rr.factor = mont::from_u128(d);
+        }
+    }
+    const char *word = bits <= 64 ? "native u64" : "native u128";
+    if (!rr.factor.is_zero()) {
+        rr.success = true;
+        log << "found factor after " << total << " iterations (c=" << hit_c << ", start=2, batch=" << batch
+            << ", " << word << ")";
+    } else if (stop.stop_requested()) {
+        rr.stopped = true;
+        log << "stopped after " << total << " iterations (batch=" << batch << ", " << word << ")";
+    } else if (uint64_t f = bits <= kSqufofMaxBits ? squfof_u64(mont::to_u64(n)) : 0) {
+        rr.success = true;
+        rr.factor = BigInt(f);
+        log << "squfof after " << total << " rho iterations came up empty";
+    } else {
+        log << "no factor found (" << total << " iterations, batch=" << batch << ", " << word << ")";
+    }
+    count_steps(rr, total, batch);
+    rr.log = log.str();
+    return rr;
+}
+
+static RhoResult rho_attack_lanes(const BigInt &n, unsigned long long max_iters, unsigned long long batch,
+                                  const utils::StopToken &stop) {
+    RhoResult rr;
+    std::ostringstream log;
+    mont::LaneContext ctx(n);
+    BigInt one(static_cast<uint64_t>(1));
+
+    // same budget shape as the gmp walk, counted per lane; a round of lanes covers kLanes c values
+    unsigned long long per_lane = std::max(max_iters / mont::kLanes, 50000ULL);
+    unsigned long long total = 0;
+    for (unsigned c_base = 0; c_base < 20; c_base += mont::kLanes) {
+        unsigned long long steps = 0;
+        unsigned hit_c = 0;
+        BigInt d = brent_lanes(ctx, c_base, per_lane, batch, steps, hit_c, stop);
+        total += steps * mont::kLanes;
+        if (d != one) {
+            rr.success = true;
+            rr.factor = d;
+            log << "found factor after " << steps << " iterations (c=" << hit_c << ", start=2, batch=" << batch
+                << ", " << mont::backend_name(ctx.backend()) << " x" << mont::kLanes << " lanes)";
+            count_steps(rr, total, batch);
+            rr.log = log.str();
+            return rr;
+        }
+        if (total >= max_iters || stop.stop_requested()) break;
+    }
+    rr.stopped = stop.stop_requested();
+    log << (rr.stopped ? "stopped" : "no factor found") << " (" << total << " lane iterations, batch=" << batch << ", "
+        << mont::backend_name(ctx.backend()) << " lanes)";
+    count_steps(rr, total, batch);
+    rr.log = log.str();
+    return rr;
+}
+
+static RhoResult rho_serial(const BigInt &n, unsigned long long max_iters, unsigned long long batch,
+                            RhoBackend backend, const utils::StopToken &stop) {
     RhoResult rr;
     std::ostringstream log;
 
@@ -36,53 +353,150 @@ RhoResult rho_attack(const BigInt &n, unsigned long long max_iters) {
         return rr;
     }
 
+    if (batch == 0) batch = 1;
+    if (n.bit_length() <= 128) return rho_attack_word(n, max_iters, batch, stop);
+    if (backend == RhoBackend::Lanes && mont::LaneContext::fits(n)) return rho_attack_lanes(n, max_iters, batch, stop);
+
     // try multiple c values with different starting points
     unsigned long long iters_per_attempt = max_iters / 60; // 20 c values * 3 starts
     if (iters_per_attempt < 50000) iters_per_attempt = 50000;
 
+    ModContext ctx(n);
+    unsigned long long total = 0;
+    auto stopped = [&] { return stop.stop_requested(); };
     for (unsigned c_val = 1; c_val <= 20; c_val++) {
         BigInt c(static_cast<uint64_t>(c_val));
 
         // try different starting points for each c
         for (unsigned start_val = 2; start_val <= 4; start_val++) {
-            BigInt x(static_cast<uint64_t>(start_val));
-            BigInt y = x;
+            BigInt x0(static_cast<uint64_t>(start_val));
+            unsigned long long steps = 0;
+            BigInt d = brent_walk(ctx, c, x0, iters_per_attempt, batch, steps, stopped);
+            total += steps;
+
+            if (d != one && d != n) {
+                // found a non-trivial factor shiiiii
+                rr.success = true;
+                rr.factor = d;
+                log << "found factor after " << steps << " iterations (c=" << c_val << ", start=" << start_val <<
+                        ", batch=" << batch << ")";
+                count_steps(rr, total, batch);
+                rr.log = log.str();
+                return rr;
+            }
+            // d == n: the walk cycled mod n itself, d == 1: budget spent; try next combination
+            if (stop.stop_requested()) {
+                rr.stopped = true;
+                log << "stopped after " << total << " iterations (c=" << c_val << ", start=" << start_val
+                    << ", batch=" << batch << ")";
+                count_steps(rr, total, batch);
+                rr.log = log.str();
+                return rr;
+            }
+        }
+    }
 
-            for (unsigned long long iter = 1; iter <= iters_per_attempt; iter++) {
-                // tortoise: x = f(x) = x^2 + c mod n
-                x = (x * x + c) % n;
+    log << "no factor found after trying multiple c values (" << total << " iterations, batch=" << batch << ")";
+    count_steps(rr, total, batch);
+    rr.log = log.str();
+    return rr;
+}
 
-                // hare: y = f(f(y))
-                y = (y * y + c) % n;
-                y = (y * y + c) % n;
+RhoResult rho_attack(const BigInt &n, unsigned long long max_iters, unsigned long long batch, RhoBackend backend,
+                     const utils::StopToken &stop) {
+    return utils::measure([&] { return rho_serial(n, max_iters, batch, backend, stop); });
+}
 
-                // compute gcd(|x - y|, n)
-                BigInt diff = (x > y) ? (x - y) : (y - x);
+// deterministic (c, x0) for walk `index` under `seed`
+static void walk_params(const BigInt &n, uint64_t seed, uint64_t index, BigInt &c, BigInt &x0) {
+    std::mt19937_64 rng(seed ^ (0x9e3779b97f4a7c15ULL * (index + 1)));
+    // c in [1, n-3]: 0 and -2 (mod n) both give degenerate walks
+    c = BigInt(static_cast<uint64_t>(rng()));
+    BigInt span = n - BigInt(static_cast<uint64_t>(3));
+    if (span > BigInt(static_cast<uint64_t>(1))) c %= span;
+    c += BigInt(static_cast<uint64_t>(1));
+    x0 = BigInt(static_cast<uint64_t>(rng()));
+    x0 %= n;
+}
+
+static RhoResult rho_parallel(const BigInt &n, unsigned threads, uint64_t seed, unsigned long long max_iters,
+                              unsigned long long batch, const utils::StopToken &stop) {
+    RhoResult rr;
+    std::ostringstream log;
+    BigInt one(static_cast<uint64_t>(1));
 
-                // skip zero differences
-                if (diff.is_zero()) continue;
+    if (n.is_zero() || n == one) {
+        rr.log = "n must be > 1";
+        return rr;
+    }
+    if (n.is_even()) {
+        rr.success = true;
+        rr.factor = BigInt(static_cast<uint64_t>(2));
+        rr.log = "n is even, factor=2";
+        return rr;
+    }
+    if (batch == 0) batch = 1;
+    if (n.bit_length() <= 128) return rho_serial(n, max_iters, batch, RhoBackend::Gmp, stop);
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
 
-                BigInt d = BigInt::gcd(diff, n);
+    // each thread owns a chain of walks t, t+T, t+2T, ... sharing max_iters/T steps;
+    // it only moves on to the next walk when the current one collapses to n
+    unsigned long long chain_budget = std::max(1ULL, max_iters / threads);
+    constexpr uint64_t none = std::numeric_limits<uint64_t>::max();
+    std::atomic<uint64_t> best{none};
+    std::atomic<unsigned long long> total{0};
+    std::mutex mu;
+    BigInt best_factor;
+    BigInt best_c;
 
-                if (d != one && d != n) {
-                    // found a non-trivial factor shiiiii
-                    rr.success = true;
-                    rr.factor = d;
-                    log << "found factor after " << iter << " iterations (c=" << c_val << ", start=" << start_val <<
-                            ")";
-                    rr.log = log.str();
-                    return rr;
-                }
+    auto worker = [&](unsigned t) {
+        ModContext ctx(n); // scratch limbs are per thread
+        unsigned long long left = chain_budget;
+        for (uint64_t index = t; left > 0; index += threads) {
+            if (best.load(std::memory_order_relaxed) < index) return;
+            BigInt c, x0;
+            walk_params(n, seed, index, c, x0);
+            unsigned long long steps = 0;
+            auto cancelled = [&] { return best.load(std::memory_order_relaxed) < index || stop.stop_requested(); };
+            BigInt d = brent_walk(ctx, c, x0, left, batch, steps, cancelled);
+            total += steps;
+            left = steps >= left ? 0 : left - steps;
 
-                if (d == n) {
-                    // hit a cycle that gives us n, try next combination
-                    break;
+            if (d != one && d != n) {
+                std::lock_guard<std::mutex> lock(mu);
+                if (index < best.load()) {
+                    best.store(index);
+                    best_factor = d;
+                    best_c = c;
                 }
+                return;
             }
+            if (d == one) return; // budget spent or cancelled
         }
-    }
+    };
+
+    std::vector<std::jthread> pool;
+    pool.reserve(threads);
+    for (unsigned t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+    pool.clear(); // joins
 
-    log << "no factor found after trying multiple c values";
+    if (best.load() != none) {
+        rr.success = true;
+        rr.factor = best_factor;
+        log << "found factor on walk " << best.load() << " (c=" << best_c << ", seed=" << seed
+            << ", threads=" << threads << ", " << total.load() << " iterations total)";
+    } else {
+        rr.stopped = stop.stop_requested();
+        log << (rr.stopped ? "stopped" : "no factor found") << " (" << threads << " threads, seed=" << seed << ", "
+            << total.load() << " iterations total, batch=" << batch << ")";
+    }
+    count_steps(rr, total.load(), batch);
     rr.log = log.str();
     return rr;
 }
+
+RhoResult rho_attack_parallel(const BigInt &n, unsigned threads, uint64_t seed,
+                              unsigned long long max_iters, unsigned long long batch,
+                              const utils::StopToken &stop) {
+    return utils::measure([&] { return rho_parallel(n, threads, seed, max_iters, batch, stop); });
+}
@@ -1,13 +1,62 @@
 #pragma once
 
 #include "../bigint.hpp"
+#include "../mont_word.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
+#include <cstdint>
 #include <string>
 
 struct RhoResult {
     bool success{false};
     BigInt factor{static_cast<uint64_t>(0)};
+    bool stopped{false}; // the stop token fired first; log says how far it got
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
     std::string log;
 };
 
-RhoResult rho_attack(const BigInt &n, unsigned long long max_iters = 1000000ULL);
+// arithmetic used for the walk: gmp BigInt, or mont::LaneContext running 8 walks at once
+enum class RhoBackend { Gmp, Lanes };
 
+/*
+ * Brent-variant pollard rho.
+ *
+ * @param n - composite to factor
+ * @param max_iters - total f(x) evaluation budget across all (c, start) walks
+ * @param batch - number of |x-y| products accumulated between gcds (m in brent's paper)
+ * @param backend - Lanes needs odd n of at most 256 bits, otherwise it falls back to Gmp
+ * @param stop - polled between gcd blocks; a stopped walk returns with success = false
+ *
+ * n of at most 128 bits never reaches gmp: the walk runs on rho_u64 / rho_u128 (backend is
+ * ignored), with squfof as the fallback up to 62 bits.
+ */
+RhoResult rho_attack(const BigInt &n, unsigned long long max_iters = 1000000ULL, unsigned long long batch = 128ULL,
+                     RhoBackend backend = RhoBackend::Gmp, const utils::StopToken &stop = {});
+
+/*
+ * The same brent walk on native words (mont::Word64 / mont::Word128): no gmp, no allocation,
+ * a gcd is a binary gcd on one or two words. Meant for the millions of small cofactors a full
+ * factorization leaves behind. Returns a proper factor of odd n, or 0 when max_iters ran out
+ * or `stop` fired (polled every 64 gcd blocks).
+ */
+uint64_t rho_u64(uint64_t n, unsigned long long max_iters = 1000000ULL, unsigned long long batch = 128ULL,
+                 const utils::StopToken &stop = {});
+mont::u128 rho_u128(mont::u128 n, unsigned long long max_iters = 1000000ULL, unsigned long long batch = 128ULL,
+                    const utils::StopToken &stop = {});
+
+/*
+ * Parallel pollard rho: independent brent walks on worker threads, each with its own
+ * random polynomial constant c and start x0 derived from `seed`. The first hit cancels
+ * the walks after it; the result only depends on (n, seed, threads, max_iters, batch).
+ *
+ * @param threads - worker count (0 = all hardware threads)
+ * @param seed - seed for the per-walk (c, x0) choice
+ * @param max_iters - total step budget, split evenly between the threads
+ * @param stop - shared by every walk, polled between gcd blocks
+ *
+ * n of at most 128 bits is handed to rho_attack: the native walk is done before threads start.
+ */
+RhoResult rho_attack_parallel(const BigInt &n, unsigned threads, uint64_t seed,
+                              unsigned long long max_iters = 1000000ULL,
+                              unsigned long long batch = 128ULL,
+                              const utils::StopToken &stop = {});
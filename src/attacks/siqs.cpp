@@ -0,0 +1,826 @@
+#include "siqs.hpp"
+#include "../utils/primes.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Self-initializing quadratic sieve.
+ *
+ * Collect relations (ax + b)^2 = a g(x) (mod N) where a g(x) splits over a factor base of
+ * small primes p with (kN / p) != -1, then combine them with linear algebra over GF(2) into
+ * X^2 = Y^2 (mod N) and hope gcd(X - Y, N) is proper (each dependency: 1/2 chance).
+ *
+ * - Multiplier: k is picked by the knuth-schroeppel function so kN has many small quadratic
+ *   residues, the sieve runs on kN.
+ * - Polynomials: g(x) = a x^2 + 2 b x + c, c = (b^2 - kN) / a, with a = q_1 ... q_s a product
+ *   of factor base primes close to sqrt(2kN) / M so |g| stays below M sqrt(kN / 2) on [-M, M).
+ *   Every a has 2^(s-1) b values b = B_1 +- B_2 ... +- B_s; walking them in gray code order
+ *   changes one sign at a time, so the sieve roots of the next polynomial are the old roots
+ *   plus or minus a precomputed 2 B_l a^-1 mod p (the self-initializing part).
+ * - Sieve: [-M, M) in 32 KiB blocks (L1 sized), adding round(log2 p) bytes at both roots of
+ *   every prime from ~50 up; smaller primes hit too often to be worth it and are only found
+ *   by trial division. Blocks whose bytes reach the threshold are trial divided by checking
+ *   the position against each prime's roots before touching the big number.
+ * - Large primes: a leftover cofactor below lp_mult times the largest factor base prime is a
+ *   prime, and two relations with the same large prime multiply into one full relation.
+ * - Threads: each worker takes a whole a (polynomial family) at a time from a shared counter
+ *   and hands its relations to the shared store when the family is done.
+ * - Linear algebra: singleton columns are pruned repeatedly (a prime that occurs in only one
+ *   relation can't be in a dependency), the rest is a dense bit-packed gauss-jordan over
+ *   GF(2) whose free columns give up to 64 dependencies.
+ */
+
+namespace {
+    constexpr uint32_t kBlock = 1U << 15;
+    constexpr uint32_t kSieveMinPrime = 50; // smaller primes are left to trial division
+    constexpr size_t kExtraCycles = 96;     // relations beyond the factor base size
+    constexpr unsigned kMaxRounds = 4;      // more relations after all dependencies failed
+    // bits below log2(max |g|) - log2(large prime bound) a sieve byte may fall short and still get
+    // trial divided: covers the unsieved primes < kSieveMinPrime, rounded logs and |g| well under
+    // its maximum over most of the interval (found by timing 50-70 digit runs)
+    constexpr double kThresholdSlack = 16.0;
+
+    struct Params {
+        unsigned digits;
+        uint32_t fb_size;
+        uint32_t blocks;  // per side: the interval is [-blocks * kBlock, blocks * kBlock)
+        uint32_t lp_mult; // large prime bound = lp_mult * largest factor base prime
+    };
+
+    // tuned on 50-70 digit semiprimes; below the usual siqs tables at the top end to keep the
+    // dense matrix small
+    constexpr Params kParams[] = {
+            {20, 120, 1, 30},   {30, 220, 1, 30},   {40, 450, 1, 40},     {50, 1200, 1, 60},
+            {60, 3000, 2, 100}, {70, 6500, 3, 100}, {80, 12000, 5, 120},  {90, 20000, 6, 150},
+            {100, 32000, 8, 150},
+    };
+
+    Params params_for(unsigned digits) {
+        if (digits <= kParams[0].digits) return kParams[0];
+        for (size_t i = 1; i < std::size(kParams); ++i) {
+            const Params &lo = kParams[i - 1], &hi = kParams[i];
+            if (digits > hi.digits) continue;
+            double t = static_cast<double>(digits - lo.digits) / (hi.digits - lo.digits);
+            auto mix = [t](uint32_t a, uint32_t b) { return static_cast<uint32_t>(std::lround(a + t * (b - static_cast<double>(a)))); };
+            return {digits, mix(lo.fb_size, hi.fb_size), mix(lo.blocks, hi.blocks), mix(lo.lp_mult, hi.lp_mult)};
+        }
+        return kParams[std::size(kParams) - 1];
+    }
+
+    uint64_t mulmod(uint64_t a, uint64_t b, uint64_t m) {
+        return static_cast<uint64_t>(static_cast<unsigned __int128>(a) * b % m);
+    }
+
+    uint64_t powmod(uint64_t b, uint64_t e, uint64_t m) {
+        uint64_t r = 1 % m;
+        for (b %= m; e; e >>= 1, b = mulmod(b, b, m)) {
+            if (e & 1) r = mulmod(r, b, m);
+        }
+        return r;
+    }
+
+    // (a / p) for an odd prime p: 1, 0 or -1
+    int legendre(uint64_t a, uint64_t p) {
+        a %= p;
+        if (a == 0) return 0;
+        return powmod(a, (p - 1) / 2, p) == 1 ? 1 : -1;
+    }
+
+    // sqrt(a) mod odd prime p for a quadratic residue a (tonelli-shanks)
+    uint64_t sqrt_mod(uint64_t a, uint64_t p) {
+        a %= p;
+        if (a == 0) return 0;
+        if (p % 4 == 3) return powmod(a, (p + 1) / 4, p);
+        uint64_t q = p - 1, s = 0;
+        while (!(q & 1)) q >>= 1, ++s;
+        uint64_t z = 2;
+        while (legendre(z, p) != -1) ++z;
+        uint64_t m = s, c = powmod(z, q, p), t = powmod(a, q, p), r = powmod(a, (q + 1) / 2, p);
+        while (t != 1) {
+            uint64_t i = 0, tt = t;
+            while (tt != 1) tt = mulmod(tt, tt, p), ++i;
+            uint64_t b = c;
+            for (uint64_t j = 0; j + i + 1 < m; ++j) b = mulmod(b, b, p);
+            m = i;
+            c = mulmod(b, b, p);
+            t = mulmod(t, c, p);
+            r = mulmod(r, b, p);
+        }
+        return r;
+    }
+
+    // a^-1 mod p, gcd(a, p) = 1
+    uint32_t inv_mod(uint32_t a, uint32_t p) {
+        int64_t t = 0, nt = 1, r = p, nr = a % p;
+        while (nr) {
+            int64_t q = r / nr;
+            std::tie(t, nt) = std::make_pair(nt, t - q * nt);
+            std::tie(r, nr) = std::make_pair(nr, r - q * nr);
+        }
+        return static_cast<uint32_t>(t < 0 ? t + p : t);
+    }
+
+    /*
+     * Knuth-Schroeppel: expected log contribution of the small primes to a sieve value of kN,
+     * minus the 1/2 log k the values grow by. Odd squarefree k only, so 2 is handled by kN mod 8.
+     */
+    uint32_t choose_multiplier(const BigInt &n) {
+        constexpr uint32_t kCandidates[] = {1,  3,  5,  7,  11, 13, 15, 17, 19, 21, 23, 29, 31, 33, 35, 37,
+                                            39, 41, 43, 47, 51, 53, 55, 57, 59, 61, 65, 67, 69, 71, 73};
+        std::vector<uint32_t> primes;
+        utils::PrimeSieve sieve(3, 2000);
+        for (uint64_t p = sieve.next(); p; p = sieve.next()) primes.push_back(static_cast<uint32_t>(p));
+
+        uint32_t best = 1;
+        double best_score = -1e300;
+        for (uint32_t k : kCandidates) {
+            uint64_t kn8 = (mpz_fdiv_ui(n.raw(), 8) * k) % 8;
+            double score = -0.5 * std::log(static_cast<double>(k));
+            if (kn8 == 1) score += 2 * std::log(2.0);
+            else if (kn8 == 5) score += std::log(2.0);
+            else score += 0.5 * std::log(2.0);
+            for (uint32_t p : primes) {
+                double lp = std::log(static_cast<double>(p));
+                if (k % p == 0) score += lp / p;
+                else if (legendre(mpz_fdiv_ui(n.raw(), p) * k, p) == 1) score += 2 * lp / (p - 1);
+            }
+            if (score > best_score) {
+                best_score = score;
+                best = k;
+            }
+        }
+        return best;
+    }
+
+    /*
+     * Factor base of kN. Index 0 stands for -1, index 1 for 2; both are only found by trial
+     * division. sqrt is sqrt(kN) mod p (0 for the primes of k, which have a single root).
+     */
+    struct FactorBase {
+        std::vector<uint32_t> p;
+        std::vector<uint32_t> sqrt;
+        std::vector<uint8_t> logp;
+        size_t sieve_start{2}; // first index with p >= kSieveMinPrime
+        size_t large_start{2}; // first index with p >= kBlock, bucket sieved
+    };
+
+    struct Relation {
+        BigInt y;                      // a x + b mod N
+        std::vector<uint32_t> factors; // factor base indices of a g(x), with multiplicity
+        uint64_t lp{1};                // large prime, 1 for a full relation
+    };
+
+    // a full relation (second == kNone) or two relations sharing a large prime
+    using Cycle = std::array<uint32_t, 2>;
+    constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+    // everything the workers read but never write
+    struct Setup {
+        BigInt n, kn;
+        uint32_t k{1};
+        FactorBase fb;
+        uint32_t m{0};        // half interval
+        uint8_t threshold{0}; // sieve bytes >= this get trial divided
+        uint64_t lp_bound{0};
+        unsigned s{0};                  // primes in a
+        size_t q_lo{0}, q_hi{0};        // factor base index range the q_l come from
+        double log_target{0};           // ln(sqrt(2kN) / M), the ideal ln a
+        uint64_t seed{1};
+    };
+
+    struct Store {
+        std::mutex mu;
+        std::vector<Relation> rels;
+        std::vector<Cycle> cycles;
+        std::unordered_map<uint64_t, uint32_t> first_partial; // large prime -> relation index
+        std::set<std::vector<uint32_t>> used_a;                // sorted q_l indices of every a
+        size_t fulls{0};
+        size_t partials{0};
+
+        void add(std::vector<Relation> &batch) {
+            std::lock_guard<std::mutex> lock(mu);
+            for (Relation &r : batch) {
+                auto idx = static_cast<uint32_t>(rels.size());
+                uint64_t lp = r.lp;
+                rels.push_back(std::move(r));
+                if (lp == 1) {
+                    ++fulls;
+                    cycles.push_back({idx, kNone});
+                    continue;
+                }
+                ++partials;
+                auto [it, fresh] = first_partial.emplace(lp, idx);
+                if (!fresh) cycles.push_back({it->second, idx});
+            }
+            batch.clear();
+        }
+
+        size_t cycle_count() {
+            std::lock_guard<std::mutex> lock(mu);
+            return cycles.size();
+        }
+    };
+
+    /*
+     * One worker's sieve state: the roots of every factor base prime for the current
+     * polynomial and the scratch for one block.
+     */
+    class Siever {
+    public:
+        Siever(const Setup &st, Store &store, const std::atomic<bool> &done, const utils::StopToken &stop)
+            : st_(st), store_(store), done_(done), stop_(stop) {
+            size_t fb = st.fb.p.size();
+            soln1_.resize(fb);
+            soln2_.resize(fb);
+            pos1_.resize(fb);
+            pos2_.resize(fb);
+            ainv_.resize(fb);
+            in_a_.resize(fb);
+            delta_.assign(st.s, std::vector<uint32_t>(fb));
+            sieve_.resize(kBlock);
+            // a large prime lands in a block at most once per root
+            uint32_t blocks = 2 * st.m / kBlock;
+            bucket_cap_ = 2 * (fb - st.fb.large_start);
+            buckets_.resize(static_cast<size_t>(blocks) * bucket_cap_);
+            bucket_len_.resize(blocks);
+        }
+
+        // sieve all 2^(s-1) polynomials of family `index`; false when no fresh a turned up
+        bool family(uint64_t index) {
+            if (!pick_a(index)) return false;
+            init_family();
+            uint64_t polys = 1ULL << (st_.s - 1);
+            for (uint64_t i = 0; i < polys && !done_.load(std::memory_order_relaxed); ++i) {
+                if ((i & 31) == 31 && stop_.stop_requested()) break;
+                if (i) next_poly(i);
+                sieve_poly();
+            }
+            store_.add(found_);
+            return true;
+        }
+
+        unsigned long long polys() const { return polys_; }
+
+    private:
+        // s - 1 random q from [q_lo, q_hi), the last one closest to what is left of the target
+        bool pick_a(uint64_t index) {
+            const auto &P = st_.fb.p;
+            std::mt19937_64 rng(st_.seed ^ (0x9e3779b97f4a7c15ULL * (index + 1)));
+            std::uniform_int_distribution<size_t> pick(st_.q_lo, st_.q_hi - 1);
+            for (int attempt = 0; attempt < 100; ++attempt) {
+                q_.clear();
+                double log_a = 0;
+                while (q_.size() + 1 < st_.s) {
+                    auto i = static_cast<uint32_t>(pick(rng));
+                    if (st_.fb.sqrt[i] == 0 || std::find(q_.begin(), q_.end(), i) != q_.end()) continue;
+                    q_.push_back(i);
+                    log_a += std::log(static_cast<double>(P[i]));
+                }
+                double want = std::exp(st_.log_target - log_a);
+                if (want < P[st_.fb.sieve_start] || want > P.back()) continue;
+                size_t last = std::lower_bound(P.begin() + static_cast<std::ptrdiff_t>(st_.fb.sieve_start), P.end(),
+                                               static_cast<uint32_t>(want)) - P.begin();
+                if (last == P.size()) --last;
+                while (last < P.size() && (st_.fb.sqrt[last] == 0 || std::find(q_.begin(), q_.end(), last) != q_.end())) ++last;
+                if (last == P.size()) continue;
+                q_.push_back(static_cast<uint32_t>(last));
+                std::sort(q_.begin(), q_.end());
+                std::lock_guard<std::mutex> lock(store_.mu);
+                if (store_.used_a.insert(q_).second) return true;
+            }
+            return false;
+        }
+
+        void init_family() {
+            const FactorBase &fb = st_.fb;
+            a_ = BigInt(static_cast<uint64_t>(1));
+            for (size_t i : q_) mpz_mul_ui(a_.raw(), a_.raw(), fb.p[i]);
+            std::fill(in_a_.begin(), in_a_.end(), 0);
+            for (size_t i : q_) in_a_[i] = 1;
+
+            // B_l = (a / q_l) * (sqrt(kN) * (a / q_l)^-1 mod q_l), so b = sum +- B_l has b^2 = kN mod a
+            B_.assign(st_.s, BigInt());
+            BigInt aq;
+            for (unsigned l = 0; l < st_.s; ++l) {
+                uint32_t q = fb.p[q_[l]];
+                mpz_divexact_ui(aq.raw(), a_.raw(), q);
+                uint32_t gamma = static_cast<uint32_t>(mulmod(fb.sqrt[q_[l]], inv_mod(static_cast<uint32_t>(mpz_fdiv_ui(aq.raw(), q)), q), q));
+                if (gamma > q / 2) gamma = q - gamma;
+                mpz_mul_ui(B_[l].raw(), aq.raw(), gamma);
+            }
+            b_ = B_[0];
+            for (unsigned l = 1; l < st_.s; ++l) b_ += B_[l];
+            sign_.assign(st_.s, 1);
+
+            for (size_t i = 2; i < fb.p.size(); ++i) {
+                if (in_a_[i]) continue;
+                uint32_t p = fb.p[i];
+                ainv_[i] = inv_mod(static_cast<uint32_t>(mpz_fdiv_ui(a_.raw(), p)), p);
+                for (unsigned l = 0; l < st_.s; ++l) {
+                    delta_[l][i] = static_cast<uint32_t>(mulmod(2 * mpz_fdiv_ui(B_[l].raw(), p), ainv_[i], p));
+                }
+            }
+            set_roots();
+        }
+
+        // roots of g for the current b, as offsets from -M
+        void set_roots() {
+            const FactorBase &fb = st_.fb;
+            for (size_t i = 2; i < fb.p.size(); ++i) {
+                if (in_a_[i]) continue;
+                uint32_t p = fb.p[i];
+                uint64_t bm = mpz_fdiv_ui(b_.raw(), p), mm = st_.m % p;
+                uint64_t t = fb.sqrt[i];
+                soln1_[i] = static_cast<uint32_t>((mulmod(ainv_[i], (t + p - bm) % p, p) + mm) % p);
+                soln2_[i] = static_cast<uint32_t>((mulmod(ainv_[i], (2 * p - t - bm) % p, p) + mm) % p);
+            }
+            finish_poly();
+        }
+
+        // gray code step to polynomial i: one B_l changes sign, every root moves by delta_l
+        void next_poly(uint64_t i) {
+            unsigned l = static_cast<unsigned>(__builtin_ctzll(i)) + 1;
+            const FactorBase &fb = st_.fb;
+            const std::vector<uint32_t> &d = delta_[l];
+            if (sign_[l] > 0) {
+                // b -= 2 B_l, roots = a^-1 (+-t - b) move up by delta
+                b_ -= B_[l];
+                b_ -= B_[l];
+                for (size_t j = 2; j < fb.p.size(); ++j) {
+                    uint32_t p = fb.p[j];
+                    uint32_t r1 = soln1_[j] + d[j], r2 = soln2_[j] + d[j];
+                    soln1_[j] = r1 >= p ? r1 - p : r1;
+                    soln2_[j] = r2 >= p ? r2 - p : r2;
+                }
+            } else {
+                b_ += B_[l];
+                b_ += B_[l];
+                for (size_t j = 2; j < fb.p.size(); ++j) {
+                    uint32_t p = fb.p[j];
+                    uint32_t r1 = soln1_[j] + (p - d[j]), r2 = soln2_[j] + (p - d[j]);
+                    soln1_[j] = r1 >= p ? r1 - p : r1;
+                    soln2_[j] = r2 >= p ? r2 - p : r2;
+                }
+            }
+            sign_[l] = -sign_[l];
+            finish_poly();
+        }
+
+        void finish_poly() {
+            // c = (b^2 - kN) / a, exact by the choice of B_l
+            c_ = b_ * b_;
+            c_ -= st_.kn;
+            mpz_divexact(c_.raw(), c_.raw(), a_.raw());
+        }
+
+        void sieve_poly() {
+            ++polys_;
+            const FactorBase &fb = st_.fb;
+            constexpr uint32_t kOut = std::numeric_limits<uint32_t>::max();
+            for (size_t i = fb.sieve_start; i < fb.large_start; ++i) {
+                // primes of a have one root that sieving doesn't know: park them out of range
+                pos1_[i] = in_a_[i] ? kOut : soln1_[i];
+                pos2_[i] = in_a_[i] || fb.sqrt[i] == 0 ? kOut : soln2_[i];
+            }
+            uint32_t blocks = 2 * st_.m / kBlock;
+            fill_buckets(blocks);
+
+            uint8_t *s = sieve_.data();
+            for (uint32_t blk = 0; blk < blocks; ++blk) {
+                std::memset(s, 0, kBlock);
+                for (size_t i = fb.sieve_start; i < fb.large_start; ++i) {
+                    uint32_t p = fb.p[i];
+                    uint8_t lg = fb.logp[i];
+                    uint32_t r1 = pos1_[i], r2 = pos2_[i];
+                    while (r1 < kBlock) {
+                        s[r1] += lg;
+                        r1 += p;
+                    }
+                    while (r2 < kBlock) {
+                        s[r2] += lg;
+                        r2 += p;
+                    }
+                    pos1_[i] = r1 - kBlock;
+                    pos2_[i] = r2 - kBlock;
+                }
+                const uint32_t *bucket = buckets_.data() + static_cast<size_t>(blk) * bucket_cap_;
+                for (uint32_t e = 0; e < bucket_len_[blk]; ++e) s[bucket[e] & (kBlock - 1)] += static_cast<uint8_t>(bucket[e] >> 16);
+                scan_block(blk);
+            }
+        }
+
+        /*
+         * Primes >= kBlock hit a block at most once per root, so walking every one of them once
+         * per block mostly finds nothing. Instead each is walked once over the whole interval and
+         * its hits dropped into the bucket of the block they land in (offset | logp << 16).
+         */
+        void fill_buckets(uint32_t blocks) {
+            const FactorBase &fb = st_.fb;
+            uint32_t interval = 2 * st_.m;
+            std::fill(bucket_len_.begin(), bucket_len_.begin() + blocks, 0);
+            for (size_t i = fb.large_start; i < fb.p.size(); ++i) {
+                if (in_a_[i]) continue;
+                uint32_t p = fb.p[i], lg = static_cast<uint32_t>(fb.logp[i]) << 16;
+                for (uint32_t r = soln1_[i]; r < interval; r += p) {
+                    uint32_t b = r / kBlock;
+                    buckets_[static_cast<size_t>(b) * bucket_cap_ + bucket_len_[b]++] = (r & (kBlock - 1)) | lg;
+                }
+                if (fb.sqrt[i] == 0) continue;
+                for (uint32_t r = soln2_[i]; r < interval; r += p) {
+                    uint32_t b = r / kBlock;
+                    buckets_[static_cast<size_t>(b) * bucket_cap_ + bucket_len_[b]++] = (r & (kBlock - 1)) | lg;
+                }
+            }
+        }
+
+        void scan_block(uint32_t blk) {
+            const uint8_t *s = sieve_.data();
+            uint8_t thr = st_.threshold;
+            for (uint32_t j = 0; j < kBlock; j += 64) {
+                uint8_t hit = 0;
+                for (uint32_t k = 0; k < 64; ++k) hit |= s[j + k] >= thr;
+                if (!hit) continue;
+                for (uint32_t k = 0; k < 64; ++k) {
+                    if (s[j + k] >= thr) trial_divide(blk * kBlock + j + k);
+                }
+            }
+        }
+
+        // off = x + M; keeps the relation when a g(x) splits up to one large prime
+        void trial_divide(uint32_t off) {
+            const FactorBase &fb = st_.fb;
+            auto x = static_cast<long>(off) - static_cast<long>(st_.m);
+            // g = (a x + 2 b) x + c
+            mpz_mul_si(g_.raw(), a_.raw(), x);
+            mpz_addmul_ui(g_.raw(), b_.raw(), 2);
+            mpz_mul_si(g_.raw(), g_.raw(), x);
+            g_ += c_;
+            if (g_.is_zero()) return;
+            factors_.clear();
+            if (mpz_sgn(g_.raw()) < 0) {
+                factors_.push_back(0);
+                mpz_neg(g_.raw(), g_.raw());
+            }
+            mp_bitcnt_t twos = mpz_scan1(g_.raw(), 0);
+            if (twos) {
+                mpz_tdiv_q_2exp(g_.raw(), g_.raw(), twos);
+                factors_.insert(factors_.end(), twos, 1);
+            }
+            factors_.insert(factors_.end(), q_.begin(), q_.end()); // a itself
+            for (size_t i = 2; i < fb.p.size(); ++i) {
+                uint32_t p = fb.p[i];
+                if (!in_a_[i] && i >= fb.sieve_start) {
+                    uint32_t r = off % p;
+                    if (r != soln1_[i] && r != soln2_[i]) continue;
+                } else if (!mpz_divisible_ui_p(g_.raw(), p)) {
+                    continue;
+                }
+                do {
+                    mpz_divexact_ui(g_.raw(), g_.raw(), p);
+                    factors_.push_back(static_cast<uint32_t>(i));
+                } while (mpz_divisible_ui_p(g_.raw(), p));
+            }
+            uint64_t lp = 1;
+            if (mpz_cmp_ui(g_.raw(), 1) != 0) {
+                if (mpz_sizeinbase(g_.raw(), 2) > 64) return;
+                lp = mpz_get_ui(g_.raw());
+                if (lp >= st_.lp_bound) return;
+            }
+            Relation rel;
+            mpz_mul_si(rel.y.raw(), a_.raw(), x);
+            rel.y += b_;
+            rel.y %= st_.n;
+            rel.factors = factors_;
+            rel.lp = lp;
+            found_.push_back(std::move(rel));
+        }
+
+        const Setup &st_;
+        Store &store_;
+        const std::atomic<bool> &done_;
+        const utils::StopToken &stop_;
+        std::vector<uint32_t> q_; // factor base indices of a
+        BigInt a_, b_, c_, g_;
+        std::vector<BigInt> B_;
+        std::vector<int> sign_;
+        std::vector<uint32_t> soln1_, soln2_, pos1_, pos2_, ainv_;
+        std::vector<uint8_t> in_a_;
+        std::vector<std::vector<uint32_t>> delta_;
+        std::vector<uint8_t> sieve_;
+        std::vector<uint32_t> buckets_; // bucket_cap_ entries per block
+        std::vector<uint32_t> bucket_len_;
+        size_t bucket_cap_{0};
+        std::vector<uint32_t> factors_;
+        std::vector<Relation> found_;
+        unsigned long long polys_{0};
+    };
+
+    // factor base indices with an odd exponent in the product of a cycle's relations
+    std::vector<uint32_t> odd_exponents(const std::vector<Relation> &rels, const Cycle &cyc) {
+        std::vector<uint32_t> all = rels[cyc[0]].factors;
+        if (cyc[1] != kNone) all.insert(all.end(), rels[cyc[1]].factors.begin(), rels[cyc[1]].factors.end());
+        std::sort(all.begin(), all.end());
+        std::vector<uint32_t> odd;
+        for (size_t i = 0; i < all.size();) {
+            size_t j = i;
+            while (j < all.size() && all[j] == all[i]) ++j;
+            if ((j - i) & 1) odd.push_back(all[i]);
+            i = j;
+        }
+        return odd;
+    }
+
+    /*
+     * Dependencies among the cycles: subsets whose exponent vectors sum to 0 mod 2.
+     * Returns up to 64 of them as lists of cycle indices.
+     */
+    std::vector<std::vector<uint32_t>> find_dependencies(const std::vector<std::vector<uint32_t>> &cols,
+                                                         size_t nprimes, size_t &rows_out, size_t &cols_out) {
+        // prune singletons: a prime in exactly one column takes that column with it
+        std::vector<uint32_t> weight(nprimes, 0);
+        std::vector<uint8_t> alive(cols.size(), 1);
+        for (const auto &c : cols) for (uint32_t p : c) ++weight[p];
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t j = 0; j < cols.size(); ++j) {
+                if (!alive[j]) continue;
+                bool single = std::any_of(cols[j].begin(), cols[j].end(), [&](uint32_t p) { return weight[p] == 1; });
+                if (!single) continue;
+                alive[j] = 0;
+                for (uint32_t p : cols[j]) --weight[p];
+                changed = true;
+            }
+        }
+        std::vector<uint32_t> row_of(nprimes, kNone);
+        size_t rows = 0;
+        for (size_t p = 0; p < nprimes; ++p) {
+            if (weight[p]) row_of[p] = static_cast<uint32_t>(rows++);
+        }
+        std::vector<uint32_t> col_ids;
+        for (size_t j = 0; j < cols.size() && col_ids.size() < rows + kExtraCycles; ++j) {
+            if (alive[j]) col_ids.push_back(static_cast<uint32_t>(j));
+        }
+        rows_out = rows;
+        cols_out = col_ids.size();
+        if (col_ids.size() <= rows) return {};
+
+        // rows = primes, bit columns = cycles; gauss-jordan to reduced row echelon form
+        size_t ncols = col_ids.size(), words = (ncols + 63) / 64;
+        std::vector<uint64_t> mat(rows * words, 0);
+        for (size_t j = 0; j < ncols; ++j) {
+            for (uint32_t p : cols[col_ids[j]]) mat[row_of[p] * words + j / 64] |= 1ULL << (j % 64);
+        }
+        auto row = [&](size_t r) { return mat.data() + r * words; };
+        std::vector<size_t> pivot_col;
+        std::vector<uint8_t> is_pivot(ncols, 0);
+        size_t r = 0;
+        for (size_t j = 0; j < ncols && r < rows; ++j) {
+            uint64_t bit = 1ULL << (j % 64);
+            size_t w = j / 64, pr = r;
+            while (pr < rows && !(row(pr)[w] & bit)) ++pr;
+            if (pr == rows) continue;
+            if (pr != r) std::swap_ranges(row(pr), row(pr) + words, row(r));
+            const uint64_t *src = row(r);
+            for (size_t i = 0; i < rows; ++i) {
+                if (i == r || !(row(i)[w] & bit)) continue;
+                uint64_t *dst = row(i);
+                for (size_t k = 0; k < words; ++k) dst[k] ^= src[k];
+            }
+            pivot_col.push_back(j);
+            is_pivot[j] = 1;
+            ++r;
+        }
+
+        // free column f: x_f = 1, x_pivot(r) = A[r][f], every other free column 0
+        std::vector<std::vector<uint32_t>> deps;
+        for (size_t f = 0; f < ncols && deps.size() < 64; ++f) {
+            if (is_pivot[f]) continue;
+            std::vector<uint32_t> dep{col_ids[f]};
+            for (size_t i = 0; i < pivot_col.size(); ++i) {
+                if (row(i)[f / 64] >> (f % 64) & 1) dep.push_back(col_ids[pivot_col[i]]);
+            }
+            deps.push_back(std::move(dep));
+        }
+        return deps;
+    }
+
+    // X = prod y, Y = sqrt(prod a g(x)) from the exponents; gcd(X - Y, N) or 1
+    BigInt try_dependency(const Setup &st, const std::vector<Relation> &rels, const std::vector<Cycle> &cycles,
+                          const std::vector<uint32_t> &dep) {
+        const BigInt &n = st.n;
+        std::vector<uint32_t> exps(st.fb.p.size(), 0);
+        BigInt x(static_cast<uint64_t>(1)), y(static_cast<uint64_t>(1));
+        for (uint32_t ci : dep) {
+            for (uint32_t ri : cycles[ci]) {
+                if (ri == kNone) continue;
+                x *= rels[ri].y;
+                x %= n;
+                for (uint32_t f : rels[ri].factors) ++exps[f];
+            }
+            if (cycles[ci][1] != kNone) {
+                // the shared large prime shows up squared
+                mpz_mul_ui(y.raw(), y.raw(), rels[cycles[ci][0]].lp);
+                y %= n;
+            }
+        }
+        if (exps[0] & 1) return BigInt(static_cast<uint64_t>(1));
+        BigInt pe;
+        for (size_t i = 1; i < exps.size(); ++i) {
+            if (exps[i] & 1) return BigInt(static_cast<uint64_t>(1)); // not a square: bookkeeping bug
+            if (!exps[i]) continue;
+            mpz_powm_ui(pe.raw(), BigInt(static_cast<uint64_t>(st.fb.p[i])).raw(), exps[i] / 2, n.raw());
+            y *= pe;
+            y %= n;
+        }
+        return BigInt::gcd(x - y, n);
+    }
+
+    bool build_factor_base(Setup &st, uint32_t size, BigInt &small_factor) {
+        FactorBase &fb = st.fb;
+        fb.p = {1, 2};
+        fb.sqrt = {0, 0};
+        fb.logp = {0, 1};
+        utils::PrimeSieve sieve(3, std::numeric_limits<uint32_t>::max());
+        for (uint64_t p = sieve.next(); fb.p.size() < size; p = sieve.next()) {
+            uint64_t knp = mpz_fdiv_ui(st.kn.raw(), p);
+            if (knp == 0 && st.k % p != 0) {
+                small_factor = BigInt(p);
+                return false;
+            }
+            if (knp != 0 && legendre(knp, p) != 1) continue;
+            fb.p.push_back(static_cast<uint32_t>(p));
+            fb.sqrt.push_back(static_cast<uint32_t>(sqrt_mod(knp, p)));
+            fb.logp.push_back(static_cast<uint8_t>(std::lround(std::log2(static_cast<double>(p)))));
+        }
+        fb.sieve_start = 2;
+        while (fb.sieve_start < fb.p.size() && fb.p[fb.sieve_start] < kSieveMinPrime) ++fb.sieve_start;
+        fb.large_start = fb.sieve_start;
+        while (fb.large_start < fb.p.size() && fb.p[fb.large_start] < kBlock) ++fb.large_start;
+        return true;
+    }
+
+    // s and the window of factor base primes a is built from
+    void choose_a_shape(Setup &st) {
+        const auto &P = st.fb.p;
+        double ln_kn = mpz_sizeinbase(st.kn.raw(), 2) * std::log(2.0);
+        st.log_target = 0.5 * (std::log(2.0) + ln_kn) - std::log(static_cast<double>(st.m));
+        // q around 2000 for big n, inside the lower part of the factor base for small ones
+        double q_want = std::min(2000.0, static_cast<double>(P[P.size() * 2 / 3]));
+        st.s = static_cast<unsigned>(std::max(2.0, std::ceil(st.log_target / std::log(q_want))));
+        double q_ideal = std::exp(st.log_target / st.s);
+        size_t mid = std::lower_bound(P.begin() + static_cast<std::ptrdiff_t>(st.fb.sieve_start), P.end(),
+                                      static_cast<uint32_t>(q_ideal)) - P.begin();
+        mid = std::min(mid, P.size() - 1);
+        // widen around q_ideal until there are enough q to pick families from
+        size_t want = std::max<size_t>(4 * st.s, 30);
+        st.q_lo = mid;
+        st.q_hi = mid + 1;
+        while (st.q_hi - st.q_lo < want && (st.q_lo > st.fb.sieve_start || st.q_hi < P.size())) {
+            if (st.q_lo > st.fb.sieve_start) --st.q_lo;
+            if (st.q_hi < P.size()) ++st.q_hi;
+        }
+    }
+}
+
+namespace {
+    SiqsResult siqs(const BigInt &n, unsigned threads, uint64_t seed, const utils::StopToken &stop) {
+        SiqsResult sr;
+        sr.metrics.unit = "polynomials";
+        std::ostringstream log;
+        if (n <= BigInt(static_cast<uint64_t>(3))) {
+            sr.log = "n must be > 3";
+            return sr;
+        }
+        if (n.is_even()) {
+            sr.success = true;
+            sr.factor = BigInt(static_cast<uint64_t>(2));
+            sr.log = "n is even";
+            return sr;
+        }
+        if (mpz_probab_prime_p(n.raw(), 25)) {
+            sr.log = "n is prime";
+            return sr;
+        }
+        if (mpz_perfect_power_p(n.raw())) {
+            // squares would make every relation trivial
+            for (unsigned e = 2;; ++e) {
+                BigInt r = BigInt::nth_root_floor(n, e);
+                BigInt pw;
+                mpz_pow_ui(pw.raw(), r.raw(), e);
+                if (pw == n) {
+                    sr.success = true;
+                    sr.factor = r;
+                    sr.log = "n is a perfect power";
+                    return sr;
+                }
+            }
+        }
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+        auto t0 = std::chrono::steady_clock::now();
+        Setup st;
+        st.n = n;
+        st.seed = seed;
+        st.k = choose_multiplier(n);
+        mpz_mul_ui(st.kn.raw(), n.raw(), st.k);
+        unsigned digits = static_cast<unsigned>(mpz_sizeinbase(n.raw(), 10));
+        Params prm = params_for(digits);
+        BigInt small;
+        if (!build_factor_base(st, prm.fb_size, small)) {
+            sr.success = true;
+            sr.factor = small;
+            sr.log = "factor base prime divides n";
+            return sr;
+        }
+        st.m = prm.blocks * kBlock;
+        st.lp_bound = static_cast<uint64_t>(prm.lp_mult) * st.fb.p.back();
+        choose_a_shape(st);
+        // log2 max |g| = log2(M sqrt(kN / 2)), less the room for a large prime and the slack
+        double log_g = std::log2(static_cast<double>(st.m)) + 0.5 * (mpz_sizeinbase(st.kn.raw(), 2) - 1.0);
+        double thr = log_g - std::log2(static_cast<double>(st.lp_bound)) - kThresholdSlack;
+        st.threshold = static_cast<uint8_t>(std::clamp(thr, 8.0, 250.0));
+
+        Store store;
+        std::atomic<uint64_t> next_family{0};
+        std::atomic<unsigned long long> polys{0};
+        size_t target = st.fb.p.size() + kExtraCycles;
+        size_t rows = 0, cols = 0, deps_tried = 0;
+        double sieve_s = 0, la_s = 0;
+
+        for (unsigned round = 0; round < kMaxRounds; ++round) {
+            auto ts = std::chrono::steady_clock::now();
+            std::atomic<bool> done{store.cycle_count() >= target};
+            auto worker = [&] {
+                Siever sv(st, store, done, stop);
+                int dry = 0; // families in a row without a fresh a
+                while (!done.load()) {
+                    if (stop.stop_requested()) {
+                        done.store(true);
+                        break;
+                    }
+                    if (!sv.family(next_family++)) {
+                        if (++dry > 1000) break;
+                        continue;
+                    }
+                    dry = 0;
+                    if (store.cycle_count() >= target) done.store(true);
+                }
+                polys += sv.polys();
+            };
+            std::vector<std::jthread> pool;
+            pool.reserve(threads);
+            for (unsigned t = 0; t < threads; ++t) pool.emplace_back(worker);
+            pool.clear();
+            auto tl = std::chrono::steady_clock::now();
+            sieve_s += std::chrono::duration<double>(tl - ts).count();
+            if (store.cycle_count() < target) break; // ran out of polynomials or stopped
+
+            std::vector<std::vector<uint32_t>> colv;
+            colv.reserve(store.cycles.size());
+            for (const Cycle &c : store.cycles) colv.push_back(odd_exponents(store.rels, c));
+            auto deps = find_dependencies(colv, st.fb.p.size(), rows, cols);
+            for (const auto &dep : deps) {
+                ++deps_tried;
+                BigInt g = try_dependency(st, store.rels, store.cycles, dep);
+                if (g != BigInt(static_cast<uint64_t>(1)) && g != n) {
+                    sr.success = true;
+                    sr.factor = g;
+                    break;
+                }
+            }
+            la_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - tl).count();
+            if (sr.success) break;
+            target += target / 20;
+        }
+
+        double total_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        sr.stopped = !sr.success && stop.stop_requested();
+        log << (sr.success ? "siqs factor" : sr.stopped ? "siqs stopped" : "siqs failed") << " (" << digits << " digits, k=" << st.k
+            << ", fb=" << st.fb.p.size() << ", M=" << st.m << ", s=" << st.s << ", lp<" << st.lp_bound
+            << "; " << store.fulls << " full + " << store.partials << " partial relations -> " << store.cycles.size()
+            << " cycles from " << polys.load() << " polys; matrix " << rows << "x" << cols << ", " << deps_tried
+            << " dependencies; sieve " << sieve_s << "s, linear algebra " << la_s << "s, total " << total_s << "s, "
+            << threads << " threads)";
+        sr.metrics.iterations = polys.load();
+        sr.metrics.gcds = deps_tried; // one gcd(X - Y, N) per dependency
+        sr.log = log.str();
+        return sr;
+    }
+}
+
+SiqsResult siqs_factor(const BigInt &n, unsigned threads, uint64_t seed, const utils::StopToken &stop) {
+    return utils::measure([&] { return siqs(n, threads, seed, stop); });
+}
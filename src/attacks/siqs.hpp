@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
+#include <cstdint>
+#include <string>
+
+struct SiqsResult {
+    bool success{false};
+    BigInt factor{static_cast<uint64_t>(0)};
+    bool stopped{false}; // the stop token fired first; log says how far it got
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
+    std::string log;
+};
+
+/*
+ * Self-initializing quadratic sieve: the general-purpose method, its run time only depends on
+ * the size of n (about 30 to 100 digits), not on any weakness of p or q.
+ *
+ * @param threads - workers sieving separate polynomial families (0 = all hardware threads)
+ * @param seed - picks the polynomial families; relations arrive in thread timing order, so
+ *               the factor found (p or q) can differ between runs with threads > 1
+ * @param stop - polled every 32 polynomials while sieving; the linear algebra at the end of a
+ *               round runs to completion
+ */
+SiqsResult siqs_factor(const BigInt &n, unsigned threads = 0, uint64_t seed = 1,
+                       const utils::StopToken &stop = {});
@@ -0,0 +1,352 @@
+#include "smooth.hpp"
+#include "../polymod.hpp"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <utility>
+
+/*
+ * Stage 2 works with V_i = x^i + x^-i (x = stage 1 output), which is the lucas sequence
+ * V_i(V_1). Every prime q in (B1, B2] is q = kD +- j with j < D/2 coprime to D, and
+ *   V_kD - V_j = x^-kD * x^-j * (x^(kD+j) - 1) * (x^(kD-j) - 1)
+ * so one multiply by V_kD - V_j covers both kD + j and kD - j. The baby values V_j are
+ * precomputed, the giant values V_kD follow V_(k+1)D = V_kD * V_D - V_(k-1)D, all in a
+ * ModContext, and gcd(acc, n) is only taken once per block of multiplies.
+ * The polynomial continuation skips the prime walk: with F(X) = prod_j (X - V_j) it
+ * multiplies F(V_kD) for a whole block of k at once (polymod::eval_product).
+ */
+
+namespace smooth {
+    namespace {
+        constexpr size_t kChunkBits = 1 << 16;
+        constexpr size_t kChunkWords = kChunkBits / 64;
+        constexpr size_t kStage2Block = 1 << 12; // stage 2 multiplies per gcd
+        constexpr unsigned long long kDs[] = {2310, 30030, 510510};
+        constexpr unsigned long long kPolyMinSpan = 4000000000ULL; // Auto switches to Poly above this B2 - B1
+
+        unsigned long long max_prime_power_leq(unsigned long long p, unsigned long long B) {
+            unsigned long long pk = p;
+            while (pk <= B / p) pk *= p;
+            return pk;
+        }
+
+        // product of words via a balanced product tree (keeps the big multiplies balanced for gmp)
+        BigInt product_tree(const std::vector<uint64_t> &words) {
+            std::vector<BigInt> level;
+            level.reserve(words.size());
+            for (uint64_t w : words) level.emplace_back(w);
+            if (level.empty()) return BigInt(static_cast<uint64_t>(1));
+            while (level.size() > 1) {
+                size_t half = level.size() / 2;
+                for (size_t i = 0; i < half; ++i) mpz_mul(level[i].raw(), level[2 * i].raw(), level[2 * i + 1].raw());
+                if (level.size() & 1) level[half] = std::move(level.back());
+                level.resize(half + (level.size() & 1));
+            }
+            return std::move(level[0]);
+        }
+
+        // lucas ladder over the bits of e, top bit first: (x, y) = (V_k, V_(k+1))
+        template<typename Bits>
+        void lucas_ladder(ModContext &ctx, BigInt &r, const BigInt &v1, size_t nbits, Bits bit) {
+            BigInt two(static_cast<uint64_t>(2)), y = v1, t;
+            ctx.to_mont(two);
+            BigInt x = two;
+            for (size_t b = nbits; b-- > 0;) {
+                ctx.mulmod(t, x, y);
+                ctx.submod(t, t, v1);
+                if (bit(b)) {
+                    x = std::move(t);
+                    ctx.sqrmod(y, y);
+                    ctx.submod(y, y, two);
+                } else {
+                    y = std::move(t);
+                    ctx.sqrmod(x, x);
+                    ctx.submod(x, x, two);
+                }
+            }
+            r = std::move(x);
+        }
+
+        struct Stage2Plan {
+            unsigned long long D{0};
+            std::vector<unsigned> js;  // 1 <= j < D/2 with gcd(j, D) = 1
+            std::vector<int> slot;     // j -> index into js, -1 when gcd(j, D) > 1
+            unsigned long long k0{0}, k1{0}; // giant steps k with kD - D/2 <= q < kD + D/2 for q in (B1, B2]
+        };
+
+        Stage2Plan plan_stage2(unsigned long long B1, unsigned long long B2, unsigned long long D) {
+            Stage2Plan p;
+            p.D = D;
+            p.slot.assign(D / 2, -1);
+            for (unsigned long long j = 1; j < D / 2; ++j) {
+                if (std::gcd(j, D) != 1) continue;
+                p.slot[j] = static_cast<int>(p.js.size());
+                p.js.push_back(static_cast<unsigned>(j));
+            }
+            p.k0 = (B1 + 1 + D / 2) / D;
+            p.k1 = (B2 + D / 2) / D;
+            return p;
+        }
+
+        /*
+         * bsgs: D balancing the D/2 baby steps against (B2 - B1)/D giant steps.
+         * poly: largest D that still fills one block of giants, i.e. (B2 - B1)/D >= phi(D)/2.
+         */
+        unsigned long long pick_d(unsigned long long B1, unsigned long long B2, bool poly) {
+            unsigned long long span = B2 - B1, best = kDs[0];
+            for (unsigned long long D : kDs) {
+                if (poly) {
+                    unsigned long long half_phi = 0;
+                    for (unsigned long long j = 1; j < D / 2; ++j) half_phi += std::gcd(j, D) == 1;
+                    if (span / D >= half_phi) best = D;
+                } else if (D / 2 + span / D < best / 2 + span / best) {
+                    best = D;
+                }
+            }
+            return best;
+        }
+
+        /*
+         * Shared state of both stage 2 flavours: the V_j babies and the V_kD giant walk, in ctx form.
+         */
+        class VWalk {
+        public:
+            VWalk(ModContext &ctx, const BigInt &v1, const Stage2Plan &plan)
+                : ctx_(ctx), v1_(v1), D_(plan.D) {
+                // V_0 = 2, V_1 = v1, V_(i+1) = V_i * V_1 - V_(i-1)
+                BigInt v0(static_cast<uint64_t>(2)), cur = v1, next;
+                ctx.to_mont(v0);
+                two_ = v0;
+                babies.resize(plan.js.size());
+                for (unsigned long long i = 1; i < plan.D / 2; ++i) {
+                    if (plan.slot[i] >= 0) babies[static_cast<size_t>(plan.slot[i])] = cur;
+                    ctx.mulmod(next, cur, v1);
+                    ctx.submod(next, next, v0);
+                    v0 = std::move(cur);
+                    cur = std::move(next);
+                }
+                // cur = V_(D/2) now, V_D = V_(D/2)^2 - 2
+                ctx.sqrmod(step_, cur);
+                ctx.submod(step_, step_, two_);
+            }
+
+            void seek(unsigned long long k) {
+                k_ = k;
+                cur_ = at(k);
+                prev_ = k ? at(k - 1) : step_;
+            }
+            BigInt at(unsigned long long k) {
+                BigInt w;
+                lucas_v(ctx_, w, v1_, static_cast<uint64_t>(k * D_));
+                return w;
+            }
+            void advance() {
+                ctx_.mulmod(tmp_, cur_, step_);
+                ctx_.submod(tmp_, tmp_, prev_);
+                std::swap(prev_, cur_);
+                std::swap(cur_, tmp_);
+                ++k_;
+            }
+            unsigned long long k() const { return k_; }
+            const BigInt &giant() const { return cur_; }
+            const BigInt &two() const { return two_; }
+
+            std::vector<BigInt> babies;
+
+        private:
+            ModContext &ctx_;
+            const BigInt &v1_;
+            unsigned long long D_;
+            BigInt two_, step_, cur_, prev_, tmp_;
+            unsigned long long k_{0};
+        };
+
+        // V_q - 2 = x^-q (x^q - 1)^2 for the odd primes q dividing D, which no kD +- j covers
+        void stage2_small(ModContext &ctx, VWalk &walk, const BigInt &v1, unsigned long long B1,
+                          unsigned long long B2, const Stage2Plan &plan, BigInt &acc, unsigned long long &muls) {
+            for (unsigned long long q = 3; q <= std::min(B2, plan.D / 2); q += 2) {
+                if (q <= B1 || plan.D % q || plan.slot[q] >= 0) continue;
+                bool prime = true;
+                for (unsigned long long d = 3; d * d <= q; d += 2) prime = prime && q % d;
+                if (!prime) continue;
+                BigInt x;
+                lucas_v(ctx, x, v1, static_cast<uint64_t>(q));
+                ctx.submod(x, x, walk.two());
+                ctx.mulmod(acc, acc, x);
+                ++muls;
+            }
+        }
+
+        Stage2Result stage2_bsgs(ModContext &ctx, const BigInt &v1, unsigned long long B1, unsigned long long B2,
+                                 const Stage2Plan &plan, const utils::StopToken &stop) {
+            const BigInt &n = ctx.modulus();
+            BigInt one(static_cast<uint64_t>(1));
+            Stage2Result st;
+            std::ostringstream how;
+            how << "bsgs D=" << plan.D;
+            st.how = how.str();
+
+            VWalk walk(ctx, v1, plan);
+            BigInt acc = ctx.one(), saved, diff;
+            stage2_small(ctx, walk, v1, B1, B2, plan, acc, st.muls);
+            saved = acc;
+
+            // (k, j) pairs multiplied since the last gcd, for replaying a block that collapses to n
+            std::vector<std::pair<unsigned long long, unsigned>> pending;
+            pending.reserve(kStage2Block + plan.js.size());
+            auto check = [&]() {
+                st.g = BigInt::gcd(acc, n);
+                ++st.gcds;
+                if (st.g == n) {
+                    acc = saved;
+                    unsigned long long last = ~0ULL;
+                    BigInt w;
+                    for (auto [k, j] : pending) {
+                        if (k != last) { w = walk.at(k); last = k; }
+                        ctx.submod(diff, w, walk.babies[static_cast<size_t>(plan.slot[j])]);
+                        ctx.mulmod(acc, acc, diff);
+                        st.g = BigInt::gcd(acc, n);
+                        ++st.gcds;
+                        if (st.g != one) break;
+                    }
+                }
+                pending.clear();
+                saved = acc;
+                if (st.g == one && stop.stop_requested()) st.stopped = true;
+                return st.g != one || st.stopped;
+            };
+
+            std::vector<unsigned char> hit(plan.D / 2, 0);
+            std::vector<unsigned> js_k;
+            auto flush = [&]() {
+                for (unsigned j : js_k) {
+                    ctx.submod(diff, walk.giant(), walk.babies[static_cast<size_t>(plan.slot[j])]);
+                    ctx.mulmod(acc, acc, diff);
+                    pending.emplace_back(walk.k(), j);
+                    hit[j] = 0;
+                }
+                st.muls += js_k.size();
+                js_k.clear();
+                return pending.size() >= kStage2Block && check();
+            };
+
+            walk.seek(plan.k0);
+            utils::PrimeSieve sieve(B1 + 1, B2);
+            for (uint64_t q = sieve.next(); q; q = sieve.next()) {
+                unsigned long long k = (q + plan.D / 2) / plan.D;
+                unsigned long long kd = k * plan.D;
+                auto j = static_cast<unsigned>(q > kd ? q - kd : kd - q);
+                if (plan.slot[j] < 0) continue; // q | D, done by stage2_small
+                while (walk.k() < k) {
+                    if (flush()) return st;
+                    walk.advance();
+                }
+                if (!hit[j]) {
+                    hit[j] = 1;
+                    js_k.push_back(j);
+                }
+            }
+            if (!flush()) check();
+            return st;
+        }
+
+        Stage2Result stage2_poly(ModContext &ctx, const BigInt &v1, unsigned long long B1, unsigned long long B2,
+                                 const Stage2Plan &plan, const utils::StopToken &stop) {
+            const BigInt &n = ctx.modulus();
+            BigInt one(static_cast<uint64_t>(1));
+            Stage2Result st;
+            std::ostringstream how;
+            how << "poly D=" << plan.D;
+            st.how = how.str();
+
+            VWalk walk(ctx, v1, plan);
+            polymod::Poly f = polymod::from_roots(walk.babies, n);
+            BigInt acc = ctx.one(), saved, diff;
+            stage2_small(ctx, walk, v1, B1, B2, plan, acc, st.muls);
+
+            // one block of giants per polynomial evaluation, as many as F has roots
+            size_t block = plan.js.size();
+            std::vector<BigInt> giants;
+            giants.reserve(block);
+            walk.seek(plan.k0);
+            for (unsigned long long k = plan.k0; k <= plan.k1;) {
+                giants.clear();
+                for (; k <= plan.k1 && giants.size() < block; ++k) {
+                    giants.push_back(walk.giant());
+                    walk.advance();
+                }
+                saved = acc;
+                ctx.mulmod(acc, acc, polymod::eval_product(f, giants, n));
+                st.muls += giants.size() * block;
+                st.g = BigInt::gcd(acc, n);
+                ++st.gcds;
+                if (st.g == one) {
+                    if (stop.stop_requested()) {
+                        st.stopped = true;
+                        return st;
+                    }
+                    continue;
+                }
+                if (st.g == n) {
+                    // replay the block pair by pair
+                    acc = saved;
+                    for (size_t i = 0; i < giants.size() && st.g == n; ++i) {
+                        for (const BigInt &b : walk.babies) {
+                            ctx.submod(diff, giants[i], b);
+                            ctx.mulmod(acc, acc, diff);
+                            st.g = BigInt::gcd(acc, n);
+                            ++st.gcds;
+                            if (st.g != one) break;
+                        }
+                    }
+                }
+                return st;
+            }
+            st.g = BigInt::gcd(acc, n);
+            ++st.gcds;
+            return st;
+        }
+    }
+
+    ExponentChunks::ExponentChunks(unsigned long long B1) : B1_(B1), sieve_(2, B1) {}
+
+    bool ExponentChunks::next(BigInt &e, std::vector<uint64_t> &words) {
+        words.clear();
+        for (uint64_t p = sieve_.next(); p; p = sieve_.next()) {
+            uint64_t pk = max_prime_power_leq(p, B1_);
+            if (acc_ > std::numeric_limits<uint64_t>::max() / pk) {
+                words.push_back(acc_);
+                acc_ = 1;
+            }
+            acc_ *= pk;
+            if (words.size() == kChunkWords) break;
+        }
+        if (words.size() < kChunkWords && acc_ > 1) {
+            // sieve ran dry: the partial word closes the last chunk
+            words.push_back(acc_);
+            acc_ = 1;
+        }
+        if (words.empty()) return false;
+        e = product_tree(words);
+        return true;
+    }
+
+    void lucas_v(ModContext &ctx, BigInt &r, const BigInt &v1, const BigInt &e) {
+        lucas_ladder(ctx, r, v1, e.bit_length(), [&](size_t b) { return mpz_tstbit(e.raw(), b) != 0; });
+    }
+
+    void lucas_v(ModContext &ctx, BigInt &r, const BigInt &v1, uint64_t e) {
+        size_t nbits = e ? 64 - static_cast<size_t>(__builtin_clzll(e)) : 0;
+        lucas_ladder(ctx, r, v1, nbits, [&](size_t b) { return (e >> b) & 1; });
+    }
+
+    Stage2Result stage2(ModContext &ctx, const BigInt &v1_in, unsigned long long B1, unsigned long long B2,
+                        Stage2Mode mode, const utils::StopToken &stop) {
+        BigInt v1 = v1_in;
+        ctx.to_mont(v1);
+        bool poly = mode == Stage2Mode::Poly || (mode == Stage2Mode::Auto && B2 - B1 >= kPolyMinSpan);
+        return poly ? stage2_poly(ctx, v1, B1, B2, plan_stage2(B1, B2, pick_d(B1, B2, true)), stop)
+                    : stage2_bsgs(ctx, v1, B1, B2, plan_stage2(B1, B2, pick_d(B1, B2, false)), stop);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../bigint.hpp"
+#include "../utils/primes.hpp"
+#include "../utils/stop.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Pieces shared by pollards_pminus1 and williams_pplus1. Both wait for a smooth group order
+ * (p - 1 for (Z/pZ)*, p + 1 for the norm-1 elements of F_(p^2)), so they run the same
+ * stage 1 exponent and, once the group element x is folded into V_1 = x + x^-1, the same
+ * lucas-sequence stage 2.
+ */
+namespace smooth {
+    /*
+     * Stage 2 flavours:
+     *   Bsgs - baby-step giant-step over the primes in (B1, B2], primes kD - j and kD + j share
+     *          one multiply, one gcd per block of multiplies
+     *   Poly - polynomial continuation: every kD +- j is covered by evaluating prod_j (X - b_j)
+     *          at a block of giant steps with product/remainder trees (wins for huge B2)
+     *   Auto - Poly once B2 - B1 is large enough for it to pay off, Bsgs below that
+     */
+    enum class Stage2Mode { Auto, Bsgs, Poly };
+
+    /*
+     * The stage 1 exponent E = prod p^floor(log_p B1) over the primes <= B1, handed out in
+     * chunks of ~64k bits. Prime powers are packed into 64-bit words and the words of a chunk
+     * multiplied with a product tree; the words come along so a caller can replay a chunk
+     * word by word when its gcd collapses to n. Primes are streamed from a segmented sieve.
+     */
+    class ExponentChunks {
+    public:
+        explicit ExponentChunks(unsigned long long B1);
+
+        // e = product of `words`; false once E is used up
+        bool next(BigInt &e, std::vector<uint64_t> &words);
+
+    private:
+        unsigned long long B1_;
+        utils::PrimeSieve sieve_;
+        uint64_t acc_{1};
+    };
+
+    // r = V_e(v1), the lucas sequence V_0 = 2, V_1 = v1, V_(i+1) = v1 V_i - V_(i-1); ctx form
+    void lucas_v(ModContext &ctx, BigInt &r, const BigInt &v1, const BigInt &e);
+    void lucas_v(ModContext &ctx, BigInt &r, const BigInt &v1, uint64_t e);
+
+    struct Stage2Result {
+        BigInt g; // gcd where stage 2 stopped: 1, n or a factor
+        unsigned long long muls{0};
+        unsigned long long gcds{0};
+        bool stopped{false}; // `stop` fired before B2 was reached
+        std::string how;
+    };
+
+    /*
+     * Stage 2 on v1 = x + x^-1 (normal domain) for the stage 1 output x: finds p when the order
+     * of x mod p is one prime q in (B1, B2]. `stop` is polled once per gcd block.
+     */
+    Stage2Result stage2(ModContext &ctx, const BigInt &v1, unsigned long long B1, unsigned long long B2,
+                        Stage2Mode mode, const utils::StopToken &stop = {});
+}
@@ -0,0 +1,129 @@
+#include "squfof.hpp"
+#include "../mont_word.hpp"
+#include <cmath>
+#include <iterator>
+#include <sstream>
+
+/*
+ * SQUFOF (Shanks' square forms factorization).
+ * Walks the continued fraction expansion of sqrt(kN) keeping the quadratic form
+ * (P_i, Q_i); once some Q_i at an even index is a perfect square r^2, the form reduced
+ * from (P_i, r) is walked again until P repeats, and gcd(N, Q) is a factor of N.
+ * Expected ~N^(1/4) steps, each a handful of word operations, which beats rho's
+ * N^(1/4) multiplies mod N by a large constant for N below 2^62.
+ * Not every (N, k) cycle yields a factor, so the usual multiplier list (products of
+ * 3, 5, 7, 11) is tried in order until one does.
+ */
+
+namespace {
+    constexpr uint64_t kMultipliers[] = {1, 3, 5, 7, 11, 3 * 5, 3 * 7, 3 * 11, 5 * 7, 5 * 11, 7 * 11,
+                                         3 * 5 * 7, 3 * 5 * 11, 3 * 7 * 11, 5 * 7 * 11, 3 * 5 * 7 * 11};
+
+    uint64_t isqrt(uint64_t x) {
+        auto r = static_cast<uint64_t>(std::sqrt(static_cast<double>(x)));
+        while (static_cast<mont::u128>(r) * r > x) --r;
+        while (static_cast<mont::u128>(r + 1) * (r + 1) <= x) ++r;
+        return r;
+    }
+
+    // x is a square -> r = sqrt(x); squares mod 64 reject 81% of x without the root
+    bool is_square(uint64_t x, uint64_t &r) {
+        constexpr uint64_t kSquaresMod64 = 0x0202021202030213ULL; // bit i: i is a square mod 64
+        if (!((kSquaresMod64 >> (x & 63)) & 1)) return false;
+        r = isqrt(x);
+        return r * r == x;
+    }
+
+    // one multiplier k; 0 when this cycle gives nothing
+    uint64_t squfof_k(uint64_t n, uint64_t k) {
+        uint64_t d = k * n;
+        uint64_t p0 = isqrt(d);
+        uint64_t pprev = p0, p = p0, qprev = 1, q = d - p0 * p0, r = 0;
+        if (q == 0) return 0;
+        auto bound = static_cast<uint64_t>(6 * std::sqrt(2 * std::sqrt(static_cast<double>(d))));
+
+        // forward cycle until a square form shows up at an even index
+        uint64_t i = 2;
+        for (; i < bound; ++i) {
+            uint64_t b = (p0 + p) / q;
+            p = b * q - p;
+            uint64_t t = q;
+            q = qprev + b * (pprev - p); // pprev - p may wrap, the sum doesn't
+            if (!(i & 1) && is_square(q, r)) break;
+            qprev = t;
+            pprev = p;
+        }
+        if (i >= bound) return 0;
+
+        // reverse cycle from the square root form until P stops changing
+        uint64_t b = (p0 - p) / r;
+        pprev = p = b * r + p;
+        qprev = r;
+        q = (d - pprev * pprev) / qprev;
+        for (i = 0; i < bound; ++i) {
+            b = (p0 + p) / q;
+            pprev = p;
+            p = b * q - p;
+            uint64_t t = q;
+            q = qprev + b * (pprev - p);
+            qprev = t;
+            if (p == pprev) break;
+        }
+        if (i >= bound) return 0;
+        uint64_t g = mont::gcd_word(n, qprev);
+        return g != 1 && g != n ? g : 0;
+    }
+
+    // squfof_u64 with a stop check between multipliers; `tried` counts the multipliers run
+    uint64_t squfof_stoppable(uint64_t n, const utils::StopToken &stop, unsigned &tried) {
+        tried = 0;
+        if (n < 4 || n >> kSqufofMaxBits) return 0;
+        for (uint64_t p : {2, 3, 5, 7, 11}) {
+            if (n % p == 0) return n == p ? 0 : p;
+        }
+        uint64_t r;
+        if (is_square(n, r)) return r;
+        for (uint64_t k : kMultipliers) {
+            if (n > UINT64_MAX / k || stop.stop_requested()) break;
+            ++tried;
+            uint64_t f = squfof_k(n, k);
+            if (f) return f;
+        }
+        return 0;
+    }
+}
+
+uint64_t squfof_u64(uint64_t n) {
+    unsigned tried = 0;
+    return squfof_stoppable(n, {}, tried);
+}
+
+SqufofResult squfof_factor(const BigInt &n, const utils::StopToken &stop) {
+    utils::MetricsClock clock;
+    SqufofResult sr;
+    sr.metrics.unit = "multipliers";
+    if (n.bit_length() > kSqufofMaxBits) {
+        sr.log = "n has " + std::to_string(n.bit_length()) + " bits, squfof takes up to " +
+                 std::to_string(kSqufofMaxBits);
+        clock.stamp(sr.metrics);
+        return sr;
+    }
+    unsigned tried = 0;
+    uint64_t f = squfof_stoppable(mont::to_u64(n), stop, tried);
+    if (f) {
+        sr.success = true;
+        sr.factor = BigInt(f);
+        std::ostringstream log;
+        log << "squfof: " << n << " = " << f << " * " << mont::to_u64(n) / f;
+        sr.log = log.str();
+    } else if (stop.stop_requested()) {
+        sr.stopped = true;
+        sr.log = "stopped after " + std::to_string(tried) + " of " + std::to_string(std::size(kMultipliers)) +
+                 " multipliers";
+    } else {
+        sr.log = "no factor found (n prime or every multiplier failed)";
+    }
+    sr.metrics.iterations = tried;
+    clock.stamp(sr.metrics);
+    return sr;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
+#include <cstdint>
+#include <string>
+
+struct SqufofResult {
+    bool success{false};
+    BigInt factor{static_cast<uint64_t>(0)};
+    bool stopped{false}; // the stop token fired first; log says how far it got
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
+    std::string log;
+};
+
+// largest n squfof_u64 takes: k*n has to fit in 64 bits for the multipliers to help
+constexpr unsigned kSqufofMaxBits = 62;
+
+/*
+ * Shanks' square forms factorization on one machine word.
+ * Factors 2, 3, 5, 7 and 11 are split off by division first (they hide in the multipliers).
+ * Returns a proper factor of n, or 0 (n prime, n >= 2^62, or every multiplier failed).
+ */
+uint64_t squfof_u64(uint64_t n);
+
+/*
+ * squfof_u64 for a BigInt n of at most kSqufofMaxBits bits.
+ * One multiplier's cycle is at most a few hundred thousand word steps, so `stop` is polled
+ * between multipliers.
+ */
+SqufofResult squfof_factor(const BigInt &n, const utils::StopToken &stop = {});
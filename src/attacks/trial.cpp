@@ -0,0 +1,247 @@
+#include "trial.hpp"
+#include "../utils/primes.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+/*
+ * Trial division as gcds. g = gcd(n, P) with P the product of all primes <= limit is the
+ * product of the distinct small primes dividing n; for an rsa modulus it is 1 and we are done
+ * after a single reduction of P mod n. Otherwise g is split against the primorial blocks
+ * (~kBlockBits each), and only the blocks where gcd(g, block) > 1 are searched prime by prime.
+ *
+ * For many keys the same thing runs on a remainder tree: R_root = P mod prod n_i over the
+ * full primorial P, R_child = R_parent mod child, and at the leaves gcd(P mod n_i, n_i) says
+ * whether n_i has any small factor at all. Keys go through in groups of kGroup per tree.
+ *
+ * The tables cost one sieve and a product tree per limit; they are cached for the life of the
+ * process and never change after construction, so worker threads read them without locking.
+ */
+
+namespace {
+    constexpr size_t kBlockBits = 1 << 15;
+    constexpr size_t kGroup = 1024;
+
+    // balanced product tree (keeps the big multiplies balanced for gmp)
+    BigInt product_tree(std::vector<BigInt> level) {
+        if (level.empty()) return BigInt(static_cast<uint64_t>(1));
+        while (level.size() > 1) {
+            size_t half = level.size() / 2;
+            for (size_t i = 0; i < half; ++i) mpz_mul(level[i].raw(), level[2 * i].raw(), level[2 * i + 1].raw());
+            if (level.size() & 1) level[half] = std::move(level.back());
+            level.resize(half + (level.size() & 1));
+        }
+        return std::move(level[0]);
+    }
+
+    class PrimorialTable {
+    public:
+        struct Block {
+            BigInt product;
+            size_t first, last; // primes[first, last)
+        };
+
+        explicit PrimorialTable(uint64_t limit) {
+            utils::PrimeSieve sieve(2, limit);
+            std::vector<BigInt> words, block_products;
+            uint64_t word = 1;
+            size_t bits = 0, first = 0;
+            auto close_block = [&] {
+                if (word > 1) words.emplace_back(word);
+                word = 1;
+                if (words.empty()) return;
+                blocks.push_back(Block{product_tree(std::move(words)), first, primes.size()});
+                block_products.push_back(blocks.back().product);
+                words.clear();
+                bits = 0;
+                first = primes.size();
+            };
+            for (uint64_t p = sieve.next(); p; p = sieve.next()) {
+                if (word > std::numeric_limits<uint64_t>::max() / p) {
+                    words.emplace_back(word);
+                    word = 1;
+                    bits += 64;
+                    if (bits >= kBlockBits) close_block();
+                }
+                word *= p;
+                primes.push_back(static_cast<uint32_t>(p));
+            }
+            close_block();
+            all = product_tree(std::move(block_products));
+        }
+
+        static const PrimorialTable &get(uint64_t limit) {
+            static std::mutex mu;
+            static std::map<uint64_t, std::unique_ptr<PrimorialTable>> cache;
+            std::lock_guard<std::mutex> lock(mu);
+            auto &slot = cache[limit];
+            if (!slot) slot = std::make_unique<PrimorialTable>(limit);
+            return *slot;
+        }
+
+        std::vector<uint32_t> primes;
+        std::vector<Block> blocks;
+        BigInt all; // product of every prime <= limit
+    };
+
+    uint64_t clamp_limit(uint64_t limit) {
+        return std::min<uint64_t>(limit, std::numeric_limits<uint32_t>::max());
+    }
+
+    /*
+     * g = product of distinct primes <= limit dividing n.
+     * Splits g against the blocks, then the hit blocks against their primes, and divides every
+     * prime found out of the cofactor as often as it goes.
+     */
+    void split(const BigInt &g, const PrimorialTable &table, TrialResult &res, const utils::StopToken &stop) {
+        BigInt rest = g, h;
+        for (const auto &block : table.blocks) {
+            if (mpz_cmp_ui(rest.raw(), 1) == 0) break;
+            if (stop.stop_requested()) {
+                res.stopped = true;
+                break;
+            }
+            mpz_gcd(h.raw(), rest.raw(), block.product.raw());
+            ++res.metrics.iterations;
+            ++res.metrics.gcds;
+            if (mpz_cmp_ui(h.raw(), 1) == 0) continue;
+            mpz_divexact(rest.raw(), rest.raw(), h.raw());
+            for (size_t i = block.first; i < block.last && mpz_cmp_ui(h.raw(), 1) != 0; ++i) {
+                uint32_t p = table.primes[i];
+                if (!mpz_divisible_ui_p(h.raw(), p)) continue;
+                mpz_divexact_ui(h.raw(), h.raw(), p);
+                while (mpz_divisible_ui_p(res.cofactor.raw(), p)) {
+                    mpz_divexact_ui(res.cofactor.raw(), res.cofactor.raw(), p);
+                    res.primes.push_back(p);
+                }
+            }
+        }
+    }
+
+    void finish(TrialResult &res, uint64_t limit) {
+        std::ostringstream log;
+        res.success = !res.primes.empty();
+        if (!res.success) {
+            log << "no prime <= " << limit << " divides n";
+        } else {
+            log << "trial division <= " << limit << ": ";
+            for (size_t i = 0; i < res.primes.size();) {
+                size_t j = i;
+                while (j < res.primes.size() && res.primes[j] == res.primes[i]) ++j;
+                log << (i ? " * " : "") << res.primes[i];
+                if (j - i > 1) log << "^" << j - i;
+                i = j;
+            }
+            log << ", cofactor " << res.cofactor.bit_length() << " bits";
+        }
+        if (res.stopped) log << " (stopped before every block was split)";
+        res.log = log.str();
+    }
+
+    bool too_small(const BigInt &n, TrialResult &res) {
+        if (mpz_cmp_ui(n.raw(), 2) >= 0) return false;
+        res.cofactor = n;
+        res.log = "n must be >= 2";
+        return true;
+    }
+
+    // results for ns[lo, hi) through one remainder tree
+    void trial_group(const std::vector<BigInt> &ns, size_t lo, size_t hi, const PrimorialTable &table,
+                     uint64_t limit, std::vector<TrialResult> &out, const utils::StopToken &stop) {
+        utils::MetricsClock clock;
+        std::vector<std::vector<BigInt>> levels(1);
+        for (size_t i = lo; i < hi; ++i) {
+            out[i].cofactor = ns[i];
+            // n < 2 would zero the whole product; give it a harmless 1 slot instead
+            levels[0].push_back(too_small(ns[i], out[i]) ? BigInt(static_cast<uint64_t>(1)) : ns[i]);
+        }
+        while (levels.back().size() > 1) {
+            const auto &below = levels.back();
+            std::vector<BigInt> up((below.size() + 1) / 2);
+            for (size_t i = 0; i < up.size(); ++i) {
+                if (2 * i + 1 < below.size()) mpz_mul(up[i].raw(), below[2 * i].raw(), below[2 * i + 1].raw());
+                else up[i] = below[2 * i];
+            }
+            levels.push_back(std::move(up));
+        }
+
+        std::vector<BigInt> rems{table.all % levels.back()[0]};
+        for (size_t l = levels.size() - 1; l-- > 0;) {
+            const auto &nodes = levels[l];
+            std::vector<BigInt> next(nodes.size());
+            for (size_t i = 0; i < nodes.size(); ++i) mpz_mod(next[i].raw(), rems[i / 2].raw(), nodes[i].raw());
+            rems = std::move(next);
+        }
+
+        BigInt g;
+        for (size_t i = lo; i < hi; ++i) {
+            if (!out[i].log.empty()) continue; // too small
+            mpz_gcd(g.raw(), rems[i - lo].raw(), ns[i].raw());
+            ++out[i].metrics.gcds;
+            if (mpz_cmp_ui(g.raw(), 1) != 0) split(g, table, out[i], stop);
+            finish(out[i], limit);
+        }
+        // one tree serves the whole group, so every key of it carries the group's times
+        utils::Metrics spent;
+        clock.stamp(spent);
+        for (size_t i = lo; i < hi; ++i) {
+            utils::Metrics &m = out[i].metrics;
+            m.unit = "blocks";
+            m.wall_s = spent.wall_s;
+            m.cpu_s = spent.cpu_s;
+            m.allocations = spent.allocations;
+            m.peak_rss_kb = spent.peak_rss_kb;
+        }
+    }
+}
+
+TrialResult trial_division(const BigInt &n, uint64_t limit, const utils::StopToken &stop) {
+    return utils::measure([&] {
+        TrialResult res;
+        res.metrics.unit = "blocks";
+        if (too_small(n, res)) return res;
+        limit = clamp_limit(limit);
+        res.cofactor = n;
+        const PrimorialTable &table = PrimorialTable::get(limit);
+        BigInt g = BigInt::gcd(n, table.all);
+        ++res.metrics.gcds;
+        if (mpz_cmp_ui(g.raw(), 1) != 0) split(g, table, res, stop);
+        finish(res, limit);
+        return res;
+    });
+}
+
+std::vector<TrialResult> trial_division_batch(const std::vector<BigInt> &ns, uint64_t limit, unsigned threads,
+                                              const utils::StopToken &stop) {
+    std::vector<TrialResult> out(ns.size());
+    if (ns.empty()) return out;
+    limit = clamp_limit(limit);
+    const PrimorialTable &table = PrimorialTable::get(limit);
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    size_t groups = (ns.size() + kGroup - 1) / kGroup;
+    std::atomic<size_t> next{0};
+    auto run = [&] {
+        for (size_t gi = next++; gi < groups; gi = next++) {
+            size_t lo = gi * kGroup, hi = std::min(ns.size(), (gi + 1) * kGroup);
+            if (stop.stop_requested()) {
+                for (size_t i = lo; i < hi; ++i) {
+                    out[i].cofactor = ns[i];
+                    out[i].stopped = true;
+                    out[i].log = "stopped before this key's group";
+                }
+                continue;
+            }
+            trial_group(ns, lo, hi, table, limit, out, stop);
+        }
+    };
+    std::vector<std::jthread> pool;
+    pool.reserve(std::min<size_t>(threads, groups));
+    for (size_t t = 0; t < std::min<size_t>(threads, groups); ++t) pool.emplace_back(run);
+    return out;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TrialResult {
+    bool success{false};         // some prime <= limit divides n
+    std::vector<uint64_t> primes; // small prime factors with multiplicity, ascending
+    BigInt cofactor{static_cast<uint64_t>(0)}; // n with those divided out
+    bool stopped{false}; // the stop token fired first; primes may be incomplete
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
+    std::string log;
+};
+
+/*
+ * Trial division by every prime <= limit without dividing one prime at a time:
+ * gcd of n with the primorial, then only the primorial blocks that hit are searched prime by prime.
+ * The primes and block products for a given limit are built on first use and shared by every
+ * later call (from any thread). `stop` is polled between primorial blocks.
+ */
+TrialResult trial_division(const BigInt &n, uint64_t limit = 1000000ULL, const utils::StopToken &stop = {});
+
+/*
+ * Same for many n at once: a remainder tree pushes the whole primorial down a product tree of
+ * the n, so each key only pays for one gcd with a number of its own size.
+ *
+ * @param threads - workers, each running its own tree over a slice of ns (0 = all hardware threads)
+ * @param stop - polled between groups of 1024 keys; keys of groups never started come back
+ *               with stopped set and no primes
+ * The metrics of each key carry the wall / cpu time of the whole group of keys it went through with.
+ */
+std::vector<TrialResult> trial_division_batch(const std::vector<BigInt> &ns,
+                                              uint64_t limit = 1000000ULL,
+                                              unsigned threads = 0,
+                                              const utils::StopToken &stop = {});
@@ -63,9 +63,17 @@ static bool is_perfect_square(const BigInt &x, BigInt &root_out) {
     return false;
 }
 
-static bool try_convergents(const std::vector<ConvPair>& convs, const BigInt &n, const BigInt &e, WienerResult &res, std::ostringstream &log, const char *tag) {
+static bool try_convergents(const std::vector<ConvPair>& convs, const BigInt &n, const BigInt &e, WienerResult &res, std::ostringstream &log, const char *tag,
+                            const utils::StopToken &stop) {
     BigInt one(static_cast<uint64_t>(1)); BigInt two(static_cast<uint64_t>(2)); BigInt four(static_cast<uint64_t>(4));
     for(size_t i=0;i<convs.size(); ++i) {
+        // each convergent costs a few multiplies and maybe a square root, poll every 64
+        if(i % 64 == 63 && stop.stop_requested()) {
+            res.stopped = true;
+            log << " stopped(" << tag << ") at convergent " << i << "/" << convs.size() << ";";
+            return false;
+        }
+        ++res.metrics.iterations;
         const auto &c = convs[i];
         BigInt k = c.num; // numerator
         BigInt d = c.den; // denominator candidate
@@ -101,20 +109,23 @@ static bool try_convergents(const std::vector<ConvPair>& convs, const BigInt &n,
     return false;
 }
 
-WienerResult wiener_attack(const BigInt &n, const BigInt &e) {
+WienerResult wiener_attack(const BigInt &n, const BigInt &e, const utils::StopToken &stop) {
+    utils::MetricsClock clock;
     WienerResult res; std::ostringstream log;
+    res.metrics.unit = "convergents";
     // we test cf of e/n and n/e (numerical stability) and stop on first success
     auto cf_en = cf_expand(e, n);
     auto convs_en = build_convergents(cf_en);
     log << "cf(e/n)=" << cf_en.size() << " convs=" << convs_en.size() << ";";
-    if(try_convergents(convs_en, n, e, res, log, "e/n")) {
-        res.log = log.str(); return res;
+    if(try_convergents(convs_en, n, e, res, log, "e/n", stop) || res.stopped) {
+        res.log = log.str(); clock.stamp(res.metrics); return res;
     }
     auto cf_ne = cf_expand(n, e);
     auto convs_ne = build_convergents(cf_ne);
     log << " cf(n/e)=" << cf_ne.size() << " convs=" << convs_ne.size() << ";";
-    try_convergents(convs_ne, n, e, res, log, "n/e");
-    if(!res.success) log << " no wiener small-d found";
+    try_convergents(convs_ne, n, e, res, log, "n/e", stop);
+    if(!res.success && !res.stopped) log << " no wiener small-d found";
     res.log = log.str();
+    clock.stamp(res.metrics);
     return res;
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../bigint.hpp"
+#include "../utils/metrics.hpp"
+#include "../utils/stop.hpp"
 #include <string>
 
 struct WienerResult {
@@ -8,8 +10,11 @@ struct WienerResult {
     BigInt p{static_cast<uint64_t>(0)};
     BigInt q{static_cast<uint64_t>(0)};
     BigInt d{static_cast<uint64_t>(0)};
+    bool stopped{false}; // the stop token fired first; log says how far it got
+    utils::Metrics metrics; // what the call cost, see utils/metrics.hpp
     std::string log;
 };
 
-WienerResult wiener_attack(const BigInt &n, const BigInt &e);
+// `stop` is polled every 64 convergents
+WienerResult wiener_attack(const BigInt &n, const BigInt &e, const utils::StopToken &stop = {});
 
@@ -0,0 +1,197 @@
+#include "batch.hpp"
+#include "pipeline.hpp"
+#include "utils/json.hpp"
+#include "utils/stop.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * The reader (calling thread) only splits lines; parsing, factoring and formatting happen on
+ * the workers, so a malformed line is reported in the same stream and order as everything else.
+ * Each worker owns one key end to end; the pipeline under it starts its own stage threads.
+ */
+
+namespace batch {
+    namespace {
+        struct Job {
+            size_t line;
+            std::string text;
+        };
+
+        // fixed capacity fifo; push blocks while full, pop returns nullopt once closed and drained
+        template <class T>
+        class BoundedQueue {
+        public:
+            explicit BoundedQueue(size_t cap) : cap_(std::max<size_t>(1, cap)) {}
+
+            void push(T item) {
+                std::unique_lock<std::mutex> lock(mu_);
+                not_full_.wait(lock, [&] { return q_.size() < cap_; });
+                q_.push_back(std::move(item));
+                not_empty_.notify_one();
+            }
+
+            std::optional<T> pop() {
+                std::unique_lock<std::mutex> lock(mu_);
+                not_empty_.wait(lock, [&] { return !q_.empty() || closed_; });
+                if (q_.empty()) return std::nullopt;
+                T item = std::move(q_.front());
+                q_.pop_front();
+                not_full_.notify_one();
+                return item;
+            }
+
+            void close() {
+                std::lock_guard<std::mutex> lock(mu_);
+                closed_ = true;
+                not_empty_.notify_all();
+            }
+
+        private:
+            size_t cap_;
+            std::deque<T> q_;
+            bool closed_{false};
+            std::mutex mu_;
+            std::condition_variable not_full_, not_empty_;
+        };
+
+        // decimal / 0x hex, as a JSON string or bare number
+        std::optional<BigInt> number(const utils::json::Value &v) {
+            using Kind = utils::json::Value::Kind;
+            if (v.kind != Kind::String && v.kind != Kind::Number) return std::nullopt;
+            // bare numbers must be plain non-negative integers, not 1e300 or -5
+            if (v.text.empty() || v.text[0] == '-') return std::nullopt;
+            if (v.kind == Kind::Number && v.text.find_first_not_of("0123456789") != std::string::npos) {
+                return std::nullopt;
+            }
+            try {
+                return BigInt(v.text);
+            } catch (const std::exception &) {
+                return std::nullopt;
+            }
+        }
+
+        struct Outcome {
+            std::string json;
+            bool factored{false};
+            bool error{false};
+        };
+
+        Outcome error(utils::json::Writer &w, const std::string &what) {
+            return {w.field("ok", false).field("error", what).str(), false, true};
+        }
+
+        Outcome solve(const Job &job, const Options &opt) {
+            using utils::json::Value;
+            utils::json::Writer w;
+            w.field("line", static_cast<unsigned long long>(job.line));
+
+            std::string err;
+            auto obj = utils::json::parse_object(job.text, err);
+            if (!obj) return error(w, "bad json: " + err);
+            if (auto id = obj->find("id"); id != obj->end()) w.raw("id", utils::json::dump(id->second));
+
+            auto field = [&](const char *key) -> const Value * {
+                auto it = obj->find(key);
+                return it == obj->end() || it->second.kind == Value::Kind::Null ? nullptr : &it->second;
+            };
+            const Value *n_v = field("n");
+            if (!n_v) return error(w, "missing n");
+            auto n = number(*n_v);
+            if (!n || n->is_zero()) return error(w, "bad n");
+
+            pipeline::Options po;
+            po.threads = opt.threads_per_key;
+            po.seed = opt.seed;
+            po.cheap_ms = opt.cheap_ms;
+            if (opt.heavy_ms) po.rho_ms = po.pminus1_ms = po.ecm_ms = po.siqs_ms = opt.heavy_ms;
+            if (const Value *e_v = field("e")) {
+                auto e = number(*e_v);
+                if (!e) return error(w, "bad e");
+                po.e = *e;
+            }
+            std::optional<BigInt> c;
+            if (const Value *c_v = field("c")) {
+                c = number(*c_v);
+                if (!c) return error(w, "bad c");
+            }
+            if (const Value *r_v = field("related")) {
+                if (r_v->kind != Value::Kind::Array) return error(w, "related must be an array");
+                for (const Value &item : r_v->items) {
+                    auto r = number(item);
+                    if (!r) return error(w, "bad related item");
+                    po.related.push_back(*r);
+                }
+            }
+
+            utils::StopToken stop = utils::StopToken{}.within(std::chrono::milliseconds(opt.key_ms));
+            pipeline::Result pr = pipeline::auto_factor(*n, po, stop);
+
+            w.field("ok", pr.success);
+            if (pr.success) {
+                w.field("stage", pr.stage).field("p", pr.p.to_hex()).field("q", pr.q.to_hex());
+                if (!pr.d.is_zero()) {
+                    w.field("d", pr.d.to_hex());
+                    if (c) w.field("m", BigInt::powm(*c, pr.d, *n).to_hex());
+                }
+            }
+            w.field("seconds", pr.seconds);
+            std::string stages = "[";
+            for (const pipeline::StageReport &s : pr.stages) {
+                if (stages.size() > 1) stages += ',';
+                stages += utils::json::Writer()
+                              .field("name", s.name)
+                              .field("status", pipeline::status_name(s.status))
+                              .field("seconds", s.seconds)
+                              .raw("metrics", s.metrics.json())
+                              .field("log", s.log)
+                              .str();
+            }
+            w.raw("stages", stages + "]");
+            return {w.str(), pr.success, false};
+        }
+    }
+
+    Summary run(std::istream &in, std::ostream &out, const Options &opt) {
+        auto t0 = std::chrono::steady_clock::now();
+        unsigned workers = opt.workers ? opt.workers : std::max(1u, std::thread::hardware_concurrency());
+        BoundedQueue<Job> queue(opt.queue ? opt.queue : 4 * static_cast<size_t>(workers));
+        Summary sum;
+        std::mutex out_mu;
+
+        auto work = [&] {
+            while (auto job = queue.pop()) {
+                Outcome o = solve(*job, opt);
+                std::lock_guard<std::mutex> lock(out_mu);
+                out << o.json << "\n" << std::flush;
+                ++sum.keys;
+                sum.factored += o.factored;
+                sum.errors += o.error;
+            }
+        };
+
+        {
+            std::vector<std::jthread> pool;
+            pool.reserve(workers);
+            for (unsigned i = 0; i < workers; ++i) pool.emplace_back(work);
+
+            std::string text;
+            for (size_t line = 1; std::getline(in, text); ++line) {
+                size_t a = text.find_first_not_of(" \t\r");
+                if (a == std::string::npos || text[a] == '#') continue;
+                queue.push({line, std::move(text)});
+            }
+            queue.close();
+        } // joins
+
+        sum.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return sum;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+/*
+ * Headless job mode: one target per JSON line in, one result per JSON line out.
+ *
+ * Input, one object per line (blank lines and lines starting with '#' are skipped):
+ *   {"id": "key-17", "n": "0x...", "e": 65537, "c": "0x...", "related": ["0x...", ...]}
+ * n is required; e, c, related and id are optional. Numbers are decimal or "0x" hex, quoted
+ * or bare. Every key goes through pipeline::auto_factor; with e known and n factored the
+ * result carries d, and with c given also m = c^d mod n.
+ *
+ * Output, one object per input line, written and flushed the moment that key is done (so in
+ * completion order, not input order; "line" and "id" tie it back to the input):
+ *   {"line":3,"id":"key-17","ok":true,"stage":"fermat","p":"0x...","q":"0x...","d":"0x...",
+ *    "m":"0x...","seconds":0.012,"stages":[{"name":"trial","status":"cancelled","seconds":0.01,"log":"..."},...]}
+ *   {"line":4,"ok":false,"error":"..."}       bad line
+ *   {"line":5,"id":...,"ok":false,"seconds":...,"stages":[...]}   nothing found in budget
+ */
+namespace batch {
+    struct Options {
+        unsigned workers{0};                // keys in flight at once (0 = all hardware threads)
+        unsigned threads_per_key{1};        // pipeline::Options::threads of each key
+        size_t queue{0};                    // lines read ahead of the workers (0 = 4 per worker)
+        unsigned long long key_ms{0};       // hard cap on one key, 0 = only the stage budgets
+        unsigned long long cheap_ms{2000};  // pipeline cheap stage budget
+        unsigned long long heavy_ms{0};     // every expensive stage budget, 0 = pipeline defaults
+        uint64_t seed{1};
+    };
+
+    struct Summary {
+        size_t keys{0};
+        size_t factored{0};
+        size_t errors{0}; // malformed lines
+        double seconds{0};
+    };
+
+    // reads `in` to the end; the reader blocks while the queue is full, so memory stays bounded
+    Summary run(std::istream &in, std::ostream &out, const Options &opt);
+}
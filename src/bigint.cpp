@@ -1,4 +1,5 @@
 #include "bigint.hpp"
+#include <algorithm>
 #include <stdexcept>
 
 // parse bigint from string (hex with 0x prefix or decimal)
@@ -48,3 +49,81 @@ BigInt BigInt::nth_root_floor(const BigInt &x, unsigned int n) {
     return result;
 }
 
+
+ModContext::ModContext(const BigInt &n) : n_(n), one_(static_cast<uint64_t>(1)) {
+    if (n.is_zero()) throw std::invalid_argument("ModContext: modulus must be > 0");
+    limbs_ = mpz_size(n_.v_);
+    t_.assign(2 * limbs_ + 1, 0);
+    if (!montgomery()) return;
+
+    // newton iteration for n^-1 mod 2^64, each step doubles the number of correct low bits
+    mp_limb_t n0 = mpz_getlimbn(n_.v_, 0);
+    mp_limb_t inv = n0;
+    for (int i = 0; i < 6; ++i) inv *= 2 - n0 * inv;
+    ninv_ = 0 - inv;
+
+    mpz_set_ui(one_.v_, 1);
+    mpz_mul_2exp(one_.v_, one_.v_, GMP_NUMB_BITS * limbs_);
+    mpz_mod(one_.v_, one_.v_, n_.v_);
+    mpz_mul(r2_.v_, one_.v_, one_.v_);
+    mpz_mod(r2_.v_, r2_.v_, n_.v_);
+}
+
+void ModContext::redc(BigInt &r) {
+    // gmp's redc_1 shape: the carry of row i is parked in the dead limb t[i] and added in one pass
+    const mp_limb_t *np = mpz_limbs_read(n_.v_);
+    mp_limb_t *tp = t_.data();
+    for (size_t i = 0; i < limbs_; ++i) {
+        mp_limb_t m = tp[i] * ninv_;
+        tp[i] = mpn_addmul_1(tp + i, np, static_cast<mp_size_t>(limbs_), m);
+    }
+    mp_limb_t *rp = mpz_limbs_write(r.v_, static_cast<mp_size_t>(limbs_));
+    mp_limb_t cy = mpn_add_n(rp, tp + limbs_, tp, static_cast<mp_size_t>(limbs_));
+    if (cy || mpn_cmp(rp, np, static_cast<mp_size_t>(limbs_)) >= 0) mpn_sub_n(rp, rp, np, static_cast<mp_size_t>(limbs_));
+    mpz_limbs_finish(r.v_, static_cast<mp_size_t>(limbs_));
+}
+
+void ModContext::mulmod(BigInt &r, const BigInt &a, const BigInt &b) {
+    if (!montgomery()) {
+        mpz_mul(r.v_, a.v_, b.v_);
+        mpz_tdiv_r(r.v_, r.v_, n_.v_);
+        return;
+    }
+    size_t an = mpz_size(a.v_), bn = mpz_size(b.v_);
+    if (an == 0 || bn == 0) { mpz_set_ui(r.v_, 0); return; }
+    mp_limb_t *tp = t_.data();
+    if (&a == &b) mpn_sqr(tp, mpz_limbs_read(a.v_), static_cast<mp_size_t>(an));
+    else if (an >= bn) mpn_mul(tp, mpz_limbs_read(a.v_), static_cast<mp_size_t>(an), mpz_limbs_read(b.v_), static_cast<mp_size_t>(bn));
+    else mpn_mul(tp, mpz_limbs_read(b.v_), static_cast<mp_size_t>(bn), mpz_limbs_read(a.v_), static_cast<mp_size_t>(an));
+    std::fill(tp + an + bn, tp + 2 * limbs_, 0);
+    redc(r);
+}
+
+void ModContext::addmod(BigInt &r, const BigInt &a, const BigInt &b) {
+    mpz_add(r.v_, a.v_, b.v_);
+    if (mpz_cmp(r.v_, n_.v_) >= 0) mpz_sub(r.v_, r.v_, n_.v_);
+}
+
+void ModContext::submod(BigInt &r, const BigInt &a, const BigInt &b) {
+    mpz_sub(r.v_, a.v_, b.v_);
+    if (mpz_sgn(r.v_) < 0) mpz_add(r.v_, r.v_, n_.v_);
+}
+
+void ModContext::reduce(BigInt &x) {
+    if (mpz_sgn(x.v_) >= 0 && mpz_cmp(x.v_, n_.v_) < 0) return;
+    mpz_mod(x.v_, x.v_, n_.v_);
+}
+
+void ModContext::to_mont(BigInt &x) {
+    reduce(x);
+    if (montgomery()) mulmod(x, x, r2_);
+}
+
+void ModContext::from_mont(BigInt &x) {
+    if (!montgomery()) return;
+    size_t xn = mpz_size(x.v_);
+    mp_limb_t *tp = t_.data();
+    std::fill(tp, tp + 2 * limbs_, 0);
+    if (xn) mpn_copyi(tp, mpz_limbs_read(x.v_), static_cast<mp_size_t>(xn));
+    redc(x);
+}
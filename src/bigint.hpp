@@ -7,6 +7,8 @@
 #include <stdexcept>
 #include <vector>
 
+class ModContext;
+
 class BigInt {
 public:
     BigInt() { mpz_init(v_); }
@@ -62,7 +64,45 @@ public:
     const mpz_t& raw() const { return v_; }
 
 private:
+    friend class ModContext;
     mpz_t v_;
 };
 
 inline std::ostream& operator<<(std::ostream &os, const BigInt &x) { os << x.to_dec(); return os; }
+
+/*
+ * Modular arithmetic for one fixed modulus, for hot loops.
+ * Odd n: values live in montgomery form (to_mont / from_mont) and mulmod/sqrmod are one mpn
+ * multiply + REDC into preallocated scratch limbs, no allocation and no division.
+ * Even n: falls back to mpz division and to_mont / from_mont are the identity.
+ * mulmod(r, a_mont, b) with b in the normal domain gives a*b mod n in the normal domain.
+ * Owns scratch buffers, so use one context per thread.
+ */
+class ModContext {
+public:
+    explicit ModContext(const BigInt &n);
+
+    const BigInt& modulus() const { return n_; }
+    bool montgomery() const { return !n_.is_even(); }
+    const BigInt& one() const { return one_; } // 1 in context form
+
+    void to_mont(BigInt &x);   // x (any value) -> x*R mod n
+    void from_mont(BigInt &x); // x*R mod n -> x
+    void reduce(BigInt &x);    // x mod n in place, normal domain
+
+    // inputs in [0, n); r may alias a or b
+    void mulmod(BigInt &r, const BigInt &a, const BigInt &b);
+    void sqrmod(BigInt &r, const BigInt &a) { mulmod(r, a, a); }
+    void addmod(BigInt &r, const BigInt &a, const BigInt &b);
+    void submod(BigInt &r, const BigInt &a, const BigInt &b);
+
+private:
+    void redc(BigInt &r); // r = t_ * R^-1 mod n, t_ holds 2*limbs_ limbs
+
+    BigInt n_;
+    BigInt one_;
+    BigInt r2_; // R^2 mod n
+    size_t limbs_{0};
+    mp_limb_t ninv_{0}; // -n^-1 mod 2^GMP_NUMB_BITS
+    std::vector<mp_limb_t> t_;
+};
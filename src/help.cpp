@@ -10,6 +10,8 @@ rsaShit - RSA attack toolkit
 Available commands:
   help [command]  - show this help or detailed help for a command
   quit / exit     - exit the program
+  ctrl-c          - stop the running attack (it returns what it has so far)
+  metrics         - toggle a cost line (iterations, modmuls, gcds, time, memory) after each attack
   show            - show session state
   hi              - say hello
 
@@ -17,10 +19,18 @@ RSA Attacks:
   lowe            - low exponent broadcast attack (Håstad)
   wiener          - wiener's attack for small private exponent d
   cmod            - common modulus attack
+  trial           - trial division by all primes up to a limit (primorial gcd)
   fermat          - fermat factorization for close primes
+  lehman          - lehman / hart one line factoring for p/q near a small ratio
   rho             - pollard's rho factorization
+  squfof          - shanks' square forms factorization for n up to 62 bits
   coppersmith     - coppersmith small root attack for partial message recovery
   pminus1         - pollard's p-1 factorization
+  pplus1          - williams' p+1 factorization
+  ecm             - lenstra elliptic curve factorization (in-process, multi-threaded)
+  siqs            - self-initializing quadratic sieve, general n up to ~100 digits
+  auto            - race every applicable factoring attack, first factor wins
+  batchgcd        - batch gcd over a file of moduli (shared primes across keys)
 
 type 'help <command>' for detailed info on a specific attack.
 examples: 'help rho', 'help fermat', 'help wiener'
@@ -40,30 +50,70 @@ WHEN TO USE:
   - general-purpose factorization method
 
 HOW IT WORKS:
-  - uses floyd's cycle detection (tortoise and hare)
+  - uses brent's cycle detection (one squaring per step instead of floyd's three)
   - generates pseudo-random sequence: f(x) = x^2 + c mod N
-  - finds collisions that reveal factors via gcd
+  - multiplies |x - y| into a running product, one gcd per batch of steps
+  - if a batch gcd collapses to N it backs up and replays that batch step by step
   - tries multiple c values and starting points for robustness
+  - N up to 128 bits skips gmp: the walk runs on one or two machine words
+    (uint64 / uint128 montgomery), with squfof as the fallback below 2^62;
+    backend, threads and seed don't matter there
 
 USAGE:
   > rho
   enter N> <composite_number>
   max iters (dec, default 1000000)> [press Enter for default or specify budget]
+  gcd batch (dec, default 128)> [press Enter for default]
+  threads (dec, 1 = sequential, 0 = all cores, default 1)> [press Enter for default]
+  backend (gmp/simd, default gmp)> [only asked when threads == 1]
+  seed (dec, default 1)> [only asked when threads != 1]
 
 PARAMETERS:
   - N: the composite number to factor
   - max iters: iteration budget (default 1M, increase for larger numbers)
+  - gcd batch: steps accumulated per gcd (larger = fewer gcds, longer replay on collapse)
+  - threads: run independent walks in parallel (random c and start per walk)
+  - seed: picks the parallel walks; same seed + same thread count = same factor
+  - backend: simd runs 8 walks at once in montgomery form (avx512-ifma / avx2 /
+    scalar, picked at runtime); only for odd N up to 256 bits, otherwise gmp is used
 
 EXAMPLE:
   > rho
   enter N> 143
   max iters (dec, default 1000000)>
+  gcd batch (dec, default 128)>
+  threads (dec, 1 = sequential, 0 = all cores, default 1)>
+  backend (gmp/simd, default gmp)>
   rho factor: 11 (0xb)
 
 NOTES:
   - will fail on prime numbers (as expected - no factors exist)
   - increase max iters for larger composites
   - typically fast for numbers with factors < 10^12
+  - 'simd-selftest' checks the simd kernels against gmp on this cpu
+)";
+        } else if (cmd == "squfof") {
+            std::cout << R"(
+squfof - Shanks' Square Forms Factorization
+===========================================
+
+WHEN TO USE:
+  - small composites (cofactors) up to 62 bits, on one machine word
+  - rho already uses it as a fallback for such N, so this is mostly for checking
+
+HOW IT WORKS:
+  - walks the continued fraction of sqrt(kN) until a Q at an even index is a square r^2
+  - walks back from the form built on r until P repeats; gcd(N, Q) is the factor
+  - ~N^(1/4) steps of word arithmetic; multipliers k = products of 3, 5, 7, 11 are
+    tried in turn while k*N still fits in 64 bits
+
+USAGE:
+  > squfof
+  enter N (up to 62 bits)> <composite>
+
+NOTES:
+  - above ~55 bits only a few multipliers fit, so about 1 in 70 N come back empty
+  - 'squfof-selftest' times rho's native word paths and squfof on random cofactors
 )";
         } else if (cmd == "fermat") {
             std::cout << R"(
@@ -80,6 +130,10 @@ HOW IT WORKS:
   - starts with a = ceil(sqrt(N))
   - checks if a^2 - N is a perfect square
   - increments a until factors are found
+  - a^2 - N is updated by addition, never recomputed
+  - a residue sieve (mod 64, 63, 65, 11 and small primes) throws out whole runs of a
+    that can't give a square; only survivors get a real square-root test
+  - N up to 64 bits runs on machine words (squares mod 64 + double sqrt) instead of gmp
 
 USAGE:
   > fermat
@@ -88,7 +142,7 @@ USAGE:
 
 PARAMETERS:
   - N: composite number with close prime factors
-  - max iters: how many values of a to try
+  - max iters: how many values of a to try (1e8-1e9 is cheap with the sieve)
 
 EXAMPLE:
   > fermat
@@ -100,6 +154,119 @@ NOTES:
   - very fast when p ≈ q (close primes)
   - slow/ineffective when p and q are far apart
   - use rho instead if factors are not close
+)";
+        } else if (cmd == "trial") {
+            std::cout << R"(
+trial - Trial Division
+======================
+
+WHEN TO USE:
+  - first thing on any key you ingest; it costs about a millisecond
+  - broken keygens sometimes emit moduli with small factors
+  - to strip small primes off a number before handing the cofactor to rho / p-1
+
+HOW IT WORKS:
+  - the product P of all primes <= limit is built once per limit and cached
+  - g = gcd(N, P) is the product of the small primes dividing N (1 for a sane rsa key)
+  - only when g > 1: g is split against ~32k-bit blocks of P, and only the blocks
+    that share something with g are searched prime by prime
+  - each prime found is divided out of N as often as it goes
+  - trial_division_batch (used by the selftest) pushes P down a remainder tree over
+    1024 keys at a time, ~10x cheaper per key than one at a time
+
+USAGE:
+  > trial
+  enter N> <number>
+  limit (dec, default 1000000)> [press Enter for default]
+
+EXAMPLE:
+  > trial
+  enter N> 0x...
+  limit (dec, default 1000000)>
+  trial success: trial division <= 1000000: 2^3 * 999983, cofactor 147 bits
+  cofactor: 0x...
+
+NOTES:
+  - the limit is capped at 2^32; P grows ~1.44 bits per unit of limit
+  - 'trial-selftest' checks one key by hand and 4096 random keys single vs batch
+)";
+        } else if (cmd == "lehman") {
+            std::cout << R"(
+lehman - Lehman / Hart One Line Factoring
+==========================================
+
+WHEN TO USE:
+  - when p/q is close to a ratio u/v of small integers (p ≈ 2q, 3p ≈ 5q, ...)
+  - fermat is the u = v = 1 case; this covers the rest of the "lazy keygen" family
+  - also fine as a quick general shot at N up to ~100 bits
+
+HOW IT WORKS:
+  - lehman: for k = 1, 2, ... runs a few fermat steps on 4*k*N
+    (if k = u*v then 4kN = (2vp)(2uq) is a product of two close numbers)
+  - hart: for i = 1, 2, ... takes s = ceil(sqrt(i*N)) and checks whether s^2 mod N
+    is a square t^2; gcd(s - t, N) is then a factor
+  - the multiplier range is split into chunks handed out to worker threads
+  - stops on the first factor or when the time budget runs out
+
+USAGE:
+  > lehman
+  enter N> <composite_number>
+  mode (hart/lehman, default hart)> [press Enter for hart]
+  max multiplier (dec, default 100000000)> [press Enter for default]
+  threads (dec, 0 = all cores, default 0)> [press Enter for default]
+  time budget ms (dec, 0 = none, default 5000)> [press Enter for default]
+
+PARAMETERS:
+  - N: composite number
+  - mode: hart (one candidate per multiplier, usually faster) or lehman
+  - max multiplier: largest k / i tried (lehman also caps k at N^(1/3))
+  - threads: workers splitting the multiplier range
+  - time budget: wall clock limit in milliseconds
+
+EXAMPLE:
+  > lehman
+  enter N> 0x...
+  mode (hart/lehman, default hart)>
+  ...
+  hart success: p=0x..., q=0x...
+  hart hit at k=60 after 0 ms (1 threads)
+
+NOTES:
+  - the multiplier needed grows with u*v, so only small ratios are in reach
+  - 'lehman-selftest' factors a 320-bit key with q ≈ 5p/3 both ways
+)";
+        } else if (cmd == "batchgcd") {
+            std::cout << R"(
+batchgcd - Batch GCD Over Many Moduli
+=====================================
+
+WHEN TO USE:
+  - you have a pile of public keys (thousands to millions) from the same kind of device
+  - keys generated with a weak or badly seeded rng tend to share primes with each other
+  - one shared prime factors both keys; pairwise gcd is quadratic, this is quasi-linear
+
+HOW IT WORKS:
+  - product tree: multiply the moduli pairwise, level by level, up to P = prod N_i
+  - remainder tree: walk back down taking R mod node^2, ending with P mod N_i^2
+  - gcd((P mod N_i^2) / N_i, N_i) is the part of N_i shared with any other modulus
+  - every tree level is split across worker threads
+  - with a spill dir the levels are written to disk and streamed back in chunks,
+    so corpora bigger than RAM only need the root in memory
+
+USAGE:
+  > batchgcd
+  moduli file (one N per line, dec or 0x hex)> keys.txt
+  threads (dec, 0 = all cores, default 0)> [press Enter for default]
+  spill dir (empty = keep the tree in RAM)> [press Enter to keep it in RAM]
+
+OUTPUT:
+  - one line per hit: index (0-based, blank and '#' lines skipped), n, p, q
+  - a modulus that only matches an identical copy of itself is reported as duplicate
+
+NOTES:
+  - blank lines and lines starting with '#' in the moduli file are skipped
+  - spill files are removed when the run ends
+  - 'batchgcd-selftest' plants shared primes and a duplicate in 2000 moduli
 )";
         } else if (cmd == "wiener") {
             std::cout << R"(
@@ -295,7 +462,14 @@ WHEN TO USE:
 
 HOW IT WORKS (this tool):
   - Stage 1: power a by prime powers ≤ B1 modulo n, then g = gcd(a-1, n)
-  - Stage 2 (optional): scan primes q in (B1, B2]; test gcd(a^q - 1, n)
+    (prime powers are multiplied into ~64k-bit exponent chunks, one powm + gcd per chunk;
+    primes come from a segmented sieve, so B1 = 1e8 only costs time, not memory)
+  - Stage 2 (optional): catch one extra prime q in (B1, B2]
+    bsgs: q = kD +- j, one multiply by V_kD - V_j (V_i = a^i + a^-i) covers both kD + j
+          and kD - j; all differences go into one accumulator, one gcd per 4096 multiplies
+    poly: F(X) = prod_j (X - V_j) is evaluated at a whole block of V_kD at once with
+          product/remainder trees (gmp FFT multiplies); pays off for B2 in the billions
+    auto: poly once B2 - B1 >= 4e9, bsgs below that
 
 USAGE:
   > pminus1
@@ -303,17 +477,171 @@ USAGE:
   enter B1 (stage1 bound, dec default 100000)> <bound1>
   enter B2 (stage2 bound, dec; 0 to disable, default 0)> <bound2>
   enter trials (bases to try, dec default 5)> <count>
+  stage2 (auto/bsgs/poly, default auto)> <mode>     (only asked when B2 > B1)
 
 PARAMETERS:
   - N: number to factor
   - B1: stage 1 smoothness bound
   - B2: stage 2 bound (0 disables stage 2)
   - trials: number of bases to try (a values)
+  - stage2: stage 2 flavour, see above
 
 NOTES:
   - increasing B1 and B2 raises cost but improves success probability
-  - this stage 2 is a simple variant; good for demos and mid-size factors
+  - B2 ~ 100 * B1 is the usual balance between the two stages
   - try multiple bases if stage 1 fails; add stage 2 for a wider net
+)";
+        } else if (cmd == "pplus1") {
+            std::cout << R"(
+pplus1 - Williams' p+1 Factorization
+====================================
+
+WHEN TO USE:
+  - when n has a prime factor p such that p+1 is B1-smooth (up to one prime in (B1, B2])
+  - after p-1 failed: same bounds, the other neighbour of p
+
+HOW IT WORKS (this tool):
+  - works with lucas sequences V_i(A) instead of powers; V_E(A) - 2 is divisible by p when
+    p+1 (or p-1, depending on the seed A) divides E
+  - Stage 1: same ~64k-bit exponent chunks as pminus1, one lucas ladder + gcd per chunk
+  - Stage 2: the pminus1 stage 2 (bsgs / poly / auto) run on V_E
+  - seeds: 2/7 and 6/5 first (group orders divisible by 6 and 4), then small integers;
+    only about half the seeds hit the p+1 group, the rest redo p-1
+
+USAGE:
+  > pplus1
+  enter N> <composite>
+  enter B1 (stage1 bound, dec default 100000)> <bound1>
+  enter B2 (stage2 bound, dec; 0 to disable, default 0)> <bound2>
+  enter seeds (dec default 3, max 9)> <count>
+  stage2 (auto/bsgs/poly, default auto)> <mode>     (only asked when B2 > B1)
+
+NOTES:
+  - one seed costs about 2x one p-1 base (a multiply and a square per exponent bit)
+  - 'pplus1-selftest' finds a 90-bit p with smooth p+1 that p-1 misses
+)";
+        } else if (cmd == "ecm") {
+            std::cout << R"(
+ecm - Lenstra Elliptic Curve Method
+===================================
+
+WHEN TO USE:
+  - N has a prime factor of up to ~35-40 digits, whatever the size of the rest
+  - multi-prime rsa, unbalanced keys, or cofactors left over after trial division
+  - p-1 failed: ecm is p-1 with a fresh group order on every curve
+
+HOW IT WORKS:
+  - random montgomery curve per sigma (suyama parametrization), x-only arithmetic
+  - stage 1: multiply the start point by every prime power <= B1 (montgomery ladder),
+    p shows up as gcd(Z, N)
+  - stage 2: one more prime q in (B1, B2], baby-step giant-step with q = kD +- j,
+    one multiply per pair and one gcd per 4096 multiplies
+  - curves are spread over worker threads; the first factor cancels later curves
+
+USAGE:
+  > ecm
+  enter N> <composite>
+  B1 (dec, default 50000)> [stage 1 bound]
+  B2 (dec, 0 = 100 * B1, default 0)> [stage 2 bound]
+  curves (dec, default 200)> [number of curves]
+  threads (dec, 0 = all cores, default 0)>
+  seed (dec, default 1)> [picks the curves]
+
+CHOOSING B1 (factor digits -> B1, curves):
+  - 15 -> 2000, 25       20 -> 11000, 90       25 -> 50000, 300
+  - 30 -> 250000, 700    35 -> 1000000, 1800   40 -> 3000000, 5100
+
+NOTES:
+  - same N, bounds and seed give the same factor for any thread count
+  - a factor can come out composite if two primes drop out on the same curve
+  - 'ecm-selftest' pulls a 16-digit prime out of a 250-bit N
+)";
+        } else if (cmd == "siqs") {
+            std::cout << R"(
+siqs - Self-Initializing Quadratic Sieve
+========================================
+
+WHEN TO USE:
+  - N has no weakness the other attacks need (close primes, smooth p-1, small p)
+  - N up to ~100 digits (about 330 bits); run time only depends on the size of N
+
+HOW IT WORKS:
+  - knuth-schroeppel picks a multiplier k, the sieve runs on kN
+  - polynomials g(x) = a x^2 + 2 b x + c, a a product of s factor base primes; each a gives
+    2^(s-1) polynomials whose roots follow from the previous ones by one addition
+  - sieve [-M, M) in 32 KiB blocks with byte logarithms, primes above the block size go
+    through per-block buckets; positions over the threshold are trial divided
+  - relations with one leftover prime below the large prime bound are kept and paired up
+  - linear algebra: singleton pruning + bit-packed gauss-jordan over GF(2), then
+    gcd(X - Y, N) for each dependency
+  - worker threads sieve separate polynomial families
+
+USAGE:
+  > siqs
+  enter N> <composite>
+  threads (dec, 0 = all cores, default 0)>
+  seed (dec, default 1)> [picks the polynomial families]
+
+ROUGH TIMES (one core):
+  - 50 digits ~0.5 s, 60 digits ~4 s, 70 digits ~50 s; about x7 per 10 digits after that
+
+NOTES:
+  - the log shows factor base size, relations, matrix size and where the time went
+  - 'siqs-selftest' factors a 51 digit semiprime
+)";
+        } else if (cmd == "auto") {
+            std::cout << R"(
+auto - Attack Pipeline
+======================
+
+WHEN TO USE:
+  - you have N (and maybe e) and no idea which weakness the key has
+
+HOW IT WORKS:
+  - even N, primes and perfect powers are settled up front
+  - every other stage starts at once on its own thread:
+      cheap:     trial division to 1e6, gcd with related items, wiener (needs e),
+                 fermat, hart, p-1 with B1 = 2e4
+      expensive: rho, p-1 with B1 = 2e6, ecm climbing B1 from 2000 to 3e6,
+                 siqs for N of 20 to 100 digits
+  - each stage has a time budget; the first proper factor cancels all the others
+  - the expensive stages split the threads: rho and p-1 one each, the rest to ecm / siqs
+
+USAGE:
+  > auto
+  enter N> <composite>
+  e (optional, enables wiener and d)> 65537
+  related moduli / known factors (comma separated, optional)>
+  threads (dec, 0 = all cores, default 0)>
+  cheap stage budget ms (dec, default 2000)>
+  expensive stage budget ms (dec, 0 = per-stage defaults)> [rho 15 s, p-1 20 s, ecm 60 s, siqs 120 s]
+
+OUTPUT:
+  - one line per stage: start offset, status (found / not found / timed out / cancelled /
+    skipped), wall time and the stage's own log
+  - p and q in hex and decimal, d when e was given
+
+NOTES:
+  - a losing stage stops at its next poll (a gcd block, a powm chunk, 32 siqs polynomials);
+    siqs linear algebra runs to the end once it has started
+  - 'auto-selftest' runs a fermat, a rho / ecm and a p-1 key through the pipeline
+)";
+        } else if (cmd == "metrics") {
+            std::cout << R"(
+metrics - Per-Attack Cost
+=========================
+
+Toggles (on / off, starts off) a line after every attack result:
+
+  metrics: 81920 steps, 163840 modmul, 640 gcd, 0 powm, 12 alloc, wall 0.004s, cpu 0.004s, peak 5.1 MB
+
+  - the first number is the attack's own unit (rho steps, fermat a values, ecm curves, siqs polynomials, ...)
+  - modmul / gcd / powm are counted per block, 0 means the attack does not count that one
+  - cpu is process CPU time, so a parallel attack shows cpu > wall
+  - alloc counts gmp limb allocations, peak is the process memory high-water mark
+  - under 'auto' every stage gets its own line below the stage report
+
+The same fields are in every stage of 'rsaShit batch' output ("metrics": {...}).
 )";
         } else if (cmd == "show") {
             std::cout << R"(
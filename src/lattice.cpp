@@ -0,0 +1,377 @@
+#include "lattice.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+/*
+ * Two reductions over the same basis type.
+ *
+ * lll_reduce is L^2 (Nguyen-Stehle, "Floating-point LLL revisited"): the basis and its Gram
+ * matrix G = B B^T stay exact integers, only the Cholesky factorisation of G (r_ij, mu_ij) is
+ * carried in long double and recomputed row by row from G. Size reduction is lazy: the row is
+ * reduced with the rounded mu, the Cholesky row is recomputed from the updated G, and this
+ * repeats until every |mu_kj| <= eta. A row operation b_k -= x b_j costs one pass over b_k and
+ * O(n) multiplies on G, never a dot product over the whole basis.
+ *
+ * long double is not the precision L^2 asks for at larger dimensions, so it is checked instead
+ * of trusted: a non-finite or non-positive r_kk, a row that does not settle within kMaxPasses
+ * size reduction passes, or a Gram entry beyond the exponent range hands the (still valid,
+ * partly reduced) basis to the exact rational reduction, which finishes it.
+ */
+
+namespace lattice {
+    namespace {
+        constexpr uint64_t kDeltaOne = 1 << 20;
+
+        // full fraction type using only bigints shiiiii
+        struct Fraction {
+            BigInt num; // numerator (can be negative)
+            BigInt den; // denominator (>0)
+            Fraction() : num(BigInt(static_cast<uint64_t>(0))), den(BigInt(static_cast<uint64_t>(1))) {}
+            Fraction(const BigInt &n) : num(n), den(BigInt(static_cast<uint64_t>(1))) {}
+            Fraction(const BigInt &n, const BigInt &d) : num(n), den(d) { normalize(); }
+            void normalize() {
+                BigInt zero(static_cast<uint64_t>(0));
+                if (den == zero) {
+                    throw std::runtime_error("fraction denominator is zero");
+                }
+                // ensure denominator positive
+                if (den < zero) {
+                    den = zero - den;
+                    num = zero - num;
+                }
+                // reduce by gcd
+                BigInt a = num;
+                if (a < zero) a = zero - a; // abs(num)
+                BigInt g = BigInt::gcd(a, den);
+                if (!(g == BigInt(static_cast<uint64_t>(1)))) {
+                    num /= g;
+                    den /= g;
+                }
+            }
+        };
+
+        // helpers for fraction operations (minimal set)
+        Fraction frac_add(const Fraction &a, const Fraction &b) {
+            BigInt n = a.num * b.den + b.num * a.den;
+            BigInt d = a.den * b.den;
+            return Fraction(n, d);
+        }
+        Fraction frac_sub(const Fraction &a, const Fraction &b) {
+            BigInt n = a.num * b.den - b.num * a.den;
+            BigInt d = a.den * b.den;
+            return Fraction(n, d);
+        }
+        Fraction frac_mul(const Fraction &a, const Fraction &b) {
+            BigInt n = a.num * b.num;
+            BigInt d = a.den * b.den;
+            return Fraction(n, d);
+        }
+        Fraction frac_square(const Fraction &a) {
+            BigInt n = a.num * a.num;
+            BigInt d = a.den * a.den;
+            return Fraction(n, d);
+        }
+
+        // compare fractions: returns -1 if a<b, 0 if equal, 1 if a>b
+        int frac_cmp(const Fraction &a, const Fraction &b) {
+            BigInt left = a.num * b.den;
+            BigInt right = b.num * a.den;
+            if (left < right) return -1;
+            if (left > right) return 1;
+            return 0;
+        }
+
+        // round fraction to nearest integer (ties to floor) using bigint only
+        BigInt frac_round_to_int(const Fraction &f) {
+            BigInt zero(static_cast<uint64_t>(0));
+            if (f.den == BigInt(static_cast<uint64_t>(1))) return f.num; // already integer
+            // floor
+            BigInt q = f.num / f.den;
+            BigInt r = f.num % f.den;
+            // check |2r| >= |den|
+            BigInt two(static_cast<uint64_t>(2));
+            BigInt abs2r = r; if (abs2r < zero) abs2r = zero - abs2r; abs2r *= two;
+            BigInt absd = f.den; // positive
+            if (abs2r > absd) {
+                // adjust depending on sign of num
+                if (f.num >= zero) {
+                    q += BigInt(static_cast<uint64_t>(1));
+                } else {
+                    q -= BigInt(static_cast<uint64_t>(1));
+                }
+            }
+            return q;
+        }
+
+        // compute dot product of integer vector and integer vector
+        BigInt dot_int(const std::vector<BigInt> &a, const std::vector<BigInt> &b) {
+            BigInt acc(static_cast<uint64_t>(0));
+            size_t m = std::min(a.size(), b.size());
+            for (size_t i=0; i<m; ++i) acc += a[i] * b[i];
+            return acc;
+        }
+
+        // compute dot product of integer vector and rational vector
+        Fraction dot_mixed(const std::vector<BigInt> &a, const std::vector<Fraction> &b) {
+            Fraction acc; // 0
+            size_t m = std::min(a.size(), b.size());
+            for (size_t i=0; i<m; ++i) {
+                Fraction term(a[i] * b[i].num, b[i].den); // a[i]*b[i]
+                acc = frac_add(acc, term);
+            }
+            return acc;
+        }
+
+        // compute squared norm of rational vector
+        Fraction norm_sq(const std::vector<Fraction> &v) {
+            Fraction acc; // 0
+            for (const auto &x : v) {
+                acc = frac_add(acc, frac_square(x));
+            }
+            return acc;
+        }
+    }
+
+    /*
+     * Full LLL lattice reduction using bigint-only exact rational arithmetic.
+     * Implements Gram-Schmidt orthogonalization with fractions (numerator/denominator bigints).
+     * This is slower than floating implementations but exact and suitable for RSA-related code.
+     *
+     * @param basis - matrix of integer basis vectors (each row is a basis vector)
+     * @param delta_f - lovasz constant, taken as the nearest multiple of 2^-20
+     * @return true if finished (always true unless pathological zero vectors cause issues)
+     */
+    bool lll_reduce_exact(Matrix &basis, double delta_f) {
+        size_t n = basis.size();
+        if (n == 0) return true;
+        size_t dim = basis[0].size();
+
+        // gram-schmidt storage
+        std::vector<std::vector<Fraction>> b_star(n, std::vector<Fraction>(dim));
+        std::vector<Fraction> B(n); // squared norms of b_star
+        std::vector<std::vector<Fraction>> mu(n, std::vector<Fraction>(n)); // mu[i][j]
+
+        Fraction delta(BigInt(static_cast<uint64_t>(std::llround(delta_f * kDeltaOne))),
+                       BigInt(static_cast<uint64_t>(kDeltaOne)));
+        BigInt zero(static_cast<uint64_t>(0));
+        BigInt one(static_cast<uint64_t>(1));
+
+        auto recompute_gs = [&](size_t upto){
+            for (size_t i=0; i<=upto && i<n; ++i) {
+                // start with b_i as fraction vector
+                for (size_t k=0; k<dim; ++k) {
+                    b_star[i][k] = Fraction(basis[i][k]);
+                }
+                // subtract projections onto previous b_star
+                for (size_t j=0; j<i; ++j) {
+                    // mu[i][j] = <b_i, b*_j> / B[j]
+                    Fraction numer = dot_mixed(basis[i], b_star[j]);
+                    // division by B[j]: (numer.num / numer.den) / (B[j].num / B[j].den) = numer.num * B[j].den / (numer.den * B[j].num)
+                    Fraction mu_ij;
+                    if (B[j].num == zero) {
+                        mu_ij = Fraction(); // treat as zero
+                    } else {
+                        BigInt mu_num = numer.num * B[j].den;
+                        BigInt mu_den = numer.den * B[j].num;
+                        mu_ij = Fraction(mu_num, mu_den);
+                    }
+                    mu[i][j] = mu_ij;
+                    // b_star[i] -= mu_ij * b_star[j]
+                    for (size_t k=0; k<dim; ++k) {
+                        Fraction prod(b_star[j][k].num * mu_ij.num, b_star[j][k].den * mu_ij.den);
+                        b_star[i][k] = frac_sub(b_star[i][k], prod);
+                    }
+                }
+                B[i] = norm_sq(b_star[i]);
+            }
+        };
+
+        recompute_gs(n-1); // initial GS
+
+        size_t k = 1;
+        while (k < n) {
+            // size reduction: for j = k-1 .. 0
+            for (int j = static_cast<int>(k) - 1; j >= 0; --j) {
+                // round mu[k][j]
+                BigInt r = frac_round_to_int(mu[k][j]);
+                // if r != 0, apply b_k -= r * b_j and update mu[k][*]
+                if (!(r == zero)) {
+                    for (size_t col=0; col<dim; ++col) {
+                        basis[k][col] -= r * basis[j][col];
+                    }
+                }
+            }
+            // update GS for vector k (since we modified b_k during size reduction)
+            recompute_gs(k);
+
+            // Lovasz condition: (delta - mu[k][k-1]^2) * B[k-1] <= B[k]
+            Fraction mu_sq = frac_square(mu[k][k-1]);
+            Fraction left = frac_mul(frac_sub(delta, mu_sq), B[k-1]);
+            if (frac_cmp(left, B[k]) <= 0) {
+                // condition satisfied
+                ++k;
+                continue;
+            }
+            // swap b_k and b_{k-1}
+            std::swap(basis[k], basis[k-1]);
+            // recompute GS for indices k-1 and k onward
+            recompute_gs(k);
+            if (k > 1) --k;
+        }
+
+        return true;
+    }
+
+    namespace {
+        using Float = long double;
+
+        constexpr Float kEta = 0.51L;
+        constexpr unsigned kMaxPasses = 64;
+
+        // nearest long double, from the top two limbs (>= 64 significant bits with 64-bit limbs)
+        Float to_float(const BigInt &x) {
+            size_t n = mpz_size(x.raw());
+            if (n == 0) return 0;
+            Float v = static_cast<Float>(mpz_getlimbn(x.raw(), n - 1));
+            if (n > 1) v += std::ldexp(static_cast<Float>(mpz_getlimbn(x.raw(), n - 2)), -GMP_NUMB_BITS);
+            v = std::ldexp(v, static_cast<int>((n - 1) * GMP_NUMB_BITS));
+            return mpz_sgn(x.raw()) < 0 ? -v : v;
+        }
+
+        // x must already be integral
+        void to_big(Float x, BigInt &out) {
+            if (std::fabs(x) < 0x1p62L) {
+                mpz_set_si(out.raw(), static_cast<long>(x));
+                return;
+            }
+            int e;
+            Float m = std::frexp(std::fabs(x), &e);
+            mpz_set_ui(out.raw(), static_cast<unsigned long>(std::ldexp(m, 64)));
+            if (e >= 64) mpz_mul_2exp(out.raw(), out.raw(), e - 64);
+            else mpz_tdiv_q_2exp(out.raw(), out.raw(), 64 - e);
+            if (x < 0) mpz_neg(out.raw(), out.raw());
+        }
+
+        class L2 {
+        public:
+            L2(Matrix &basis, Float delta, LllStats &stats)
+                : b_(basis), n_(basis.size()), delta_(delta), stats_(stats), g_(n_ * n_), r_(n_ * n_), mu_(n_ * n_) {
+                size_t bits = 0;
+                for (size_t i = 0; i < n_; ++i) {
+                    for (size_t j = 0; j <= i; ++j) {
+                        BigInt &gij = g(i, j);
+                        for (size_t c = 0; c < b_[i].size() && c < b_[j].size(); ++c)
+                            mpz_addmul(gij.raw(), b_[i][c].raw(), b_[j][c].raw());
+                        g(j, i) = gij;
+                        bits = std::max(bits, gij.bit_length());
+                    }
+                }
+                // r and mu are bounded by the Gram entries, leave room for the products in cholesky()
+                in_range_ = bits + 2 * 64 < static_cast<size_t>(LDBL_MAX_EXP);
+                max_swaps_ = 100 * n_ * n_ * (bits + 1) + 1000;
+            }
+
+            // false: long double was not enough, the basis is valid but not reduced yet
+            bool run() {
+                if (!in_range_) return false;
+                r(0, 0) = to_float(g(0, 0));
+                if (!(r(0, 0) > 0)) return false;
+                for (size_t k = 1; k < n_;) {
+                    if (!size_reduce(k)) return false;
+                    Float lhs = delta_ * r(k - 1, k - 1);
+                    if (lhs <= r(k, k) + mu(k, k - 1) * r(k, k - 1)) {
+                        ++k;
+                        continue;
+                    }
+                    if (++stats_.swaps > max_swaps_) return false;
+                    swap(k);
+                    if (k > 1) --k;
+                    else r(0, 0) = to_float(g(0, 0));
+                }
+                return true;
+            }
+
+        private:
+            BigInt &g(size_t i, size_t j) { return g_[i * n_ + j]; }
+            Float &r(size_t i, size_t j) { return r_[i * n_ + j]; }
+            Float &mu(size_t i, size_t j) { return mu_[i * n_ + j]; }
+
+            // row k of the cholesky factorisation of G, rows < k being current
+            bool cholesky(size_t k) {
+                for (size_t j = 0; j < k; ++j) {
+                    Float rkj = to_float(g(k, j));
+                    for (size_t i = 0; i < j; ++i) rkj -= mu(k, i) * r(j, i);
+                    r(k, j) = rkj;
+                    mu(k, j) = rkj / r(j, j);
+                }
+                Float rkk = to_float(g(k, k));
+                for (size_t i = 0; i < k; ++i) rkk -= mu(k, i) * r(k, i);
+                r(k, k) = rkk;
+                return std::isfinite(rkk);
+            }
+
+            bool size_reduce(size_t k) {
+                for (unsigned pass = 0;; ++pass) {
+                    if (!cholesky(k)) return false;
+                    Float worst = 0;
+                    for (size_t j = 0; j < k; ++j) worst = std::max(worst, std::fabs(mu(k, j)));
+                    if (!std::isfinite(worst)) return false;
+                    // r_kk is only meaningful once the row is reduced: before that it is the
+                    // difference of two huge, nearly equal numbers
+                    if (worst <= kEta) return r(k, k) > 0;
+                    if (pass == kMaxPasses) return false;
+                    for (size_t j = k; j-- > 0;) {
+                        Float x = std::round(mu(k, j));
+                        if (x == 0) continue;
+                        for (size_t i = 0; i < j; ++i) mu(k, i) -= x * mu(j, i);
+                        to_big(x, x_);
+                        sub_row(k, j);
+                    }
+                }
+            }
+
+            // b_k -= x_ b_j, with G kept exact
+            void sub_row(size_t k, size_t j) {
+                ++stats_.size_reductions;
+                for (size_t c = 0; c < b_[k].size(); ++c) mpz_submul(b_[k][c].raw(), x_.raw(), b_[j][c].raw());
+                // G_kk += x (x G_jj - 2 G_kj), with the old G_kj
+                mpz_mul(t_.raw(), x_.raw(), g(j, j).raw());
+                mpz_submul_ui(t_.raw(), g(k, j).raw(), 2);
+                mpz_addmul(g(k, k).raw(), x_.raw(), t_.raw());
+                for (size_t i = 0; i < n_; ++i) {
+                    if (i == k) continue;
+                    mpz_submul(g(k, i).raw(), x_.raw(), g(j, i).raw());
+                    mpz_set(g(i, k).raw(), g(k, i).raw());
+                }
+            }
+
+            void swap(size_t k) {
+                std::swap(b_[k], b_[k - 1]);
+                for (size_t i = 0; i < n_; ++i) mpz_swap(g(k, i).raw(), g(k - 1, i).raw());
+                for (size_t i = 0; i < n_; ++i) mpz_swap(g(i, k).raw(), g(i, k - 1).raw());
+            }
+
+            Matrix &b_;
+            size_t n_;
+            Float delta_;
+            LllStats &stats_;
+            std::vector<BigInt> g_; // n x n, symmetric
+            std::vector<Float> r_, mu_; // n x n, lower triangle used
+            BigInt x_, t_;
+            bool in_range_{true};
+            size_t max_swaps_{0};
+        };
+    }
+
+    bool lll_reduce(Matrix &basis, double delta, LllStats *stats) {
+        LllStats local;
+        LllStats &st = stats ? *stats : local;
+        st = LllStats{};
+        if (basis.empty()) return true;
+        if (L2(basis, delta, st).run()) return true;
+        st.exact = true;
+        return lll_reduce_exact(basis, delta);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "bigint.hpp"
+#include <cstddef>
+#include <vector>
+
+/*
+ * Lattice reduction shared by the coppersmith attacks (and the benchmarks).
+ * A basis is a list of integer row vectors, all of the same length.
+ */
+namespace lattice {
+    // matrix type for LLL - no doubles shit, pure bigint
+    using Matrix = std::vector<std::vector<BigInt> >;
+
+    struct LllStats {
+        size_t swaps{0};           // lovasz swaps of the floating-point pass
+        size_t size_reductions{0}; // row operations b_k -= x * b_j of the floating-point pass
+        bool exact{false};         // long double ran out of precision or range, exact arithmetic finished
+    };
+
+    /*
+     * LLL reduction of the rows of `basis`, in place: L^2 with the Gram-Schmidt data in long
+     * double over an exact integer basis and Gram matrix, falling back to exact rational
+     * arithmetic from wherever it stopped when the floating-point side loses precision.
+     * Rows are size reduced to |mu| <= 0.51 and satisfy the lovasz condition for `delta`.
+     * @return true if finished (always true unless pathological zero vectors cause issues)
+     */
+    bool lll_reduce(Matrix &basis, double delta = 0.99, LllStats *stats = nullptr);
+
+    // the exact rational reduction alone: slow, kept as the fallback and as a reference
+    bool lll_reduce_exact(Matrix &basis, double delta = 0.75);
+}
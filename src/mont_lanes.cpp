@@ -0,0 +1,465 @@
+#include "mont_lanes.hpp"
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MONT_LANES_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * All kernels share the same reduction shape (operand scanning, one limb of a per round):
+ *   t += a_i * b;  m = t_0 * (-n^-1) mod 2^w;  t += m * n;  t >>= w
+ * which leaves t = a*b*R^-1 + k*n with t < 2n, followed by one branch-free conditional
+ * subtraction. The vector kernels keep t's limbs unnormalised inside 64-bit words
+ * (products are <= 2w bits, so 2L rounds of accumulation still fit) and only
+ * propagate carries once at the end.
+ */
+
+namespace mont {
+    namespace {
+        // ---- scalar: 64-bit limbs, CIOS ----
+
+        using u128 = unsigned __int128;
+
+        template<unsigned L>
+        void cond_sub_scalar(uint64_t *t, uint64_t top, const uint64_t *n) {
+            uint64_t d[L];
+            uint64_t borrow = 0;
+            for (unsigned j = 0; j < L; ++j) {
+                u128 s = static_cast<u128>(t[j]) - n[j] - borrow;
+                d[j] = static_cast<uint64_t>(s);
+                borrow = static_cast<uint64_t>(s >> 64) & 1;
+            }
+            // keep t only when t < n, i.e. the subtraction borrowed out of the top word
+            bool keep = borrow > top;
+            for (unsigned j = 0; j < L; ++j) t[j] = keep ? t[j] : d[j];
+        }
+
+        template<unsigned L>
+        void mul_scalar(uint64_t *out, const uint64_t *a, const uint64_t *b, const uint64_t *n, uint64_t ninv) {
+            for (unsigned lane = 0; lane < kLanes; ++lane) {
+                uint64_t t[L + 2] = {};
+                for (unsigned i = 0; i < L; ++i) {
+                    uint64_t ai = a[i * kLanes + lane];
+                    uint64_t c = 0;
+                    for (unsigned j = 0; j < L; ++j) {
+                        u128 s = static_cast<u128>(ai) * b[j * kLanes + lane] + t[j] + c;
+                        t[j] = static_cast<uint64_t>(s);
+                        c = static_cast<uint64_t>(s >> 64);
+                    }
+                    u128 s = static_cast<u128>(t[L]) + c;
+                    t[L] = static_cast<uint64_t>(s);
+                    t[L + 1] = static_cast<uint64_t>(s >> 64);
+
+                    uint64_t m = t[0] * ninv;
+                    s = static_cast<u128>(m) * n[0] + t[0];
+                    c = static_cast<uint64_t>(s >> 64);
+                    for (unsigned j = 1; j < L; ++j) {
+                        s = static_cast<u128>(m) * n[j] + t[j] + c;
+                        t[j - 1] = static_cast<uint64_t>(s);
+                        c = static_cast<uint64_t>(s >> 64);
+                    }
+                    s = static_cast<u128>(t[L]) + c;
+                    t[L - 1] = static_cast<uint64_t>(s);
+                    t[L] = t[L + 1] + static_cast<uint64_t>(s >> 64);
+                }
+                cond_sub_scalar<L>(t, t[L], n);
+                for (unsigned j = 0; j < L; ++j) out[j * kLanes + lane] = t[j];
+            }
+        }
+
+        template<unsigned L>
+        void add_scalar(uint64_t *out, const uint64_t *a, const uint64_t *b, const uint64_t *n) {
+            for (unsigned lane = 0; lane < kLanes; ++lane) {
+                uint64_t t[L];
+                uint64_t c = 0;
+                for (unsigned j = 0; j < L; ++j) {
+                    u128 s = static_cast<u128>(a[j * kLanes + lane]) + b[j * kLanes + lane] + c;
+                    t[j] = static_cast<uint64_t>(s);
+                    c = static_cast<uint64_t>(s >> 64);
+                }
+                cond_sub_scalar<L>(t, c, n);
+                for (unsigned j = 0; j < L; ++j) out[j * kLanes + lane] = t[j];
+            }
+        }
+
+        template<unsigned L>
+        void sub_scalar(uint64_t *out, const uint64_t *a, const uint64_t *b, const uint64_t *n) {
+            for (unsigned lane = 0; lane < kLanes; ++lane) {
+                uint64_t t[L];
+                uint64_t borrow = 0;
+                for (unsigned j = 0; j < L; ++j) {
+                    u128 s = static_cast<u128>(a[j * kLanes + lane]) - b[j * kLanes + lane] - borrow;
+                    t[j] = static_cast<uint64_t>(s);
+                    borrow = static_cast<uint64_t>(s >> 64) & 1;
+                }
+                uint64_t mask = 0 - borrow; // add n back when a < b
+                uint64_t c = 0;
+                for (unsigned j = 0; j < L; ++j) {
+                    u128 s = static_cast<u128>(t[j]) + (n[j] & mask) + c;
+                    out[j * kLanes + lane] = static_cast<uint64_t>(s);
+                    c = static_cast<uint64_t>(s >> 64);
+                }
+            }
+        }
+
+#ifdef MONT_LANES_X86
+        // ---- avx2: 26-bit limbs, lanes 0-3 and 4-7 in two ymm halves ----
+
+        constexpr unsigned kAvx2Radix = 26;
+
+        template<unsigned L>
+        __attribute__((target("avx2")))
+        inline void cond_sub_avx2(__m256i *t, const __m256i *nv, __m256i mask) {
+            __m256i d[L];
+            __m256i borrow = _mm256_setzero_si256();
+            for (unsigned j = 0; j < L; ++j) {
+                d[j] = _mm256_sub_epi64(_mm256_sub_epi64(t[j], nv[j]), borrow);
+                borrow = _mm256_srli_epi64(d[j], 63);
+                d[j] = _mm256_and_si256(d[j], mask);
+            }
+            __m256i keep = _mm256_sub_epi64(_mm256_setzero_si256(), borrow);
+            for (unsigned j = 0; j < L; ++j) t[j] = _mm256_blendv_epi8(d[j], t[j], keep);
+        }
+
+        template<unsigned L>
+        __attribute__((target("avx2")))
+        void mul_avx2(uint64_t *out, const uint64_t *a, const uint64_t *b, const uint64_t *n, uint64_t ninv) {
+            const __m256i mask = _mm256_set1_epi64x((1LL << kAvx2Radix) - 1);
+            const __m256i vninv = _mm256_set1_epi64x(static_cast<long long>(ninv));
+            __m256i nv[L];
+            for (unsigned j = 0; j < L; ++j) nv[j] = _mm256_set1_epi64x(static_cast<long long>(n[j]));
+
+            for (unsigned h = 0; h < kLanes; h += 4) {
+                __m256i bv[L], t[L];
+                for (unsigned j = 0; j < L; ++j) {
+                    bv[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j * kLanes + h));
+                    t[j] = _mm256_setzero_si256();
+                }
+                for (unsigned i = 0; i < L; ++i) {
+                    __m256i ai = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i * kLanes + h));
+                    for (unsigned j = 0; j < L; ++j) t[j] = _mm256_add_epi64(t[j], _mm256_mul_epu32(ai, bv[j]));
+                    __m256i m = _mm256_and_si256(_mm256_mul_epu32(_mm256_and_si256(t[0], mask), vninv), mask);
+                    for (unsigned j = 0; j < L; ++j) t[j] = _mm256_add_epi64(t[j], _mm256_mul_epu32(m, nv[j]));
+                    __m256i carry = _mm256_srli_epi64(t[0], kAvx2Radix);
+                    for (unsigned j = 0; j + 1 < L; ++j) t[j] = t[j + 1];
+                    t[L - 1] = _mm256_setzero_si256();
+                    t[0] = _mm256_add_epi64(t[0], carry);
+                }
+                __m256i carry = _mm256_setzero_si256();
+                for (unsigned j = 0; j < L; ++j) {
+                    t[j] = _mm256_add_epi64(t[j], carry);
+                    carry = _mm256_srli_epi64(t[j], kAvx2Radix);
+                    t[j] = _mm256_and_si256(t[j], mask);
+                }
+                cond_sub_avx2<L>(t, nv, mask);
+                for (unsigned j = 0; j < L; ++j) _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + j * kLanes + h), t[j]);
+            }
+        }
+
+        template<unsigned L>
+        __attribute__((target("avx2")))
+        void add_avx2(uint64_t *out, const uint64_t *a, const uint64_t *b, const uint64_t *n) {
+            const __m256i mask = _mm256_set1_epi64x((1LL << kAvx2Radix) - 1);
+            __m256i nv[L];
+            for (unsigned j = 0; j < L; ++j) nv[j] = _mm256_set1_epi64x(static_cast<long long>(n[j]));
+            for (unsigned h = 0; h < kLanes; h += 4) {
+                __m256i t[L];
+                __m256i carry = _mm256_setzero_si256();
+                for (unsigned j = 0; j < L; ++j) {
+                    __m256i av = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + j * kLanes + h));
+                    __m256i bv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j * kLanes + h));
+                    t[j] = _mm256_add_epi64(_mm256_add_epi64(av, bv), carry);
+                    carry = _mm256_srli_epi64(t[j], kAvx2Radix);
+                    t[j] = _mm256_and_si256(t[j], mask);
+                }
+                cond_sub_avx2<L>(t, nv, mask);
+                for (unsigned j = 0; j < L; ++j) _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + j * kLanes + h), t[j]);
+            }
+        }
+
+        template<unsigned L>
+        __attribute__((target("avx2")))
+        void sub_avx2(uint64_t *out, const uint64_t *a, const uint64_t *b, const uint64_t *n) {
+            const __m256i mask = _mm256_set1_epi64x((1LL << kAvx2Radix) - 1);
+            for (unsigned h = 0; h < kLanes; h += 4) {
+                __m256i t[L];
+                __m256i borrow = _mm256_setzero_si256();
+                for (unsigned j = 0; j < L; ++j) {
+                    __m256i av = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + j * kLanes + h));
+                    __m256i bv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j * kLanes + h));
+                    t[j] = _mm256_sub_epi64(_mm256_sub_epi64(av, bv), borrow);
+                    borrow = _mm256_srli_epi64(t[j], 63);
+                    t[j] = _mm256_and_si256(t[j], mask);
+                }
+                __m256i sel = _mm256_sub_epi64(_mm256_setzero_si256(), borrow);
+                __m256i carry = _mm256_setzero_si256();
+                for (unsigned j = 0; j < L; ++j) {
+                    __m256i nj = _mm256_and_si256(_mm256_set1_epi64x(static_cast<long long>(n[j])), sel);
+                    t[j] = _mm256_add_epi64(_mm256_add_epi64(t[j], nj), carry);
+                    carry = _mm256_srli_epi64(t[j], kAvx2Radix);
+                    t[j] = _mm256_and_si256(t[j], mask);
+                }
+                for (unsigned j = 0; j < L; ++j) _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + j * kLanes + h), t[j]);
+            }
+        }
+
+        // ---- avx-512 ifma: 52-bit limbs, all 8 lanes in one zmm ----
+
+        constexpr unsigned kIfmaRadix = 52;
+
+        template<unsigned L>
+        __attribute__((target("avx512f,avx512ifma")))
+        inline void cond_sub_ifma(__m512i *t, const __m512i *nv, __m512i mask) {
+            __m512i d[L];
+            __m512i borrow = _mm512_setzero_si512();
+            for (unsigned j = 0; j < L; ++j) {
+                d[j] = _mm512_sub_epi64(_mm512_sub_epi64(t[j], nv[j]), borrow);
+                borrow = _mm512_srli_epi64(d[j], 63);
+                d[j] = _mm512_and_si512(d[j], mask);
+            }
+            __mmask8 keep = _mm512_test_epi64_mask(borrow, borrow);
+            for (unsigned j = 0; j < L; ++j) t[j] = _mm512_mask_blend_epi64(keep, d[j], t[j]);
+        }
+
+        template<unsigned L>
+        __attribute__((target("avx512f,avx512ifma")))
+        void mul_ifma(uint64_t *out, const uint64_t *a, const uint64_t *b, const uint64_t *n, uint64_t ninv) {
+            const __m512i mask = _mm512_set1_epi64((1LL << kIfmaRadix) - 1);
+            const __m512i zero = _mm512_setzero_si512();
+            const __m512i vninv = _mm512_set1_epi64(static_cast<long long>(ninv));
+            __m512i nv[L], bv[L], t[L + 1];
+            for (unsigned j = 0; j < L; ++j) {
+                nv[j] = _mm512_set1_epi64(static_cast<long long>(n[j]));
+                bv[j] = _mm512_loadu_si512(b + j * kLanes);
+                t[j] = zero;
+            }
+            t[L] = zero;
+            for (unsigned i = 0; i < L; ++i) {
+                __m512i ai = _mm512_loadu_si512(a + i * kLanes);
+                for (unsigned j = 0; j < L; ++j) {
+                    t[j] = _mm512_madd52lo_epu64(t[j], ai, bv[j]);
+                    t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], ai, bv[j]);
+                }
+                __m512i m = _mm512_and_si512(_mm512_madd52lo_epu64(zero, t[0], vninv), mask);
+                for (unsigned j = 0; j < L; ++j) {
+                    t[j] = _mm512_madd52lo_epu64(t[j], m, nv[j]);
+                    t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], m, nv[j]);
+                }
+                __m512i carry = _mm512_srli_epi64(t[0], kIfmaRadix);
+                for (unsigned j = 0; j < L; ++j) t[j] = t[j + 1];
+                t[L] = zero;
+                t[0] = _mm512_add_epi64(t[0], carry);
+            }
+            __m512i carry = zero;
+            for (unsigned j = 0; j < L; ++j) {
+                t[j] = _mm512_add_epi64(t[j], carry);
+                carry = _mm512_srli_epi64(t[j], kIfmaRadix);
+                t[j] = _mm512_and_si512(t[j], mask);
+            }
+            cond_sub_ifma<L>(t, nv, mask);
+            for (unsigned j = 0; j < L; ++j) _mm512_storeu_si512(out + j * kLanes, t[j]);
+        }
+
+        template<unsigned L>
+        __attribute__((target("avx512f,avx512ifma")))
+        void add_ifma(uint64_t *out, const uint64_t *a, const uint64_t *b, const uint64_t *n) {
+            const __m512i mask = _mm512_set1_epi64((1LL << kIfmaRadix) - 1);
+            __m512i nv[L], t[L];
+            __m512i carry = _mm512_setzero_si512();
+            for (unsigned j = 0; j < L; ++j) {
+                nv[j] = _mm512_set1_epi64(static_cast<long long>(n[j]));
+                t[j] = _mm512_add_epi64(_mm512_add_epi64(_mm512_loadu_si512(a + j * kLanes),
+                                                         _mm512_loadu_si512(b + j * kLanes)), carry);
+                carry = _mm512_srli_epi64(t[j], kIfmaRadix);
+                t[j] = _mm512_and_si512(t[j], mask);
+            }
+            cond_sub_ifma<L>(t, nv, mask);
+            for (unsigned j = 0; j < L; ++j) _mm512_storeu_si512(out + j * kLanes, t[j]);
+        }
+
+        template<unsigned L>
+        __attribute__((target("avx512f,avx512ifma")))
+        void sub_ifma(uint64_t *out, const uint64_t *a, const uint64_t *b, const uint64_t *n) {
+            const __m512i mask = _mm512_set1_epi64((1LL << kIfmaRadix) - 1);
+            __m512i t[L];
+            __m512i borrow = _mm512_setzero_si512();
+            for (unsigned j = 0; j < L; ++j) {
+                t[j] = _mm512_sub_epi64(_mm512_sub_epi64(_mm512_loadu_si512(a + j * kLanes),
+                                                         _mm512_loadu_si512(b + j * kLanes)), borrow);
+                borrow = _mm512_srli_epi64(t[j], 63);
+                t[j] = _mm512_and_si512(t[j], mask);
+            }
+            __mmask8 sel = _mm512_test_epi64_mask(borrow, borrow);
+            __m512i carry = _mm512_setzero_si512();
+            for (unsigned j = 0; j < L; ++j) {
+                __m512i nj = _mm512_maskz_mov_epi64(sel, _mm512_set1_epi64(static_cast<long long>(n[j])));
+                t[j] = _mm512_add_epi64(_mm512_add_epi64(t[j], nj), carry);
+                carry = _mm512_srli_epi64(t[j], kIfmaRadix);
+                t[j] = _mm512_and_si512(t[j], mask);
+            }
+            for (unsigned j = 0; j < L; ++j) _mm512_storeu_si512(out + j * kLanes, t[j]);
+        }
+#endif
+
+        // ---- kernel tables, indexed by limb count ----
+
+        struct Kernels {
+            void (*mul)(uint64_t *, const uint64_t *, const uint64_t *, const uint64_t *, uint64_t);
+            void (*add)(uint64_t *, const uint64_t *, const uint64_t *, const uint64_t *);
+            void (*sub)(uint64_t *, const uint64_t *, const uint64_t *, const uint64_t *);
+        };
+
+        template<unsigned L>
+        Kernels scalar_kernels() { return {&mul_scalar<L>, &add_scalar<L>, &sub_scalar<L>}; }
+
+        Kernels pick_scalar(unsigned limbs) {
+            switch (limbs) {
+                case 1: return scalar_kernels<1>();
+                case 2: return scalar_kernels<2>();
+                case 3: return scalar_kernels<3>();
+                default: return scalar_kernels<4>();
+            }
+        }
+
+#ifdef MONT_LANES_X86
+        template<unsigned L>
+        Kernels avx2_kernels() { return {&mul_avx2<L>, &add_avx2<L>, &sub_avx2<L>}; }
+
+        Kernels pick_avx2(unsigned limbs) {
+            switch (limbs) {
+                case 1: return avx2_kernels<1>();
+                case 2: return avx2_kernels<2>();
+                case 3: return avx2_kernels<3>();
+                case 4: return avx2_kernels<4>();
+                case 5: return avx2_kernels<5>();
+                case 6: return avx2_kernels<6>();
+                case 7: return avx2_kernels<7>();
+                case 8: return avx2_kernels<8>();
+                case 9: return avx2_kernels<9>();
+                default: return avx2_kernels<10>();
+            }
+        }
+
+        template<unsigned L>
+        Kernels ifma_kernels() { return {&mul_ifma<L>, &add_ifma<L>, &sub_ifma<L>}; }
+
+        Kernels pick_ifma(unsigned limbs) {
+            switch (limbs) {
+                case 1: return ifma_kernels<1>();
+                case 2: return ifma_kernels<2>();
+                case 3: return ifma_kernels<3>();
+                case 4: return ifma_kernels<4>();
+                default: return ifma_kernels<5>();
+            }
+        }
+#endif
+
+        unsigned radix_of(Backend b) {
+            switch (b) {
+                case Backend::Avx512Ifma: return 52;
+                case Backend::Avx2: return 26;
+                default: return 64;
+            }
+        }
+
+        // v mod 2^radix as a machine word
+        uint64_t low_limb(const BigInt &v, unsigned radix) {
+            BigInt t;
+            mpz_tdiv_r_2exp(t.raw(), v.raw(), radix);
+            return static_cast<uint64_t>(mpz_get_ui(t.raw()));
+        }
+    }
+
+    bool backend_supported(Backend b) {
+        switch (b) {
+            case Backend::Scalar: return true;
+#ifdef MONT_LANES_X86
+            case Backend::Avx2: return __builtin_cpu_supports("avx2");
+            case Backend::Avx512Ifma: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma");
+#endif
+            default: return false;
+        }
+    }
+
+    Backend best_backend() {
+        if (backend_supported(Backend::Avx512Ifma)) return Backend::Avx512Ifma;
+        if (backend_supported(Backend::Avx2)) return Backend::Avx2;
+        return Backend::Scalar;
+    }
+
+    const char *backend_name(Backend b) {
+        switch (b) {
+            case Backend::Avx512Ifma: return "avx512-ifma";
+            case Backend::Avx2: return "avx2";
+            default: return "scalar";
+        }
+    }
+
+    LaneContext::LaneContext(const BigInt &n, Backend backend)
+        : n_(n), backend_(backend), radix_(radix_of(backend)) {
+        if (!fits(n)) throw std::invalid_argument("mont lanes: n must be odd, > 1 and at most 256 bits");
+        if (!backend_supported(backend)) throw std::invalid_argument("mont lanes: backend not supported on this cpu");
+
+        // the vector kernels need 2n < R so the pre-subtraction result fits in L limbs
+        size_t need = radix_ == 64 ? n.bit_length() : n.bit_length() + 1;
+        limbs_ = static_cast<unsigned>((need + radix_ - 1) / radix_);
+
+        n_limbs_.resize(limbs_);
+        BigInt rest = n;
+        for (unsigned j = 0; j < limbs_; ++j) {
+            n_limbs_[j] = low_limb(rest, radix_);
+            mpz_fdiv_q_2exp(rest.raw(), rest.raw(), radix_);
+        }
+
+        // -n^-1 mod 2^radix by newton iteration (each step doubles the correct low bits)
+        uint64_t inv = n_limbs_[0];
+        for (int i = 0; i < 6; ++i) inv *= 2 - n_limbs_[0] * inv;
+        ninv_ = 0 - inv;
+        if (radix_ < 64) ninv_ &= (1ULL << radix_) - 1;
+
+        BigInt r(static_cast<uint64_t>(1));
+        mpz_mul_2exp(r.raw(), r.raw(), static_cast<mp_bitcnt_t>(radix_) * limbs_);
+        r_inv_ = *BigInt::mod_inverse(r % n_, n_);
+
+        Kernels k{};
+        switch (backend_) {
+#ifdef MONT_LANES_X86
+            case Backend::Avx512Ifma: k = pick_ifma(limbs_); break;
+            case Backend::Avx2: k = pick_avx2(limbs_); break;
+#endif
+            default: k = pick_scalar(limbs_); break;
+        }
+        mul_ = k.mul;
+        add_ = k.add;
+        sub_ = k.sub;
+    }
+
+    void LaneContext::set(LaneReg &r, unsigned lane, const BigInt &v) const {
+        BigInt m = v % n_;
+        mpz_mul_2exp(m.raw(), m.raw(), static_cast<mp_bitcnt_t>(radix_) * limbs_);
+        m %= n_;
+        for (unsigned j = 0; j < limbs_; ++j) {
+            r[j * kLanes + lane] = low_limb(m, radix_);
+            mpz_fdiv_q_2exp(m.raw(), m.raw(), radix_);
+        }
+    }
+
+    void LaneContext::fill(LaneReg &r, const BigInt &v) const {
+        set(r, 0, v);
+        for (unsigned j = 0; j < limbs_; ++j)
+            for (unsigned lane = 1; lane < kLanes; ++lane) r[j * kLanes + lane] = r[j * kLanes];
+    }
+
+    BigInt LaneContext::get(const LaneReg &r, unsigned lane) const {
+        BigInt v, limb;
+        for (unsigned j = limbs_; j-- > 0;) {
+            mpz_mul_2exp(v.raw(), v.raw(), radix_);
+            mpz_import(limb.raw(), 1, -1, sizeof(uint64_t), 0, 0, &r[j * kLanes + lane]);
+            v += limb;
+        }
+        v *= r_inv_;
+        v %= n_;
+        return v;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "bigint.hpp"
+#include <cstdint>
+#include <vector>
+
+/*
+ * Multi-lane Montgomery arithmetic for odd moduli up to 256 bits.
+ * A LaneReg holds kLanes independent residues mod the same n, stored limb-major
+ * (limb j of lane l at [j * kLanes + l]) so a SIMD kernel handles one limb of every
+ * lane with one instruction. Values live in Montgomery form and are always canonical (< n).
+ *
+ * Kernels, picked at runtime from what the CPU supports:
+ *   - Avx512Ifma: 52-bit limbs, all 8 lanes in one zmm register (vpmadd52lo/hi)
+ *   - Avx2: 26-bit limbs, 2 x 4 lanes with vpmuludq and lazy carries
+ *   - Scalar: 64-bit limbs, plain CIOS per lane with unsigned __int128
+ */
+namespace mont {
+    enum class Backend { Scalar, Avx2, Avx512Ifma };
+
+    constexpr unsigned kLanes = 8;
+    constexpr size_t kMaxBits = 256;
+
+    using LaneReg = std::vector<uint64_t>;
+
+    bool backend_supported(Backend b);
+    Backend best_backend();
+    const char *backend_name(Backend b);
+
+    class LaneContext {
+    public:
+        // throws std::invalid_argument unless fits(n) and the backend is supported
+        explicit LaneContext(const BigInt &n, Backend backend = best_backend());
+
+        static bool fits(const BigInt &n) {
+            return !n.is_even() && n > BigInt(static_cast<uint64_t>(1)) && n.bit_length() <= kMaxBits;
+        }
+
+        Backend backend() const { return backend_; }
+        const BigInt &modulus() const { return n_; }
+
+        LaneReg reg() const { return LaneReg(static_cast<size_t>(limbs_) * kLanes, 0); }
+        void set(LaneReg &r, unsigned lane, const BigInt &v) const; // stores v mod n (montgomery form)
+        void fill(LaneReg &r, const BigInt &v) const;               // same value in every lane
+        BigInt get(const LaneReg &r, unsigned lane) const;          // back to the normal domain
+
+        // out may alias a or b
+        void mul(LaneReg &out, const LaneReg &a, const LaneReg &b) const { mul_(out.data(), a.data(), b.data(), n_limbs_.data(), ninv_); }
+        void sqr(LaneReg &out, const LaneReg &a) const { mul_(out.data(), a.data(), a.data(), n_limbs_.data(), ninv_); }
+        void add(LaneReg &out, const LaneReg &a, const LaneReg &b) const { add_(out.data(), a.data(), b.data(), n_limbs_.data()); }
+        void sub(LaneReg &out, const LaneReg &a, const LaneReg &b) const { sub_(out.data(), a.data(), b.data(), n_limbs_.data()); }
+
+    private:
+        using MulFn = void (*)(uint64_t *, const uint64_t *, const uint64_t *, const uint64_t *, uint64_t);
+        using AddFn = void (*)(uint64_t *, const uint64_t *, const uint64_t *, const uint64_t *);
+
+        BigInt n_;
+        BigInt r_inv_; // R^-1 mod n
+        Backend backend_;
+        unsigned radix_; // bits per limb
+        unsigned limbs_;
+        uint64_t ninv_; // -n^-1 mod 2^radix
+        std::vector<uint64_t> n_limbs_;
+        MulFn mul_;
+        AddFn add_;
+        AddFn sub_;
+    };
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "bigint.hpp"
+#include <cstdint>
+#include <utility>
+
+/*
+ * Montgomery arithmetic for an odd modulus that fits in one or two machine words.
+ * Same job as ModContext, but the residues are plain uint64_t / unsigned __int128 values,
+ * so a hot loop (rho on small cofactors) has no limbs, no gmp calls and no allocation.
+ * Values are kept canonical (< n) and every n < 2^64 (Word64) or < 2^128 (Word128) works:
+ * REDC subtracts m*n from the high half instead of adding, so nothing overflows.
+ */
+namespace mont {
+    using u128 = unsigned __int128;
+
+    // n -> native word; callers check bit_length() first
+    inline uint64_t to_u64(const BigInt &n) { return mpz_get_ui(n.raw()); }
+
+    inline u128 to_u128(const BigInt &n) {
+        uint64_t w[2] = {0, 0};
+        mpz_export(w, nullptr, -1, sizeof(uint64_t), 0, 0, n.raw());
+        return (static_cast<u128>(w[1]) << 64) | w[0];
+    }
+
+    inline BigInt from_u128(u128 x) {
+        uint64_t w[2] = {static_cast<uint64_t>(x), static_cast<uint64_t>(x >> 64)};
+        BigInt r;
+        mpz_import(r.raw(), 2, -1, sizeof(uint64_t), 0, 0, w);
+        return r;
+    }
+
+    template <class U>
+    U gcd_word(U a, U b) {
+        // binary gcd: no divisions, and works on unsigned __int128 where std::gcd may not
+        if (a == 0) return b;
+        if (b == 0) return a;
+        auto ctz = [](U x) {
+            uint64_t lo = static_cast<uint64_t>(x);
+            // x >> 32 >> 32 instead of x >> 64 so the U = uint64_t instantiation stays defined
+            return lo ? __builtin_ctzll(lo) : 64 + __builtin_ctzll(static_cast<uint64_t>(x >> 32 >> 32));
+        };
+        int shift = ctz(a | b);
+        a >>= ctz(a);
+        do {
+            b >>= ctz(b);
+            if (a > b) std::swap(a, b);
+            b -= a;
+        } while (b != 0);
+        return a << shift;
+    }
+
+    // x^-1 mod 2^bits for odd x (newton, doubling the correct bits each round)
+    template <class U>
+    U inverse_pow2(U x) {
+        U inv = x; // correct to 3 bits: x*x = 1 mod 8 for odd x
+        for (int i = 0; i < 6; ++i) inv *= 2 - x * inv;
+        return inv;
+    }
+
+    // modular add / sub for a, b < n without overflow, n up to the full word
+    template <class U>
+    inline U add_word(U a, U b, U n) { return a >= n - b ? a - (n - b) : a + b; }
+    template <class U>
+    inline U sub_word(U a, U b, U n) { return a >= b ? a - b : a + (n - b); }
+
+    class Word64 {
+    public:
+        using word = uint64_t;
+
+        explicit Word64(uint64_t n) : n_(n), ninv_(inverse_pow2(n)) {
+            one_ = static_cast<uint64_t>((static_cast<u128>(1) << 64) % n);
+            r2_ = static_cast<uint64_t>(static_cast<u128>(one_) * one_ % n);
+        }
+
+        uint64_t modulus() const { return n_; }
+        uint64_t one() const { return one_; }
+        uint64_t to_mont(uint64_t x) const { return mul(x % n_, r2_); }
+        uint64_t from_mont(uint64_t x) const { return redc(0, x); }
+
+        uint64_t mul(uint64_t a, uint64_t b) const {
+            u128 t = static_cast<u128>(a) * b;
+            return redc(static_cast<uint64_t>(t >> 64), static_cast<uint64_t>(t));
+        }
+        uint64_t sqr(uint64_t a) const { return mul(a, a); }
+        uint64_t add(uint64_t a, uint64_t b) const { return add_word(a, b, n_); }
+        uint64_t sub(uint64_t a, uint64_t b) const { return sub_word(a, b, n_); }
+
+    private:
+        // (hi:lo) * 2^-64 mod n for hi < n
+        uint64_t redc(uint64_t hi, uint64_t lo) const {
+            uint64_t m = lo * ninv_;
+            uint64_t mn = static_cast<uint64_t>((static_cast<u128>(m) * n_) >> 64);
+            return hi >= mn ? hi - mn : hi + (n_ - mn);
+        }
+
+        uint64_t n_, ninv_, one_, r2_;
+    };
+
+    class Word128 {
+    public:
+        using word = u128;
+
+        explicit Word128(u128 n) : n_(n), ninv_(inverse_pow2(n)) {
+            one_ = (0 - n) % n; // 2^128 mod n
+            // R^2 mod n by 128 doublings of R, once per modulus
+            r2_ = one_;
+            for (int i = 0; i < 128; ++i) r2_ = add_word(r2_, r2_, n_);
+        }
+
+        u128 modulus() const { return n_; }
+        u128 one() const { return one_; }
+        u128 to_mont(u128 x) const { return mul(x % n_, r2_); }
+        u128 from_mont(u128 x) const { return redc(0, x); }
+
+        u128 mul(u128 a, u128 b) const {
+            u128 hi, lo;
+            mul_full(a, b, hi, lo);
+            return redc(hi, lo);
+        }
+        u128 sqr(u128 a) const { return mul(a, a); }
+        u128 add(u128 a, u128 b) const { return add_word(a, b, n_); }
+        u128 sub(u128 a, u128 b) const { return sub_word(a, b, n_); }
+
+    private:
+        // a * b as two 128-bit halves, schoolbook on 64-bit limbs
+        static void mul_full(u128 a, u128 b, u128 &hi, u128 &lo) {
+            uint64_t a0 = static_cast<uint64_t>(a), a1 = static_cast<uint64_t>(a >> 64);
+            uint64_t b0 = static_cast<uint64_t>(b), b1 = static_cast<uint64_t>(b >> 64);
+            u128 p00 = static_cast<u128>(a0) * b0, p01 = static_cast<u128>(a0) * b1;
+            u128 p10 = static_cast<u128>(a1) * b0, p11 = static_cast<u128>(a1) * b1;
+            u128 mid = (p00 >> 64) + static_cast<uint64_t>(p01) + static_cast<uint64_t>(p10);
+            lo = (mid << 64) | static_cast<uint64_t>(p00);
+            hi = p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64);
+        }
+
+        u128 redc(u128 hi, u128 lo) const {
+            u128 m = lo * ninv_, mn, unused;
+            mul_full(m, n_, mn, unused);
+            return hi >= mn ? hi - mn : hi + (n_ - mn);
+        }
+
+        u128 n_, ninv_, one_, r2_;
+    };
+}
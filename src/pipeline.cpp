@@ -0,0 +1,307 @@
+#include "pipeline.hpp"
+#include "utils/stop.hpp"
+#include "attacks/trial.hpp"
+#include "attacks/wiener.hpp"
+#include "attacks/fermat.hpp"
+#include "attacks/lehman.hpp"
+#include "attacks/rho.hpp"
+#include "attacks/pminus1.hpp"
+#include "attacks/ecm.hpp"
+#include "attacks/siqs.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+/*
+ * DESIGN.md lists the auto stages in a fixed order. Run one after the other, a key that only
+ * ecm can break pays for every fermat / hart / p-1 budget before ecm even starts.
+ * So all stages start together on their own threads, each with a utils::StopToken made of the
+ * shared "somebody won" flag and the stage's own deadline. The first stage to come back with a
+ * proper factor raises the flag; the others see it at their next poll and return.
+ * The gcds against related items have no poll, they finish in microseconds.
+ *
+ * Thread split: rho and p-1 are one thread each (their work does not parallelise past a
+ * couple of walks / bases), the remaining threads go to ecm and, when n is in its range,
+ * siqs. The cheap stages are short enough that oversubscribing for their first second or two
+ * costs less than serialising them.
+ */
+
+namespace pipeline {
+    namespace {
+        using clock = std::chrono::steady_clock;
+
+        struct Outcome {
+            bool found{false};
+            BigInt factor{static_cast<uint64_t>(0)};
+            utils::Metrics metrics; // counters only, the pipeline takes the times around the stage
+            std::string log;
+        };
+
+        struct Stage {
+            std::string name;
+            unsigned long long budget_ms;
+            std::function<Outcome(const utils::StopToken &)> run;
+            std::string skip; // non-empty: not applicable to this n, the reason
+        };
+
+        // ecm B1 and curve counts per expected factor size (15 .. 40 digits)
+        struct EcmLevel {
+            unsigned long long B1, curves;
+        };
+        constexpr EcmLevel kEcmLevels[] = {{2000, 25},      {11000, 90},      {50000, 300},
+                                           {250000, 700},   {1000000, 1800},  {3000000, 5100}};
+
+        // siqs parameters cover this range; rho finishes anything smaller before siqs is set up
+        constexpr unsigned kSiqsMinDigits = 20;
+        constexpr unsigned kSiqsMaxDigits = 100;
+
+        constexpr size_t kReportLogChars = 160;
+
+        double since(clock::time_point t0) { return std::chrono::duration<double>(clock::now() - t0).count(); }
+
+        template <class R>
+        Outcome from_factor(const R &r) {
+            return {r.success, r.factor, r.metrics, r.log};
+        }
+
+        template <class R>
+        Outcome from_pq(const R &r) {
+            return {r.success, r.p, r.metrics, r.log};
+        }
+
+        // even n, perfect powers and primes are settled before anything is launched
+        bool sanity(const BigInt &n, Result &res, StageReport &rep) {
+            rep.name = "sanity";
+            BigInt three(static_cast<uint64_t>(3));
+            if (n <= three) {
+                rep.status = Status::NotFound;
+                rep.log = "n must be > 3";
+                return true;
+            }
+            if (n.is_even()) {
+                rep.status = Status::Found;
+                rep.log = "n is even";
+                res.p = BigInt(static_cast<uint64_t>(2));
+                return true;
+            }
+            if (mpz_probab_prime_p(n.raw(), 25)) {
+                rep.status = Status::NotFound;
+                rep.log = "n is prime";
+                return true;
+            }
+            if (mpz_perfect_power_p(n.raw())) {
+                for (unsigned e = 2;; ++e) {
+                    BigInt r = BigInt::nth_root_floor(n, e);
+                    BigInt pw;
+                    mpz_pow_ui(pw.raw(), r.raw(), e);
+                    if (pw == n) {
+                        rep.status = Status::Found;
+                        rep.log = "n is a perfect power (e=" + std::to_string(e) + ")";
+                        res.p = r;
+                        return true;
+                    }
+                }
+            }
+            rep.status = Status::NotFound;
+            rep.log = "odd composite, not a perfect power";
+            return false;
+        }
+
+        std::vector<Stage> build_stages(const BigInt &n, const Options &opt, unsigned threads) {
+            constexpr auto kUnbounded = std::numeric_limits<unsigned long long>::max();
+            unsigned digits = static_cast<unsigned>(mpz_sizeinbase(n.raw(), 10));
+            bool siqs_ok = digits >= kSiqsMinDigits && digits <= kSiqsMaxDigits;
+            unsigned heavy = threads > 2 ? threads - 2 : 1;
+            unsigned ecm_threads = siqs_ok ? std::max(1u, heavy / 2) : heavy;
+            unsigned siqs_threads = std::max(1u, heavy - heavy / 2);
+            std::vector<Stage> st;
+
+            // cheap structural checks
+            st.push_back({"trial", 0, [&n](const utils::StopToken &stop) {
+                TrialResult tr = trial_division(n, 1000000ULL, stop);
+                Outcome o;
+                o.metrics = tr.metrics;
+                o.log = tr.log;
+                if (tr.success) {
+                    o.found = true;
+                    o.factor = BigInt(tr.primes.front());
+                }
+                return o;
+            }, ""});
+            st.push_back({"gcd", 0, [&n, &opt](const utils::StopToken &) {
+                Outcome o;
+                o.metrics.unit = "related items";
+                BigInt one(static_cast<uint64_t>(1));
+                for (size_t i = 0; i < opt.related.size(); ++i) {
+                    BigInt g = BigInt::gcd(n, opt.related[i]);
+                    ++o.metrics.iterations;
+                    ++o.metrics.gcds;
+                    if (g != one && g != n) {
+                        o.found = true;
+                        o.factor = g;
+                        o.log = "shares a factor with related item " + std::to_string(i);
+                        return o;
+                    }
+                }
+                o.log = "no shared factor with " + std::to_string(opt.related.size()) + " related items";
+                return o;
+            }, opt.related.empty() ? "no related moduli or factors given" : ""});
+            st.push_back({"wiener", 0, [&n, &opt](const utils::StopToken &stop) {
+                return from_pq(wiener_attack(n, opt.e, stop));
+            }, opt.e.is_zero() ? "e unknown" : ""});
+            st.push_back({"fermat", opt.cheap_ms, [&n](const utils::StopToken &stop) {
+                return from_pq(fermat_factor(n, kUnbounded, stop));
+            }, ""});
+            st.push_back({"hart", opt.cheap_ms, [&n](const utils::StopToken &stop) {
+                return from_pq(hart_olf(n, 100000000ULL, 1, 0ULL, stop));
+            }, ""});
+            st.push_back({"p-1 small", opt.cheap_ms, [&n](const utils::StopToken &stop) {
+                return from_factor(pollards_pminus1(n, 20000ULL, 1ULL, 2000000ULL, PMinus1Stage2::Auto, stop));
+            }, ""});
+
+            // expensive general methods
+            st.push_back({"rho", opt.rho_ms, [&n, &opt](const utils::StopToken &stop) {
+                return from_factor(rho_attack_parallel(n, 1, opt.seed, kUnbounded, 128ULL, stop));
+            }, ""});
+            st.push_back({"p-1", opt.pminus1_ms, [&n](const utils::StopToken &stop) {
+                return from_factor(pollards_pminus1(n, 2000000ULL, 2ULL, 200000000ULL, PMinus1Stage2::Auto, stop));
+            }, ""});
+            st.push_back({"ecm", opt.ecm_ms, [&n, &opt, ecm_threads](const utils::StopToken &stop) {
+                // climb the B1 table; every level is a fresh set of curves
+                Outcome o;
+                o.metrics.unit = "curves";
+                for (size_t lv = 0; lv < std::size(kEcmLevels) && !stop.stop_requested(); ++lv) {
+                    EcmResult er = ecm_factor(n, kEcmLevels[lv].B1, 0ULL, kEcmLevels[lv].curves, ecm_threads,
+                                              opt.seed + lv, stop);
+                    o.metrics += er.metrics;
+                    o.log = er.log;
+                    if (er.success) {
+                        o.found = true;
+                        o.factor = er.factor;
+                        return o;
+                    }
+                }
+                return o;
+            }, ""});
+            st.push_back({"siqs", opt.siqs_ms, [&n, &opt, siqs_threads](const utils::StopToken &stop) {
+                return from_factor(siqs_factor(n, siqs_threads, opt.seed, stop));
+            }, siqs_ok ? "" : "n has " + std::to_string(digits) + " digits, siqs takes " +
+                                  std::to_string(kSiqsMinDigits) + " to " + std::to_string(kSiqsMaxDigits)});
+            return st;
+        }
+    }
+
+    const char *status_name(Status s) {
+        switch (s) {
+            case Status::Found: return "found";
+            case Status::NotFound: return "not found";
+            case Status::TimedOut: return "timed out";
+            case Status::Cancelled: return "cancelled";
+            case Status::Skipped: return "skipped";
+        }
+        return "?";
+    }
+
+    Result auto_factor(const BigInt &n, const Options &opt, const utils::StopToken &stop) {
+        Result res;
+        std::ostringstream log;
+        auto t0 = clock::now();
+
+        StageReport first;
+        utils::MetricsClock sanity_cost;
+        bool settled = sanity(n, res, first);
+        first.seconds = since(t0);
+        first.metrics.unit = "checks";
+        sanity_cost.stamp(first.metrics);
+        res.stages.push_back(first);
+        if (!settled) {
+            unsigned threads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+            std::vector<Stage> stages = build_stages(n, opt, threads);
+            std::vector<StageReport> reports(stages.size());
+            std::atomic<bool> won{false};
+            std::mutex mu;
+            utils::StopToken root = stop.also(&won);
+
+            auto run = [&](size_t i) {
+                const Stage &s = stages[i];
+                StageReport &rep = reports[i];
+                rep.start = since(t0);
+                utils::StopToken stage_stop = root.within(std::chrono::milliseconds(s.budget_ms));
+                utils::MetricsClock cost;
+                Outcome o = s.run(stage_stop);
+                rep.seconds = since(t0) - rep.start;
+                rep.metrics = o.metrics;
+                cost.stamp(rep.metrics);
+                rep.log = o.log;
+                BigInt one(static_cast<uint64_t>(1));
+                bool proper = o.found && o.factor > one && o.factor < n && (n % o.factor).is_zero();
+                if (proper) {
+                    rep.status = Status::Found;
+                    std::lock_guard<std::mutex> lock(mu);
+                    if (!won.exchange(true)) {
+                        res.stage = s.name;
+                        res.p = o.factor;
+                    }
+                } else if (won.load() || stop.stop_requested()) {
+                    rep.status = Status::Cancelled;
+                } else if (stage_stop.has_deadline() && clock::now() >= stage_stop.deadline()) {
+                    rep.status = Status::TimedOut;
+                } else {
+                    rep.status = Status::NotFound;
+                }
+            };
+
+            std::vector<std::jthread> pool;
+            pool.reserve(stages.size());
+            for (size_t i = 0; i < stages.size(); ++i) {
+                reports[i].name = stages[i].name;
+                if (!stages[i].skip.empty()) {
+                    reports[i].log = stages[i].skip;
+                    continue;
+                }
+                pool.emplace_back(run, i);
+            }
+            pool.clear(); // joins
+            res.stages.insert(res.stages.end(), reports.begin(), reports.end());
+        } else if (first.status == Status::Found) {
+            res.stage = first.name;
+        }
+
+        res.seconds = since(t0);
+        if (!res.p.is_zero()) {
+            res.success = true;
+            res.q = n / res.p;
+            if (res.q < res.p) std::swap(res.p, res.q);
+            BigInt one(static_cast<uint64_t>(1));
+            if (!opt.e.is_zero() && mpz_probab_prime_p(res.p.raw(), 25) && mpz_probab_prime_p(res.q.raw(), 25)) {
+                auto d = BigInt::mod_inverse(opt.e, (res.p - one) * (res.q - one));
+                if (d) res.d = *d;
+            }
+            log << "factored by " << res.stage << " in " << std::fixed << std::setprecision(3) << res.seconds << "s";
+        } else {
+            log << "no stage found a factor in " << std::fixed << std::setprecision(3) << res.seconds << "s";
+        }
+        res.log = log.str();
+        return res;
+    }
+
+    std::string format_report(const Result &r, bool with_metrics) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3);
+        for (const StageReport &s : r.stages) {
+            std::string line = s.log.size() > kReportLogChars ? s.log.substr(0, kReportLogChars) + "..." : s.log;
+            out << "[+" << s.start << "s] " << std::left << std::setw(10) << s.name << " " << std::setw(9)
+                << status_name(s.status) << " " << std::right << std::setw(8) << s.seconds << "s  " << line << "\n";
+            if (with_metrics && s.status != Status::Skipped) out << std::string(14, ' ') << s.metrics.format() << "\n";
+        }
+        out << r.log << "\n";
+        return out.str();
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "bigint.hpp"
+#include "utils/metrics.hpp"
+#include "utils/stop.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * The `auto` attack pipeline: every applicable attack on one modulus races at once on its
+ * own thread, the first proper factor wins and cancels the rest.
+ *
+ * Cheap structural checks (trial division, shared gcd, wiener, fermat, hart, small p-1) get
+ * a short budget each; the expensive general methods (rho, p-1, ecm, siqs) get their own
+ * budgets and split the worker threads between them. A key falls in the time of the fastest
+ * attack that applies to it, not the sum of all of them.
+ */
+namespace pipeline {
+    struct Options {
+        BigInt e{static_cast<uint64_t>(0)}; // public exponent, 0 = unknown (wiener is skipped)
+        std::vector<BigInt> related;         // known factors / other moduli for the shared gcd check
+        unsigned threads{0};                 // split between the expensive stages (0 = all hardware threads)
+        uint64_t seed{1};                    // rho walks, ecm curves, siqs families
+        unsigned long long cheap_ms{2000};   // budget of each cheap stage
+        unsigned long long rho_ms{15000};
+        unsigned long long pminus1_ms{20000};
+        unsigned long long ecm_ms{60000};
+        unsigned long long siqs_ms{120000};
+    };
+
+    enum class Status { Found, NotFound, TimedOut, Cancelled, Skipped };
+
+    const char *status_name(Status s);
+
+    struct StageReport {
+        std::string name;
+        Status status{Status::Skipped};
+        double start{0};   // seconds after the pipeline started
+        double seconds{0}; // wall time of the stage
+        utils::Metrics metrics; // the attack's counters, times taken around the stage
+        std::string log;
+    };
+
+    struct Result {
+        bool success{false};
+        std::string stage;                   // winning stage
+        BigInt p{static_cast<uint64_t>(0)};  // p <= q, p * q = n
+        BigInt q{static_cast<uint64_t>(0)};
+        BigInt d{static_cast<uint64_t>(0)};  // e^-1 mod (p-1)(q-1) when e is known and p, q are prime
+        std::vector<StageReport> stages;     // in launch order
+        double seconds{0};
+        std::string log;
+    };
+
+    // `stop` ends every running stage (status cancelled), on top of the pipeline's own budgets
+    Result auto_factor(const BigInt &n, const Options &opt = {}, const utils::StopToken &stop = {});
+
+    // one line per stage: offset, name, status, wall time, stage log (and its metrics under it)
+    std::string format_report(const Result &r, bool with_metrics = false);
+}
@@ -0,0 +1,166 @@
+#include "polymod.hpp"
+#include <algorithm>
+
+namespace polymod {
+    namespace {
+        // pack coefficients into `slot` limbs each
+        void pack(mpz_t out, const Poly &a, size_t slot) {
+            size_t total = a.size() * slot;
+            mp_limb_t *w = mpz_limbs_write(out, static_cast<mp_size_t>(total));
+            std::fill(w, w + total, 0);
+            for (size_t i = 0; i < a.size(); ++i) {
+                size_t sz = mpz_size(a[i].raw());
+                const mp_limb_t *src = mpz_limbs_read(a[i].raw());
+                std::copy(src, src + sz, w + i * slot);
+            }
+            mpz_limbs_finish(out, static_cast<mp_size_t>(total));
+        }
+
+        Poly truncate(Poly p, size_t len) {
+            if (p.size() > len) p.resize(len);
+            return p;
+        }
+
+        Poly reversed(const Poly &p, size_t len) {
+            Poly r(len);
+            for (size_t i = 0; i < len && i < p.size(); ++i) r[i] = p[p.size() - 1 - i];
+            return r;
+        }
+
+        // f^-1 mod X^len for f[0] = 1: g <- g + g*(1 - f*g), doubling the precision each round
+        Poly inverse_series(const Poly &f, size_t len, const BigInt &n) {
+            Poly g{BigInt(static_cast<uint64_t>(1))};
+            Poly e, d;
+            for (size_t cur = 1; cur < len;) {
+                size_t next = std::min(2 * cur, len);
+                mul(e, truncate(f, next), g, n);
+                e.resize(next);
+                d.assign(next, BigInt());
+                for (size_t i = 0; i < next; ++i) {
+                    if (!e[i].is_zero()) d[i] = n - e[i];
+                }
+                mpz_add_ui(d[0].raw(), d[0].raw(), 1);
+                d[0] %= n; // d = 1 - f*g, zero below X^cur
+                mul(e, g, d, n);
+                g.resize(next);
+                for (size_t i = 0; i < next; ++i) {
+                    g[i] += e[i];
+                    if (!(g[i] < n)) g[i] -= n;
+                }
+                cur = next;
+            }
+            return g;
+        }
+
+        // levels[0] = linear factors (X - x_i), levels[l+1][i] = levels[l][2i] * levels[l][2i+1]
+        std::vector<std::vector<Poly>> subproduct_tree(const std::vector<BigInt> &xs, const BigInt &n) {
+            std::vector<std::vector<Poly>> levels(1);
+            levels[0].reserve(xs.size());
+            for (const BigInt &x : xs) {
+                BigInt c = x % n;
+                if (!c.is_zero()) c = n - c;
+                levels[0].push_back(Poly{c, BigInt(static_cast<uint64_t>(1))});
+            }
+            while (levels.back().size() > 1) {
+                const auto &below = levels.back();
+                std::vector<Poly> up((below.size() + 1) / 2);
+                for (size_t i = 0; i < up.size(); ++i) {
+                    if (2 * i + 1 < below.size()) mul(up[i], below[2 * i], below[2 * i + 1], n);
+                    else up[i] = below[2 * i];
+                }
+                levels.push_back(std::move(up));
+            }
+            return levels;
+        }
+    }
+
+    void mul(Poly &r, const Poly &a, const Poly &b, const BigInt &n) {
+        if (a.empty() || b.empty()) {
+            r.clear();
+            return;
+        }
+        // a slot has to hold a sum of min(|a|, |b|) products of two residues
+        size_t terms = std::min(a.size(), b.size());
+        size_t bits = 2 * n.bit_length() + 1;
+        while (terms) { ++bits; terms >>= 1; }
+        size_t slot = (bits + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS;
+
+        mpz_t A, B, C;
+        mpz_inits(A, B, C, nullptr);
+        pack(A, a, slot);
+        if (&a == &b) {
+            mpz_mul(C, A, A);
+        } else {
+            pack(B, b, slot);
+            mpz_mul(C, A, B);
+        }
+
+        size_t len = a.size() + b.size() - 1;
+        r.resize(len);
+        const mp_limb_t *c = mpz_limbs_read(C);
+        size_t csz = mpz_size(C);
+        for (size_t i = 0; i < len; ++i) {
+            size_t lo = i * slot;
+            if (lo >= csz) {
+                mpz_set_ui(r[i].raw(), 0);
+                continue;
+            }
+            mpz_t view;
+            mpz_roinit_n(view, c + lo, static_cast<mp_size_t>(std::min(slot, csz - lo)));
+            mpz_mod(r[i].raw(), view, n.raw());
+        }
+        mpz_clears(A, B, C, nullptr);
+    }
+
+    Poly rem_monic(const Poly &a, const Poly &b, const BigInt &n) {
+        size_t m = b.size() - 1;
+        if (a.size() <= m) return a;
+        size_t qlen = a.size() - m;
+
+        // rev(a) = rev(q) * rev(b) mod X^qlen
+        Poly inv = inverse_series(reversed(b, std::min(b.size(), qlen)), qlen, n);
+        Poly q;
+        mul(q, reversed(a, qlen), inv, n);
+        q.resize(qlen);
+        std::reverse(q.begin(), q.end());
+
+        Poly qb;
+        mul(qb, q, truncate(b, m), n); // the top of q*b cancels a exactly
+        Poly r(m);
+        for (size_t i = 0; i < m; ++i) {
+            r[i] = a[i];
+            if (i < qb.size()) {
+                r[i] -= qb[i];
+                if (r[i] < BigInt()) r[i] += n;
+            }
+        }
+        return r;
+    }
+
+    Poly from_roots(const std::vector<BigInt> &xs, const BigInt &n) {
+        if (xs.empty()) return Poly{BigInt(static_cast<uint64_t>(1))};
+        return subproduct_tree(xs, n).back()[0];
+    }
+
+    BigInt eval_product(const Poly &f, const std::vector<BigInt> &xs, const BigInt &n) {
+        BigInt acc(static_cast<uint64_t>(1));
+        if (xs.empty()) return acc;
+        auto levels = subproduct_tree(xs, n);
+
+        // walk the remainders down the tree: f mod node, then mod each child, ...
+        std::vector<Poly> rems{rem_monic(f, levels.back()[0], n)};
+        for (size_t l = levels.size() - 1; l-- > 0;) {
+            const auto &nodes = levels[l];
+            std::vector<Poly> next(nodes.size());
+            for (size_t i = 0; i < nodes.size(); ++i) next[i] = rem_monic(rems[i / 2], nodes[i], n);
+            rems = std::move(next);
+        }
+        // leaves: f mod (X - x_i) is the constant f(x_i)
+        for (const Poly &r : rems) {
+            if (r.empty()) return BigInt();
+            acc *= r[0];
+            acc %= n;
+        }
+        return acc;
+    }
+}
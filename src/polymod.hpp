@@ -0,0 +1,27 @@
+#pragma once
+
+#include "bigint.hpp"
+#include <vector>
+
+/*
+ * Dense polynomials over Z/nZ for the stage 2 continuations.
+ * Coefficients are stored low to high and kept in [0, n).
+ * Multiplication is kronecker substitution: both polynomials are packed into one big integer
+ * each (one fixed-width slot per coefficient), multiplied by a single mpz_mul, and the slots
+ * unpacked again, so large products ride on gmp's FFT multiplication.
+ */
+namespace polymod {
+    using Poly = std::vector<BigInt>;
+
+    // r = a * b mod n (r may alias a or b)
+    void mul(Poly &r, const Poly &a, const Poly &b, const BigInt &n);
+
+    // a mod b for monic b (newton inversion of the reversed divisor)
+    Poly rem_monic(const Poly &a, const Poly &b, const BigInt &n);
+
+    // prod (X - x_i), monic, built with a product tree
+    Poly from_roots(const std::vector<BigInt> &xs, const BigInt &n);
+
+    // prod_i f(x_i) mod n, via the subproduct tree of the x_i and a remainder tree
+    BigInt eval_product(const Poly &f, const std::vector<BigInt> &xs, const BigInt &n);
+}
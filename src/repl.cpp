@@ -1,4 +1,9 @@
 #include "repl.hpp"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -9,10 +14,19 @@
 #include "attacks/lowe.hpp"
 #include "attacks/wiener.hpp"
 #include "attacks/common_modulus.hpp"
+#include "attacks/trial.hpp"
 #include "attacks/fermat.hpp"
+#include "attacks/lehman.hpp"
+#include "attacks/batch_gcd.hpp"
 #include "attacks/rho.hpp"
+#include "attacks/squfof.hpp"
 #include "attacks/coppersmith.hpp"
 #include "attacks/pminus1.hpp"
+#include "attacks/pplus1.hpp"
+#include "attacks/ecm.hpp"
+#include "attacks/siqs.hpp"
+#include "mont_lanes.hpp"
+#include "pipeline.hpp"
 #include "utils/parse.hpp"
 
 static BigInt big_from_parsed(const ParsedNumber &pn) {
@@ -20,6 +34,35 @@ static BigInt big_from_parsed(const ParsedNumber &pn) {
     return BigInt(pn.raw); // hex or dec handled by constructor parse
 }
 
+// ctrl-c while an attack runs trips the attack's StopToken instead of killing the program
+static std::atomic<bool> g_interrupted{false};
+
+static void on_interrupt(int) { g_interrupted.store(true); }
+
+// SIGINT goes to g_interrupted for the lifetime of the scope, the previous handler comes back after
+class InterruptScope {
+public:
+    InterruptScope() {
+        g_interrupted.store(false);
+        prev_ = std::signal(SIGINT, on_interrupt);
+    }
+    ~InterruptScope() { std::signal(SIGINT, prev_); }
+    InterruptScope(const InterruptScope &) = delete;
+    InterruptScope &operator=(const InterruptScope &) = delete;
+
+    utils::StopToken token() const { return utils::StopToken(&g_interrupted); }
+
+private:
+    void (*prev_)(int);
+};
+
+// `metrics` toggles a cost line after every attack
+static bool g_show_metrics = false;
+
+static void print_metrics(const utils::Metrics &m) {
+    if (g_show_metrics) std::cout << "metrics: " << m.format() << "\n";
+}
+
 // simple skeleton repl loop
 int repl_main() {
     SessionState session; // currently empty
@@ -55,6 +98,11 @@ int repl_main() {
             }
             continue;
         }
+        if (line == "metrics") {
+            g_show_metrics = !g_show_metrics;
+            std::cout << "metrics " << (g_show_metrics ? "on" : "off") << "\n";
+            continue;
+        }
         if (line == "show") {
             std::cout << "session items: " << session.size() << " (stub)\n";
             continue;
@@ -117,6 +165,7 @@ int repl_main() {
             } else {
                 std::cout << "low-e failed: " << r.log << "\n";
             }
+            print_metrics(r.metrics);
             continue;
         }
         if (line == "lowe-demo") {
@@ -165,6 +214,7 @@ int repl_main() {
                 } else {
                     std::cout << "wiener failed: " << wr.log << "\n";
                 }
+                print_metrics(wr.metrics);
             } catch (const std::exception &ex) {
                 std::cout << "parse/attack error: " << ex.what() << "\n";
             }
@@ -280,6 +330,7 @@ int repl_main() {
                     std::cout << "common modulus success m=" << res.m.to_hex() << " (dec=" << res.m.
                             to_dec() << ")\n";
                 else std::cout << "common modulus failed: " << res.log << "\n";
+                print_metrics(res.metrics);
             } catch (const std::exception &ex) { std::cout << "error: " << ex.what() << "\n"; }
             continue;
         }
@@ -308,6 +359,74 @@ int repl_main() {
             }
             continue;
         }
+        if (line == "trial") {
+            std::cout << "enter N> ";
+            std::string n_in;
+            std::getline(std::cin, n_in);
+            auto n_p = utils::parse_number_adv(n_in);
+            if (!n_p.known) {
+                std::cout << "bad n\n";
+                continue;
+            }
+            std::cout << "limit (dec, default 1000000)> ";
+            std::string l_in;
+            std::getline(std::cin, l_in);
+            uint64_t limit = 1000000ULL;
+            if (!l_in.empty()) {
+                auto l_p = utils::parse_number_adv(l_in);
+                if (l_p.known && l_p.is_dec) limit = std::stoull(l_p.raw);
+            }
+            TrialResult tr = trial_division(big_from_parsed(n_p), limit);
+            if (tr.success) {
+                std::cout << "trial success: " << tr.log << "\n";
+                std::cout << "cofactor: " << tr.cofactor.to_hex() << "\n";
+            } else {
+                std::cout << "trial failed: " << tr.log << "\n";
+            }
+            print_metrics(tr.metrics);
+            continue;
+        }
+        if (line == "trial-selftest") {
+            // 2^3 * 999983 * 1000003 * (128-bit prime): only the primes <= 1e6 come out
+            BigInt big;
+            mpz_ui_pow_ui(big.raw(), 2, 127);
+            mpz_nextprime(big.raw(), big.raw());
+            BigInt n = BigInt(static_cast<uint64_t>(8 * 999983ULL)) * BigInt(static_cast<uint64_t>(1000003ULL)) * big;
+            TrialResult tr = trial_division(n, 1000000ULL);
+            bool ok = tr.primes == std::vector<uint64_t>{2, 2, 2, 999983} &&
+                      tr.cofactor == BigInt(static_cast<uint64_t>(1000003ULL)) * big;
+            std::cout << (ok ? "trial success: " : "trial failed: ") << tr.log << "\n";
+
+            // random 1024-bit odd numbers, one key at a time vs the remainder tree
+            gmp_randstate_t rs;
+            gmp_randinit_default(rs);
+            gmp_randseed_ui(rs, 42);
+            std::vector<BigInt> ns(4096);
+            for (BigInt &x : ns) {
+                mpz_urandomb(x.raw(), rs, 1024);
+                mpz_setbit(x.raw(), 0);
+            }
+            gmp_randclear(rs);
+            auto t0 = std::chrono::steady_clock::now();
+            std::vector<TrialResult> one_by_one;
+            for (const BigInt &x : ns) one_by_one.push_back(trial_division(x, 1000000ULL));
+            auto t1 = std::chrono::steady_clock::now();
+            std::vector<TrialResult> batch = trial_division_batch(ns, 1000000ULL, 0);
+            auto t2 = std::chrono::steady_clock::now();
+            size_t hits = 0;
+            ok = true;
+            for (size_t i = 0; i < ns.size(); ++i) {
+                hits += batch[i].success;
+                ok = ok && batch[i].primes == one_by_one[i].primes && batch[i].cofactor == one_by_one[i].cofactor;
+            }
+            auto us = [&](auto a, auto b) {
+                return std::chrono::duration_cast<std::chrono::microseconds>(b - a).count() / static_cast<double>(ns.size());
+            };
+            std::cout << (ok ? "trial batch success: " : "trial batch MISMATCH: ") << hits << "/" << ns.size()
+                      << " keys with a prime <= 1e6, " << us(t0, t1) << " us/key single, " << us(t1, t2)
+                      << " us/key batch\n";
+            continue;
+        }
         if (line == "fermat") {
             std::cout << "enter N> ";
             std::string n_in;
@@ -325,12 +444,14 @@ int repl_main() {
                 auto it_p = utils::parse_number_adv(it_in);
                 if (it_p.known && it_p.is_dec) iters = std::stoull(it_p.raw);
             }
-            FermatResult fr = fermat_factor(BigInt(big_from_parsed(n_p)), iters);
+            InterruptScope interrupt;
+            FermatResult fr = fermat_factor(BigInt(big_from_parsed(n_p)), iters, interrupt.token());
             if (fr.success) {
                 std::cout << "fermat success: p=" << fr.p.to_hex() << ", q=" << fr.q.to_hex() << "\n";
             } else {
                 std::cout << "fermat failed: " << fr.log << "\n";
             }
+            print_metrics(fr.metrics);
             continue;
         }
         if (line == "fermat-selftest") {
@@ -346,6 +467,220 @@ int repl_main() {
             }
             continue;
         }
+        if (line == "lehman") {
+            std::cout << "enter N> ";
+            std::string n_in;
+            std::getline(std::cin, n_in);
+            auto n_p = utils::parse_number_adv(n_in);
+            if (!n_p.known) {
+                std::cout << "bad n\n";
+                continue;
+            }
+            std::cout << "mode (hart/lehman, default hart)> ";
+            std::string mode;
+            std::getline(std::cin, mode);
+            if (mode.empty()) mode = "hart";
+            if (mode != "hart" && mode != "lehman") {
+                std::cout << "bad mode\n";
+                continue;
+            }
+            auto read_dec = [](const std::string &prompt, unsigned long long def) {
+                std::cout << prompt;
+                std::string in;
+                std::getline(std::cin, in);
+                if (in.empty()) return def;
+                auto p = utils::parse_number_adv(in);
+                return p.known && p.is_dec ? std::stoull(p.raw) : def;
+            };
+            unsigned long long max_k = read_dec(mode == "hart"
+                                                    ? "max multiplier (dec, default 100000000)> "
+                                                    : "max k (dec, default 10000000)> ",
+                                                mode == "hart" ? 100000000ULL : 10000000ULL);
+            unsigned threads = static_cast<unsigned>(read_dec("threads (dec, 0 = all cores, default 0)> ", 0));
+            unsigned long long budget = read_dec("time budget ms (dec, 0 = none, default 5000)> ", 5000ULL);
+            BigInt n(big_from_parsed(n_p));
+            InterruptScope interrupt;
+            LehmanResult lr = mode == "hart" ? hart_olf(n, max_k, threads, budget, interrupt.token())
+                                             : lehman_factor(n, max_k, 16ULL, threads, budget, interrupt.token());
+            if (lr.success) {
+                std::cout << mode << " success: p=" << lr.p.to_hex() << ", q=" << lr.q.to_hex() << "\n";
+                std::cout << lr.log << "\n";
+            } else {
+                std::cout << mode << " failed: " << lr.log << "\n";
+            }
+            print_metrics(lr.metrics);
+            continue;
+        }
+        if (line == "lehman-selftest") {
+            // q ≈ 5p/3: fermat would need ~n^(1/2)/15 steps, lehman/hart hit at k = 15
+            BigInt p, q;
+            mpz_ui_pow_ui(p.raw(), 2, 160);
+            mpz_nextprime(p.raw(), p.raw());
+            q = p * BigInt(static_cast<uint64_t>(5)) / BigInt(static_cast<uint64_t>(3));
+            mpz_nextprime(q.raw(), q.raw());
+            BigInt n = p * q;
+            for (const char *mode : {"lehman", "hart"}) {
+                LehmanResult lr = std::string(mode) == "hart" ? hart_olf(n, 1000000ULL, 0, 5000ULL)
+                                                              : lehman_factor(n, 1000000ULL, 16ULL, 0, 5000ULL);
+                if (lr.success && lr.p == p && lr.q == q) {
+                    std::cout << mode << " success: " << lr.log << "\n";
+                } else {
+                    std::cout << mode << " failed: " << lr.log << "\n";
+                }
+            }
+            continue;
+        }
+        if (line == "batchgcd") {
+            std::cout << "moduli file (one N per line, dec or 0x hex)> ";
+            std::string path;
+            std::getline(std::cin, path);
+            std::ifstream in(path);
+            if (!in) {
+                std::cout << "cannot open " << path << "\n";
+                continue;
+            }
+            std::vector<BigInt> moduli;
+            std::string n_in;
+            size_t line_no = 0;
+            bool bad = false;
+            while (std::getline(in, n_in)) {
+                ++line_no;
+                auto n_p = utils::parse_number_adv(n_in);
+                if (n_p.raw.empty() || n_p.raw[0] == '#') continue;
+                if (!n_p.known) {
+                    std::cout << "bad n on line " << line_no << "\n";
+                    bad = true;
+                    break;
+                }
+                moduli.push_back(big_from_parsed(n_p));
+            }
+            if (bad) continue;
+            std::cout << "threads (dec, 0 = all cores, default 0)> ";
+            std::string t_in;
+            std::getline(std::cin, t_in);
+            unsigned threads = 0;
+            if (!t_in.empty()) {
+                auto t_p = utils::parse_number_adv(t_in);
+                if (t_p.known && t_p.is_dec) threads = static_cast<unsigned>(std::stoul(t_p.raw));
+            }
+            std::cout << "spill dir (empty = keep the tree in RAM)> ";
+            std::string dir;
+            std::getline(std::cin, dir);
+            InterruptScope interrupt;
+            BatchGcdResult br = batch_gcd(moduli, threads, dir, interrupt.token());
+            for (const BatchGcdHit &h : br.hits) {
+                if (h.p.is_zero()) {
+                    std::cout << "#" << h.index << " n=" << h.n.to_hex() << " duplicate modulus\n";
+                } else {
+                    std::cout << "#" << h.index << " n=" << h.n.to_hex() << " p=" << h.p.to_hex() << " q=" << h.q.to_hex() << "\n";
+                }
+            }
+            std::cout << br.log << "\n";
+            print_metrics(br.metrics);
+            continue;
+        }
+        if (line == "batchgcd-selftest") {
+            // 2000 256-bit moduli from a bad rng: #10/#1500 share a prime, #700 shares one prime
+            // with each of #20 and #21, #1999 is a copy of #3
+            gmp_randstate_t rs;
+            gmp_randinit_default(rs);
+            gmp_randseed_ui(rs, 1234);
+            auto prime = [&] {
+                BigInt x;
+                mpz_urandomb(x.raw(), rs, 128);
+                mpz_setbit(x.raw(), 127);
+                mpz_nextprime(x.raw(), x.raw());
+                return x;
+            };
+            std::vector<BigInt> moduli;
+            for (int i = 0; i < 2000; ++i) moduli.push_back(prime() * prime());
+            BigInt shared = prime(), a = prime(), b = prime();
+            moduli[10] = shared * prime();
+            moduli[1500] = shared * prime();
+            moduli[20] = a * prime();
+            moduli[21] = b * prime();
+            moduli[700] = a * b;
+            moduli[1999] = moduli[3];
+            for (const char *dir : {"", "batchgcd-selftest.tmp"}) {
+                BatchGcdResult br = batch_gcd(moduli, 0, dir);
+                std::vector<size_t> got;
+                bool ok = true;
+                for (const BatchGcdHit &h : br.hits) {
+                    got.push_back(h.index);
+                    ok = ok && (h.p.is_zero() || h.p * h.q == h.n);
+                }
+                ok = ok && got == std::vector<size_t>{3, 10, 20, 21, 700, 1500, 1999};
+                std::cout << (*dir ? "spilled" : "in RAM") << (ok ? " success: " : " failed: ") << br.log << "\n";
+            }
+            std::error_code ec;
+            std::filesystem::remove_all("batchgcd-selftest.tmp", ec);
+            gmp_randclear(rs);
+            continue;
+        }
+        if (line == "squfof") {
+            std::cout << "enter N (up to 62 bits)> ";
+            std::string n_in;
+            std::getline(std::cin, n_in);
+            auto n_p = utils::parse_number_adv(n_in);
+            if (!n_p.known) {
+                std::cout << "bad n\n";
+                continue;
+            }
+            SqufofResult sr = squfof_factor(big_from_parsed(n_p));
+            if (sr.success) {
+                std::cout << "squfof factor: " << sr.factor.to_dec() << "\n";
+            } else {
+                std::cout << "squfof failed: " << sr.log << "\n";
+            }
+            print_metrics(sr.metrics);
+            continue;
+        }
+        if (line == "squfof-selftest") {
+            // random cofactors at each size; rho_attack picks squfof / u64 / u128 on its own
+            gmp_randstate_t rs;
+            gmp_randinit_default(rs);
+            gmp_randseed_ui(rs, 7);
+            auto prime = [&](unsigned bits) {
+                BigInt p;
+                mpz_urandomb(p.raw(), rs, bits);
+                mpz_setbit(p.raw(), bits - 1);
+                mpz_nextprime(p.raw(), p.raw());
+                return p;
+            };
+            struct Size { unsigned p_bits, q_bits; };
+            for (Size sz : {Size{20, 20}, Size{30, 30}, Size{32, 32}, Size{24, 72}, Size{30, 90}}) {
+                constexpr int kKeys = 200;
+                std::vector<BigInt> ns;
+                for (int i = 0; i < kKeys; ++i) ns.push_back(prime(sz.p_bits) * prime(sz.q_bits));
+                bool ok = true;
+                auto t0 = std::chrono::steady_clock::now();
+                std::string last;
+                for (const BigInt &n : ns) {
+                    RhoResult r = rho_attack(n, 10000000ULL);
+                    ok = ok && r.success && r.factor != n && (n % r.factor).is_zero();
+                    last = r.log;
+                }
+                auto t1 = std::chrono::steady_clock::now();
+                int squfof_hits = 0;
+                if (sz.p_bits + sz.q_bits <= kSqufofMaxBits) {
+                    for (const BigInt &n : ns) {
+                        SqufofResult sr = squfof_factor(n);
+                        squfof_hits += sr.success && (n % sr.factor).is_zero();
+                    }
+                }
+                auto t2 = std::chrono::steady_clock::now();
+                auto us = [&](auto a, auto b) {
+                    return std::chrono::duration_cast<std::chrono::microseconds>(b - a).count() / static_cast<double>(kKeys);
+                };
+                std::cout << sz.p_bits + sz.q_bits << "-bit n (" << sz.p_bits << "-bit p): rho "
+                          << (ok ? "ok, " : "FAILED, ") << us(t0, t1) << " us/key, e.g. " << last << "\n";
+                if (sz.p_bits + sz.q_bits <= kSqufofMaxBits) {
+                    std::cout << "  squfof " << squfof_hits << "/" << kKeys << ", " << us(t1, t2) << " us/key\n";
+                }
+            }
+            gmp_randclear(rs);
+            continue;
+        }
         if (line == "rho") {
             std::cout << "enter N> ";
             std::string n_in;
@@ -363,19 +698,84 @@ int repl_main() {
                 auto it_p = utils::parse_number_adv(it_in);
                 if (it_p.known && it_p.is_dec) iters = std::stoull(it_p.raw);
             }
+            std::cout << "gcd batch (dec, default 128)> ";
+            std::string b_in;
+            std::getline(std::cin, b_in);
+            unsigned long long batch = 128ULL;
+            if (!b_in.empty()) {
+                auto b_p = utils::parse_number_adv(b_in);
+                if (b_p.known && b_p.is_dec) batch = std::stoull(b_p.raw);
+            }
+            std::cout << "threads (dec, 1 = sequential, 0 = all cores, default 1)> ";
+            std::string t_in;
+            std::getline(std::cin, t_in);
+            unsigned threads = 1;
+            if (!t_in.empty()) {
+                auto t_p = utils::parse_number_adv(t_in);
+                if (t_p.known && t_p.is_dec) threads = static_cast<unsigned>(std::stoul(t_p.raw));
+            }
+            uint64_t seed = 1;
+            RhoBackend backend = RhoBackend::Gmp;
+            if (threads == 1) {
+                std::cout << "backend (gmp/simd, default gmp)> ";
+                std::string be_in;
+                std::getline(std::cin, be_in);
+                if (be_in == "simd") backend = RhoBackend::Lanes;
+            } else {
+                std::cout << "seed (dec, default 1)> ";
+                std::string s_in;
+                std::getline(std::cin, s_in);
+                if (!s_in.empty()) {
+                    auto s_p = utils::parse_number_adv(s_in);
+                    if (s_p.known && s_p.is_dec) seed = std::stoull(s_p.raw);
+                }
+            }
             try {
                 BigInt n = big_from_parsed(n_parsed);
-                RhoResult r = rho_attack(n, iters);
+                InterruptScope interrupt;
+                RhoResult r = threads == 1 ? rho_attack(n, iters, batch, backend, interrupt.token())
+                                           : rho_attack_parallel(n, threads, seed, iters, batch, interrupt.token());
                 if (r.success) {
                     std::cout << "rho factor: " << r.factor.to_dec() << " (" << r.factor.to_hex() << ")\n";
                 } else {
                     std::cout << "rho failed: " << r.log << "\n";
                 }
+                print_metrics(r.metrics);
             } catch (const std::exception &ex) {
                 std::cout << "parse error: " << ex.what() << "\n";
             }
             continue;
         }
+        if (line == "simd-selftest") {
+            // check every montgomery lane kernel this cpu supports against plain BigInt arithmetic
+            BigInt n("0xd4f9a3b2c1e0ff17c2b6a1e39d8f7c6b5a4f3e2d1c0b9a8f7e6d5c4b3a29181f");
+            BigInt x("0x1234567890abcdef1234567890abcdef1234567890abcdef");
+            BigInt c(static_cast<uint64_t>(7));
+            for (mont::Backend b: {mont::Backend::Scalar, mont::Backend::Avx2, mont::Backend::Avx512Ifma}) {
+                if (!mont::backend_supported(b)) {
+                    std::cout << mont::backend_name(b) << ": not supported on this cpu\n";
+                    continue;
+                }
+                mont::LaneContext ctx(n, b);
+                mont::LaneReg y = ctx.reg(), cr = ctx.reg();
+                BigInt expect[mont::kLanes];
+                for (unsigned lane = 0; lane < mont::kLanes; ++lane) {
+                    expect[lane] = x + BigInt(static_cast<uint64_t>(lane));
+                    ctx.set(y, lane, expect[lane]);
+                }
+                ctx.fill(cr, c);
+                for (int i = 0; i < 1000; ++i) {
+                    ctx.sqr(y, y);
+                    ctx.add(y, y, cr);
+                    for (auto &e: expect) e = (e * e + c) % n;
+                }
+                bool ok = true;
+                for (unsigned lane = 0; lane < mont::kLanes; ++lane) ok = ok && ctx.get(y, lane) == expect[lane];
+                std::cout << mont::backend_name(b) << ": " << (ok ? "ok" : "MISMATCH") << "\n";
+            }
+            std::cout << "rho simd backend would use: " << mont::backend_name(mont::best_backend()) << "\n";
+            continue;
+        }
         if (line == "coppersmith") {
             std::cout << "enter type (1=linear, 2=partial-msg)> ";
             std::string type_in;
@@ -417,12 +817,14 @@ int repl_main() {
                     BigInt a = big_from_parsed(a_p);
                     BigInt b = big_from_parsed(b_p);
                     BigInt n = big_from_parsed(n_p);
-                    auto res = coppersmith_univariate_linear(a, b, n);
+                    InterruptScope interrupt;
+                    auto res = coppersmith_univariate_linear(a, b, n, 0.5, 0.01, interrupt.token());
                     if (res.success) {
                         std::cout << "coppersmith success: x=" << res.root.to_hex() << " (dec=" << res.root.to_dec() << ")\n";
                     } else {
                         std::cout << "coppersmith failed: " << res.log << "\n";
                     }
+                    print_metrics(res.metrics);
                 } catch (const std::exception &ex) {
                     std::cout << "error: " << ex.what() << "\n";
                 }
@@ -475,12 +877,14 @@ int repl_main() {
                     BigInt m_high = big_from_parsed(mh_p);
                     size_t unknown_bits = static_cast<size_t>(std::stoull(ub_p.raw, nullptr, ub_p.is_dec ? 10 : 16));
 
-                    auto res = coppersmith_small_e_partial_msg(c, e, n, m_high, unknown_bits);
+                    InterruptScope interrupt;
+                    auto res = coppersmith_small_e_partial_msg(c, e, n, m_high, unknown_bits, interrupt.token());
                     if (res.success) {
                         std::cout << "coppersmith success: full_message=" << res.root.to_hex() << " (dec=" << res.root.to_dec() << ")\n";
                     } else {
                         std::cout << "coppersmith failed: " << res.log << "\n";
                     }
+                    print_metrics(res.metrics);
                 } catch (const std::exception &ex) {
                     std::cout << "error: " << ex.what() << "\n";
                 }
@@ -558,14 +962,23 @@ int repl_main() {
             if(!t_in.empty()) {
                 auto t_p = utils::parse_number_adv(t_in);
                 if(t_p.known && t_p.is_dec) trials = std::stoull(t_p.raw); }
+            PMinus1Stage2 stage2 = PMinus1Stage2::Auto;
+            if (B2 > B1) {
+                std::cout << "stage2 (auto/bsgs/poly, default auto)> ";
+                std::string s2_in; std::getline(std::cin, s2_in);
+                if (s2_in == "bsgs") stage2 = PMinus1Stage2::Bsgs;
+                else if (s2_in == "poly") stage2 = PMinus1Stage2::Poly;
+            }
             try {
                 BigInt n = big_from_parsed(n_p);
-                PMinus1Result pr = pollards_pminus1(n, B1, trials, B2);
+                InterruptScope interrupt;
+                PMinus1Result pr = pollards_pminus1(n, B1, trials, B2, stage2, interrupt.token());
                 if(pr.success) {
                     std::cout << "p-1 factor: " << pr.factor.to_dec() << " (" << pr.factor.to_hex() << ")\n";
                 } else {
                     std::cout << "p-1 failed: " << pr.log << "\n";
                 }
+                print_metrics(pr.metrics);
             } catch(const std::exception &ex) { std::cout << "error: " << ex.what() << "\n"; }
             continue;
         }
@@ -584,6 +997,237 @@ int repl_main() {
             }
             continue;
         }
+        if (line == "pplus1") {
+            std::cout << "enter N> ";
+            std::string n_in;
+            std::getline(std::cin, n_in);
+            auto n_p = utils::parse_number_adv(n_in);
+            if (!n_p.known) {
+                std::cout << "bad n\n";
+                continue;
+            }
+            auto read_dec = [](const std::string &prompt, unsigned long long def) {
+                std::cout << prompt;
+                std::string in;
+                std::getline(std::cin, in);
+                if (in.empty()) return def;
+                auto p = utils::parse_number_adv(in);
+                return p.known && p.is_dec ? std::stoull(p.raw) : def;
+            };
+            unsigned long long B1 = read_dec("enter B1 (stage1 bound, dec default 100000)> ", 100000ULL);
+            unsigned long long B2 = read_dec("enter B2 (stage2 bound, dec; 0 to disable, default 0)> ", 0ULL);
+            unsigned long long seeds = read_dec("enter seeds (dec default 3, max 9)> ", 3ULL);
+            smooth::Stage2Mode stage2 = smooth::Stage2Mode::Auto;
+            if (B2 > B1) {
+                std::cout << "stage2 (auto/bsgs/poly, default auto)> ";
+                std::string s2_in;
+                std::getline(std::cin, s2_in);
+                if (s2_in == "bsgs") stage2 = smooth::Stage2Mode::Bsgs;
+                else if (s2_in == "poly") stage2 = smooth::Stage2Mode::Poly;
+            }
+            InterruptScope interrupt;
+            PPlus1Result pr = williams_pplus1(big_from_parsed(n_p), B1, seeds, B2, stage2, interrupt.token());
+            if (pr.success) {
+                std::cout << "p+1 factor: " << pr.factor.to_dec() << " (" << pr.factor.to_hex() << ")\n";
+                std::cout << pr.log << "\n";
+            } else {
+                std::cout << "p+1 failed: " << pr.log << "\n";
+            }
+            print_metrics(pr.metrics);
+            continue;
+        }
+        if (line == "pplus1-selftest") {
+            // p+1 = 2^2 * 137 * 239 * 317 * 727 * 743 * 773 * 877 * 947 * 50021, p-1 has a 48-bit prime
+            BigInt p("720182198544615073477468627");
+            BigInt q;
+            mpz_ui_pow_ui(q.raw(), 2, 100);
+            mpz_nextprime(q.raw(), q.raw());
+            BigInt n = p * q;
+            PMinus1Result mr = pollards_pminus1(n, 1000ULL, 5ULL, 100000ULL);
+            PPlus1Result pr = williams_pplus1(n, 1000ULL, 3ULL, 100000ULL);
+            std::cout << "p-1 (expected to fail): " << (mr.success ? "factor " + mr.factor.to_dec() : mr.log) << "\n";
+            if (pr.success && pr.factor == p) {
+                std::cout << "p+1 success: " << pr.log << "\n";
+            } else {
+                std::cout << "p+1 selftest failed: " << pr.log << "\n";
+            }
+            continue;
+        }
+        if (line == "ecm") {
+            std::cout << "enter N> ";
+            std::string n_in;
+            std::getline(std::cin, n_in);
+            auto n_p = utils::parse_number_adv(n_in);
+            if (!n_p.known) {
+                std::cout << "bad n\n";
+                continue;
+            }
+            auto read_dec = [](const std::string &prompt, unsigned long long def) {
+                std::cout << prompt;
+                std::string in;
+                std::getline(std::cin, in);
+                if (in.empty()) return def;
+                auto p = utils::parse_number_adv(in);
+                return p.known && p.is_dec ? std::stoull(p.raw) : def;
+            };
+            unsigned long long B1 = read_dec("B1 (dec, default 50000)> ", 50000ULL);
+            unsigned long long B2 = read_dec("B2 (dec, 0 = 100 * B1, default 0)> ", 0ULL);
+            unsigned long long curves = read_dec("curves (dec, default 200)> ", 200ULL);
+            unsigned threads = static_cast<unsigned>(read_dec("threads (dec, 0 = all cores, default 0)> ", 0ULL));
+            uint64_t seed = read_dec("seed (dec, default 1)> ", 1ULL);
+            InterruptScope interrupt;
+            EcmResult er = ecm_factor(big_from_parsed(n_p), B1, B2, curves, threads, seed, interrupt.token());
+            if (er.success) {
+                std::cout << "ecm factor: " << er.factor.to_dec() << " (" << er.factor.to_hex() << ")\n";
+                std::cout << er.log << "\n";
+            } else {
+                std::cout << "ecm failed: " << er.log << "\n";
+            }
+            print_metrics(er.metrics);
+            continue;
+        }
+        if (line == "ecm-selftest") {
+            // 16-digit prime times a 200-bit prime: a few dozen curves at B1 = 2000
+            BigInt p, q;
+            mpz_ui_pow_ui(p.raw(), 10, 15);
+            mpz_nextprime(p.raw(), p.raw());
+            mpz_ui_pow_ui(q.raw(), 2, 200);
+            mpz_nextprime(q.raw(), q.raw());
+            EcmResult er = ecm_factor(p * q, 2000ULL, 0ULL, 1000ULL, 0, 1);
+            if (er.success && er.factor == p) {
+                std::cout << "ecm success: " << er.log << "\n";
+            } else {
+                std::cout << "ecm selftest failed: " << er.log << "\n";
+            }
+            continue;
+        }
+        if (line == "siqs") {
+            std::cout << "enter N> ";
+            std::string n_in;
+            std::getline(std::cin, n_in);
+            auto n_p = utils::parse_number_adv(n_in);
+            if (!n_p.known) {
+                std::cout << "bad n\n";
+                continue;
+            }
+            auto read_dec = [](const std::string &prompt, unsigned long long def) {
+                std::cout << prompt;
+                std::string in;
+                std::getline(std::cin, in);
+                if (in.empty()) return def;
+                auto p = utils::parse_number_adv(in);
+                return p.known && p.is_dec ? std::stoull(p.raw) : def;
+            };
+            unsigned threads = static_cast<unsigned>(read_dec("threads (dec, 0 = all cores, default 0)> ", 0ULL));
+            uint64_t seed = read_dec("seed (dec, default 1)> ", 1ULL);
+            BigInt n = big_from_parsed(n_p);
+            InterruptScope interrupt;
+            SiqsResult sr = siqs_factor(n, threads, seed, interrupt.token());
+            if (sr.success) {
+                std::cout << "siqs factor: " << sr.factor.to_dec() << " * " << (n / sr.factor).to_dec() << "\n";
+                std::cout << sr.log << "\n";
+            } else {
+                std::cout << "siqs failed: " << sr.log << "\n";
+            }
+            print_metrics(sr.metrics);
+            continue;
+        }
+        if (line == "siqs-selftest") {
+            // 50 digit semiprime with nothing special about p or q
+            BigInt p, q;
+            mpz_ui_pow_ui(p.raw(), 10, 24);
+            mpz_mul_ui(p.raw(), p.raw(), 3);
+            mpz_nextprime(p.raw(), p.raw());
+            mpz_ui_pow_ui(q.raw(), 10, 25);
+            mpz_mul_ui(q.raw(), q.raw(), 7);
+            mpz_nextprime(q.raw(), q.raw());
+            SiqsResult sr = siqs_factor(p * q, 0, 1);
+            if (sr.success && (sr.factor == p || sr.factor == q)) {
+                std::cout << "siqs success: " << sr.log << "\n";
+            } else {
+                std::cout << "siqs selftest failed: " << sr.log << "\n";
+            }
+            continue;
+        }
+        if (line == "auto") {
+            std::cout << "enter N> ";
+            std::string n_in;
+            std::getline(std::cin, n_in);
+            auto n_p = utils::parse_number_adv(n_in);
+            if (!n_p.known) {
+                std::cout << "bad n\n";
+                continue;
+            }
+            pipeline::Options opt;
+            std::cout << "e (optional, enables wiener and d)> ";
+            std::string e_in;
+            std::getline(std::cin, e_in);
+            auto e_p = utils::parse_number_adv(e_in);
+            if (e_p.known) opt.e = big_from_parsed(e_p);
+            std::cout << "related moduli / known factors (comma separated, optional)> ";
+            std::string rel_in;
+            std::getline(std::cin, rel_in);
+            std::stringstream rel_ss(rel_in);
+            for (std::string item; std::getline(rel_ss, item, ',');) {
+                auto r_p = utils::parse_number_adv(item);
+                if (r_p.known) opt.related.push_back(big_from_parsed(r_p));
+            }
+            auto read_dec = [](const std::string &prompt, unsigned long long def) {
+                std::cout << prompt;
+                std::string in;
+                std::getline(std::cin, in);
+                if (in.empty()) return def;
+                auto p = utils::parse_number_adv(in);
+                return p.known && p.is_dec ? std::stoull(p.raw) : def;
+            };
+            opt.threads = static_cast<unsigned>(read_dec("threads (dec, 0 = all cores, default 0)> ", 0ULL));
+            opt.cheap_ms = read_dec("cheap stage budget ms (dec, default 2000)> ", opt.cheap_ms);
+            unsigned long long heavy = read_dec("expensive stage budget ms (dec, 0 = per-stage defaults)> ", 0ULL);
+            if (heavy) opt.rho_ms = opt.pminus1_ms = opt.ecm_ms = opt.siqs_ms = heavy;
+            BigInt n = big_from_parsed(n_p);
+            InterruptScope interrupt;
+            pipeline::Result pr = pipeline::auto_factor(n, opt, interrupt.token());
+            std::cout << pipeline::format_report(pr, g_show_metrics);
+            if (pr.success) {
+                std::cout << "p = " << pr.p.to_hex() << " (" << pr.p.to_dec() << ")\n";
+                std::cout << "q = " << pr.q.to_hex() << " (" << pr.q.to_dec() << ")\n";
+                if (!pr.d.is_zero()) std::cout << "d = " << pr.d.to_hex() << " (" << pr.d.to_dec() << ")\n";
+            }
+            continue;
+        }
+        if (line == "auto-selftest") {
+            // three keys, each with one weakness a different stage is built for
+            auto next_prime = [](const BigInt &x) {
+                BigInt r;
+                mpz_nextprime(r.raw(), x.raw());
+                return r;
+            };
+            BigInt big;
+            mpz_ui_pow_ui(big.raw(), 2, 256);
+            BigInt p1 = next_prime(big), gap;
+            mpz_ui_pow_ui(gap.raw(), 2, 100);
+            BigInt q1 = next_prime(p1 + gap); // close primes: fermat
+            BigInt p2 = next_prime(BigInt(static_cast<uint64_t>(1000000000039ULL))); // 40-bit p: rho / ecm
+            BigInt q2 = next_prime(big + big);
+            BigInt p3("635905897405540198649441278823"); // p-1 is 8231-smooth
+            BigInt q3 = next_prime(big + gap + gap);
+            struct Case {
+                BigInt n, p;
+            };
+            Case cases[] = {{p1 * q1, p1}, {p2 * q2, p2}, {p3 * q3, p3}};
+            pipeline::Options opt;
+            opt.cheap_ms = 1000;
+            opt.rho_ms = opt.pminus1_ms = opt.ecm_ms = opt.siqs_ms = 10000;
+            bool ok = true;
+            for (const Case &c : cases) {
+                pipeline::Result pr = pipeline::auto_factor(c.n, opt);
+                bool hit = pr.success && (pr.p == c.p || pr.q == c.p);
+                ok = ok && hit;
+                std::cout << (hit ? "  ok: " : "  FAILED: ") << pr.log << "\n";
+            }
+            std::cout << (ok ? "auto success\n" : "auto selftest failed\n");
+            continue;
+        }
     }
     return 0;
 }
@@ -0,0 +1,264 @@
+#include "json.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+
+namespace utils::json {
+    namespace {
+        class Parser {
+        public:
+            explicit Parser(const std::string &s) : s_(s) {}
+
+            std::optional<Object> object(std::string &err) {
+                Object obj;
+                ws();
+                if (!eat('{')) return fail(err, "expected '{'");
+                ws();
+                if (eat('}')) return finish(obj, err);
+                for (;;) {
+                    ws();
+                    std::string key;
+                    if (!string(key)) return fail(err, "expected a string key");
+                    ws();
+                    if (!eat(':')) return fail(err, "expected ':'");
+                    ws();
+                    Value v;
+                    if (!value(v, true)) return fail(err, "bad value for \"" + key + "\"");
+                    obj[key] = std::move(v);
+                    ws();
+                    if (eat(',')) continue;
+                    if (eat('}')) return finish(obj, err);
+                    return fail(err, "expected ',' or '}'");
+                }
+            }
+
+        private:
+            std::optional<Object> finish(Object &obj, std::string &err) {
+                ws();
+                if (i_ != s_.size()) return fail(err, "trailing characters");
+                return std::move(obj);
+            }
+
+            std::optional<Object> fail(std::string &err, const std::string &what) {
+                err = what + " at column " + std::to_string(i_ + 1);
+                return std::nullopt;
+            }
+
+            void ws() {
+                while (i_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[i_]))) ++i_;
+            }
+
+            bool eat(char c) {
+                if (i_ < s_.size() && s_[i_] == c) {
+                    ++i_;
+                    return true;
+                }
+                return false;
+            }
+
+            bool word(const char *w) {
+                size_t n = std::char_traits<char>::length(w);
+                if (s_.compare(i_, n, w) != 0) return false;
+                i_ += n;
+                return true;
+            }
+
+            static void utf8(std::string &out, unsigned cp) {
+                if (cp < 0x80) {
+                    out += static_cast<char>(cp);
+                } else if (cp < 0x800) {
+                    out += static_cast<char>(0xc0 | (cp >> 6));
+                    out += static_cast<char>(0x80 | (cp & 0x3f));
+                } else {
+                    out += static_cast<char>(0xe0 | (cp >> 12));
+                    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+                    out += static_cast<char>(0x80 | (cp & 0x3f));
+                }
+            }
+
+            bool string(std::string &out) {
+                if (!eat('"')) return false;
+                while (i_ < s_.size()) {
+                    char c = s_[i_++];
+                    if (c == '"') return true;
+                    if (c != '\\') {
+                        out += c;
+                        continue;
+                    }
+                    if (i_ >= s_.size()) return false;
+                    switch (s_[i_++]) {
+                        case '"': out += '"'; break;
+                        case '\\': out += '\\'; break;
+                        case '/': out += '/'; break;
+                        case 'b': out += '\b'; break;
+                        case 'f': out += '\f'; break;
+                        case 'n': out += '\n'; break;
+                        case 'r': out += '\r'; break;
+                        case 't': out += '\t'; break;
+                        case 'u': {
+                            // surrogate pairs are not joined; job files are ascii in practice
+                            if (i_ + 4 > s_.size()) return false;
+                            unsigned cp = 0;
+                            for (int k = 0; k < 4; ++k) {
+                                char h = s_[i_++];
+                                if (!std::isxdigit(static_cast<unsigned char>(h))) return false;
+                                cp = cp * 16 + static_cast<unsigned>(std::isdigit(static_cast<unsigned char>(h))
+                                                                         ? h - '0'
+                                                                         : std::tolower(h) - 'a' + 10);
+                            }
+                            utf8(out, cp);
+                            break;
+                        }
+                        default: return false;
+                    }
+                }
+                return false;
+            }
+
+            bool number(std::string &out) {
+                size_t a = i_;
+                eat('-');
+                size_t digits = i_;
+                while (i_ < s_.size() && std::isdigit(static_cast<unsigned char>(s_[i_]))) ++i_;
+                if (i_ == digits) return false;
+                if (eat('.')) {
+                    size_t frac = i_;
+                    while (i_ < s_.size() && std::isdigit(static_cast<unsigned char>(s_[i_]))) ++i_;
+                    if (i_ == frac) return false;
+                }
+                if (eat('e') || eat('E')) {
+                    if (!eat('+')) eat('-');
+                    size_t exp = i_;
+                    while (i_ < s_.size() && std::isdigit(static_cast<unsigned char>(s_[i_]))) ++i_;
+                    if (i_ == exp) return false;
+                }
+                out = s_.substr(a, i_ - a);
+                return true;
+            }
+
+            bool value(Value &v, bool allow_array) {
+                if (i_ >= s_.size()) return false;
+                char c = s_[i_];
+                if (c == '"') {
+                    v.kind = Value::Kind::String;
+                    return string(v.text);
+                }
+                if (c == '-' || std::isdigit(static_cast<unsigned char>(c))) {
+                    v.kind = Value::Kind::Number;
+                    return number(v.text);
+                }
+                for (const char *b : {"true", "false"}) {
+                    if (word(b)) {
+                        v.kind = Value::Kind::Bool;
+                        v.text = b;
+                        return true;
+                    }
+                }
+                if (word("null")) {
+                    v.kind = Value::Kind::Null;
+                    return true;
+                }
+                if (allow_array && eat('[')) {
+                    v.kind = Value::Kind::Array;
+                    ws();
+                    if (eat(']')) return true;
+                    for (;;) {
+                        ws();
+                        Value item;
+                        if (!value(item, false)) return false;
+                        v.items.push_back(std::move(item));
+                        ws();
+                        if (eat(',')) continue;
+                        return eat(']');
+                    }
+                }
+                return false;
+            }
+
+            const std::string &s_;
+            size_t i_{0};
+        };
+    }
+
+    std::optional<Object> parse_object(const std::string &line, std::string &err) {
+        return Parser(line).object(err);
+    }
+
+    std::string quote(const std::string &s) {
+        std::string out = "\"";
+        for (char c : s) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char buf[8];
+                        std::snprintf(buf, sizeof buf, "\\u%04x", static_cast<unsigned>(c));
+                        out += buf;
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        return out + "\"";
+    }
+
+    std::string dump(const Value &v) {
+        switch (v.kind) {
+            case Value::Kind::String: return quote(v.text);
+            case Value::Kind::Number:
+            case Value::Kind::Bool: return v.text;
+            case Value::Kind::Null: return "null";
+            case Value::Kind::Array: {
+                std::string out = "[";
+                for (size_t i = 0; i < v.items.size(); ++i) out += (i ? "," : "") + dump(v.items[i]);
+                return out + "]";
+            }
+        }
+        return "null";
+    }
+
+    void Writer::key(const std::string &k) {
+        if (!body_.empty()) body_ += ',';
+        body_ += quote(k) + ':';
+    }
+
+    Writer &Writer::field(const std::string &k, const std::string &s) {
+        key(k);
+        body_ += quote(s);
+        return *this;
+    }
+
+    Writer &Writer::field(const std::string &k, bool b) {
+        key(k);
+        body_ += b ? "true" : "false";
+        return *this;
+    }
+
+    Writer &Writer::field(const std::string &k, double x) {
+        key(k);
+        if (!std::isfinite(x)) {
+            body_ += "null";
+            return *this;
+        }
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "%.6g", x);
+        body_ += buf;
+        return *this;
+    }
+
+    Writer &Writer::field(const std::string &k, unsigned long long x) {
+        key(k);
+        body_ += std::to_string(x);
+        return *this;
+    }
+
+    Writer &Writer::raw(const std::string &k, const std::string &json) {
+        key(k);
+        body_ += json;
+        return *this;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace utils::json {
+    /*
+     * Just enough JSON for one-record-per-line job files: a flat object whose values are
+     * strings, numbers, booleans, null or arrays of those. Nested objects are rejected.
+     * Numbers keep their source text, so a 2048-bit modulus written as a bare number survives
+     * without going through a double.
+     */
+    struct Value {
+        enum class Kind { String, Number, Bool, Null, Array };
+        Kind kind{Kind::Null};
+        std::string text;         // string contents, number text, "true" / "false"
+        std::vector<Value> items; // Array only
+    };
+
+    using Object = std::map<std::string, Value>;
+
+    // nullopt on malformed input, `err` says where
+    std::optional<Object> parse_object(const std::string &line, std::string &err);
+
+    // s as a quoted JSON string literal
+    std::string quote(const std::string &s);
+
+    // back to JSON text (numbers verbatim, strings re-quoted)
+    std::string dump(const Value &v);
+
+    /*
+     * Builds one object left to right: w.field("p", hex).field("seconds", 0.25).str().
+     * Keys are emitted in call order, no duplicate check.
+     */
+    class Writer {
+    public:
+        Writer &field(const std::string &key, const std::string &s);
+        Writer &field(const std::string &key, const char *s) { return field(key, std::string(s)); }
+        Writer &field(const std::string &key, bool b);
+        Writer &field(const std::string &key, double x);
+        Writer &field(const std::string &key, unsigned long long x);
+        Writer &raw(const std::string &key, const std::string &json); // already encoded value
+
+        std::string str() const { return "{" + body_ + "}"; }
+
+    private:
+        void key(const std::string &k);
+
+        std::string body_;
+    };
+}
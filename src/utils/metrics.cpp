@@ -0,0 +1,100 @@
+#include "metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <gmp.h>
+#include <sys/resource.h>
+#include "json.hpp"
+
+namespace utils {
+    namespace {
+        std::atomic<uint64_t> g_gmp_allocs{0};
+
+        // gmp's defaults are malloc / realloc / free too, so blocks from before the switch free fine
+        void *count_alloc(size_t n) {
+            g_gmp_allocs.fetch_add(1, std::memory_order_relaxed);
+            void *p = std::malloc(n);
+            if (!p) std::abort();
+            return p;
+        }
+
+        void *count_realloc(void *p, size_t, size_t n) {
+            g_gmp_allocs.fetch_add(1, std::memory_order_relaxed);
+            void *q = std::realloc(p, n);
+            if (!q) std::abort();
+            return q;
+        }
+
+        void count_free(void *p, size_t) { std::free(p); }
+
+        // installed during static initialisation, before any attack thread exists
+        const bool g_installed = [] {
+            mp_set_memory_functions(count_alloc, count_realloc, count_free);
+            return true;
+        }();
+
+        double wall_now() {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        double cpu_now() { return static_cast<double>(std::clock()) / CLOCKS_PER_SEC; }
+
+        uint64_t peak_rss_kb() {
+            rusage ru{};
+            if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef __APPLE__
+            return static_cast<uint64_t>(ru.ru_maxrss) / 1024; // bytes there
+#else
+            return static_cast<uint64_t>(ru.ru_maxrss);
+#endif
+        }
+    }
+
+    Metrics &Metrics::operator+=(const Metrics &o) {
+        iterations += o.iterations;
+        modmuls += o.modmuls;
+        gcds += o.gcds;
+        powms += o.powms;
+        allocations += o.allocations;
+        return *this;
+    }
+
+    std::string Metrics::format() const {
+        char buf[256];
+        std::snprintf(buf, sizeof buf,
+                      "%llu %s, %llu modmul, %llu gcd, %llu powm, %llu alloc, wall %.3fs, cpu %.3fs, peak %.1f MB",
+                      static_cast<unsigned long long>(iterations), unit, static_cast<unsigned long long>(modmuls),
+                      static_cast<unsigned long long>(gcds), static_cast<unsigned long long>(powms),
+                      static_cast<unsigned long long>(allocations), wall_s, cpu_s,
+                      static_cast<double>(peak_rss_kb) / 1024.0);
+        return buf;
+    }
+
+    std::string Metrics::json() const {
+        return json::Writer()
+            .field("unit", unit)
+            .field("iterations", static_cast<unsigned long long>(iterations))
+            .field("modmuls", static_cast<unsigned long long>(modmuls))
+            .field("gcds", static_cast<unsigned long long>(gcds))
+            .field("powms", static_cast<unsigned long long>(powms))
+            .field("allocations", static_cast<unsigned long long>(allocations))
+            .field("wall_s", wall_s)
+            .field("cpu_s", cpu_s)
+            .field("peak_rss_kb", static_cast<unsigned long long>(peak_rss_kb))
+            .str();
+    }
+
+    MetricsClock::MetricsClock()
+        : wall0_(wall_now()), cpu0_(cpu_now()), allocs0_(g_gmp_allocs.load(std::memory_order_relaxed)) {
+        (void)g_installed;
+    }
+
+    void MetricsClock::stamp(Metrics &m) const {
+        m.wall_s = wall_now() - wall0_;
+        m.cpu_s = cpu_now() - cpu0_;
+        m.allocations = g_gmp_allocs.load(std::memory_order_relaxed) - allocs0_;
+        m.peak_rss_kb = peak_rss_kb();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace utils {
+    /*
+     * What one attack call cost, attached to every result as `metrics`.
+     * The counters are filled by the attack at block granularity (a gcd block adds its batch of
+     * multiplies at once), so they cost nothing measurable in the hot loops. What an "iteration"
+     * is depends on the attack and is named in `unit` (rho steps, fermat a values, ecm curves, ...).
+     * 0 means "not counted by this attack", not "none happened", for every counter but iterations.
+     *
+     * wall / cpu / allocations / peak memory are taken around the call by measure():
+     *  - cpu is process CPU time, so it adds up every worker thread of the attack (cpu > wall
+     *    means it ran in parallel) and, inside the auto pipeline, the stages running next to it
+     *  - allocations counts gmp limb (re)allocations process-wide over the call
+     *  - peak_rss_kb is the process high-water mark when the call returned
+     */
+    struct Metrics {
+        const char *unit{"iterations"};
+        uint64_t iterations{0};
+        uint64_t modmuls{0};
+        uint64_t gcds{0};
+        uint64_t powms{0};
+        uint64_t allocations{0};
+        double wall_s{0};
+        double cpu_s{0};
+        uint64_t peak_rss_kb{0};
+
+        // counters only; unit, times and memory stay as they are
+        Metrics &operator+=(const Metrics &o);
+
+        // "1234 steps, 1.2e6 modmul, 10 gcd, 0 powm, 56 alloc, wall 0.012s, cpu 0.011s, peak 5.1 MB"
+        std::string format() const;
+        // flat JSON object with the same fields
+        std::string json() const;
+    };
+
+    /*
+     * Wall clock, process CPU time and the gmp allocation count at construction;
+     * stamp(m) writes the differences (and the current peak RSS) into m.
+     */
+    class MetricsClock {
+    public:
+        MetricsClock();
+        void stamp(Metrics &m) const;
+
+    private:
+        double wall0_, cpu0_;
+        uint64_t allocs0_;
+    };
+
+    // runs f() and stamps the Metrics of the result it returns: `return measure([&] { ... });`
+    template <class F>
+    auto measure(F &&f) {
+        MetricsClock clock;
+        auto r = f();
+        clock.stamp(r.metrics);
+        return r;
+    }
+}
@@ -0,0 +1,65 @@
+#include "primes.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace utils {
+    namespace {
+        constexpr size_t kSegmentBytes = 1 << 15; // one byte per odd number, fits L1
+
+        uint64_t isqrt(uint64_t x) {
+            auto r = static_cast<uint64_t>(std::sqrt(static_cast<double>(x)));
+            while (r > 0 && r * r > x) --r;
+            while ((r + 1) * (r + 1) <= x) ++r;
+            return r;
+        }
+    }
+
+    PrimeSieve::PrimeSieve(uint64_t lo, uint64_t hi) : hi_(hi), seg_(kSegmentBytes) {
+        two_ = lo <= 2 && hi >= 2;
+        next_lo_ = std::max<uint64_t>(lo, 3) | 1;
+        seg_lo_ = next_lo_;
+
+        // base primes: plain sieve of the odd numbers up to sqrt(hi)
+        uint64_t root = isqrt(hi);
+        std::vector<unsigned char> small(root / 2 + 1, 1);
+        for (uint64_t i = 3; i * i <= root; i += 2) {
+            if (!small[i / 2]) continue;
+            for (uint64_t j = i * i; j <= root; j += 2 * i) small[j / 2] = 0;
+        }
+        for (uint64_t i = 3; i <= root; i += 2) if (small[i / 2]) base_.push_back(static_cast<uint32_t>(i));
+    }
+
+    bool PrimeSieve::fill_segment() {
+        if (next_lo_ > hi_) return false;
+        seg_lo_ = next_lo_;
+        len_ = static_cast<size_t>(std::min<uint64_t>(kSegmentBytes, (hi_ - seg_lo_) / 2 + 1));
+        uint64_t seg_hi = seg_lo_ + 2 * (len_ - 1);
+        std::fill(seg_.begin(), seg_.begin() + static_cast<std::ptrdiff_t>(len_), 1);
+
+        for (uint32_t p : base_) {
+            uint64_t pp = static_cast<uint64_t>(p) * p;
+            if (pp > seg_hi) break;
+            // first odd multiple of p in the segment, never below p^2
+            uint64_t m = std::max(pp, (seg_lo_ + p - 1) / p * p);
+            if (!(m & 1)) m += p;
+            for (uint64_t j = (m - seg_lo_) / 2; j < len_; j += p) seg_[j] = 0;
+        }
+        pos_ = 0;
+        next_lo_ = seg_hi + 2;
+        return true;
+    }
+
+    uint64_t PrimeSieve::next() {
+        if (two_) {
+            two_ = false;
+            return 2;
+        }
+        for (;;) {
+            while (pos_ < len_) {
+                size_t i = pos_++;
+                if (seg_[i]) return seg_lo_ + 2 * i;
+            }
+            if (!fill_segment()) return 0;
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace utils {
+    /*
+     * Segmented sieve of eratosthenes over [lo, hi].
+     * Primes come out in increasing order, one cache-sized segment (odd numbers only) at a time,
+     * so memory is O(sqrt(hi)) however far it runs.
+     */
+    class PrimeSieve {
+    public:
+        PrimeSieve(uint64_t lo, uint64_t hi);
+
+        // next prime in range, 0 once exhausted
+        uint64_t next();
+
+    private:
+        bool fill_segment();
+
+        uint64_t hi_;
+        uint64_t seg_lo_;  // first (odd) number of the current segment
+        uint64_t next_lo_; // first number of the next segment
+        size_t pos_{0};
+        size_t len_{0};
+        bool two_;         // 2 is in range and not handed out yet
+        std::vector<uint32_t> base_; // odd primes up to sqrt(hi)
+        std::vector<unsigned char> seg_;
+    };
+}
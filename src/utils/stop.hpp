@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace utils {
+    /*
+     * Cooperative stop for long running attacks: an optional shared flag (another stage already
+     * won, the caller gave up) and an optional wall clock deadline. A default constructed token
+     * never fires, so attacks take it as a defaulted trailing parameter.
+     * Attacks poll stop_requested() between blocks of work (a gcd block, a powm chunk, a curve);
+     * it is one relaxed load, plus a steady_clock read only when a deadline is set.
+     * The token does not own the flag: whoever hands it out keeps the atomic alive until every
+     * attack holding the token has returned.
+     */
+    class StopToken {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        StopToken() = default;
+        explicit StopToken(const std::atomic<bool> *flag, clock::time_point deadline = clock::time_point::max())
+            : flag_(flag), deadline_(deadline) {}
+
+        // same flags, deadline pulled in to now + budget if that comes first (budget 0 = unchanged)
+        StopToken within(std::chrono::milliseconds budget) const {
+            StopToken t = *this;
+            if (budget.count() > 0) t.deadline_ = std::min(deadline_, clock::now() + budget);
+            return t;
+        }
+
+        // also fires on `flag`: a pipeline's own "somebody won" flag on top of the caller's token.
+        // Two flags is all any caller nests; a third replaces the second.
+        StopToken also(const std::atomic<bool> *flag) const {
+            StopToken t = *this;
+            (t.flag_ ? t.outer_ : t.flag_) = flag;
+            return t;
+        }
+
+        bool stop_requested() const {
+            if (flag_ && flag_->load(std::memory_order_relaxed)) return true;
+            if (outer_ && outer_->load(std::memory_order_relaxed)) return true;
+            return deadline_ != clock::time_point::max() && clock::now() >= deadline_;
+        }
+
+        bool has_deadline() const { return deadline_ != clock::time_point::max(); }
+        clock::time_point deadline() const { return deadline_; }
+
+    private:
+        const std::atomic<bool> *flag_{nullptr};
+        const std::atomic<bool> *outer_{nullptr};
+        clock::time_point deadline_{clock::time_point::max()};
+    };
+}